@@ -1,3 +1,10 @@
+#include "generator/CompiledPattern.h"
+#include "generator/PatternMorph.h"
+#include "utils/MidiOutputScheduler.h"
+#include "utils/PreviewSynth.h"
+#include <catch2/benchmark/catch_benchmark_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
 TEST_CASE ("Boot performance")
 {
     BENCHMARK_ADVANCED ("Processor constructor")
@@ -30,3 +37,205 @@ TEST_CASE ("Boot performance")
         });
     };
 }
+
+TEST_CASE ("Pitch model sampling")
+{
+    const auto& table = ScaleEngine::lookup (0, 36, 2);
+    PitchGenerator pitchGen;
+
+    // Per-note cost of the original model: an mt19937 seeded for every step
+    BENCHMARK ("Uniform note")
+    {
+        int sum = 0;
+        for (int step = 0; step < 16; ++step)
+            sum += pitchGen.generatePitch (table, step, 42);
+        return sum;
+    };
+
+    PitchModel markov;
+    markov.compile (PitchModel::Type::markov, table, 0.5f);
+
+    // Markov and walk models: one counter draw and one alias-table lookup per note
+    BENCHMARK ("Markov note")
+    {
+        int sum = 0;
+        int previous = 0;
+        for (int step = 0; step < 16; ++step)
+        {
+            previous = markov.sample (previous, CounterRng::get (42, 0, step, CounterRng::pitch));
+            sum += table.notes[(size_t) previous];
+        }
+        return sum;
+    };
+
+    BENCHMARK ("Markov compile")
+    {
+        markov.compile (PitchModel::Type::markov, table, 0.5f);
+        return markov.getType();
+    };
+}
+
+TEST_CASE ("Pattern morph")
+{
+    CompiledPattern a, b;
+    a.steps = b.steps = 16;
+    b.hits = 7;
+    b.seed = 7;
+    b.scaleIndex = 2;
+    b.humanize = 20;
+    a.compileAll();
+    b.compileAll();
+
+    PatternMorph::Slots slots { PatternMorph::Slot::capture (a), PatternMorph::Slot::capture (b) };
+    PatternMorph morph;
+    morph.update (slots, 0.5f);
+
+    // Per block: a static morph, then one automated a little further every block
+    BENCHMARK ("Static")
+    {
+        return morph.update (slots, 0.5f);
+    };
+
+    float position = 0.0f;
+    BENCHMARK ("Sweeping")
+    {
+        position = position >= 1.0f ? 0.0f : position + 1.0f / 4096.0f;
+        return morph.update (slots, position);
+    };
+
+    // Every step from scratch, as a non-incremental morph would do per block
+    BENCHMARK ("Full recompute")
+    {
+        PatternMorph fresh;
+        return fresh.update (slots, 0.5f);
+    };
+}
+
+TEST_CASE ("Offline render")
+{
+    PluginProcessor plugin;
+    plugin.prepareToPlay (48000.0, 4096);
+
+    // The internal clock gives the generator a running timeline without a host
+    auto set = [&] (const char* id, float value) {
+        auto* parameter = plugin.apvts.getParameter (id);
+        parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+    };
+    set ("clockSource", 1.0f);
+    set ("clockRunning", 1.0f);
+    set ("steps", 16.0f);
+    set ("hits", 7.0f);
+
+    juce::AudioBuffer<float> buffer (2, 4096);
+    juce::MidiBuffer midi;
+
+    plugin.setNonRealtime (false);
+    BENCHMARK ("4096-sample block, realtime")
+    {
+        midi.clear();
+        plugin.processBlock (buffer, midi);
+        return midi.getNumEvents();
+    };
+
+    plugin.setNonRealtime (true);
+    BENCHMARK ("4096-sample block, offline")
+    {
+        midi.clear();
+        plugin.processBlock (buffer, midi);
+        return midi.getNumEvents();
+    };
+}
+
+TEST_CASE ("Dense ratchets")
+{
+    PluginProcessor plugin;
+    plugin.prepareToPlay (48000.0, 256);
+
+    // Every step an eight-note roll, laid back, at the internal clock's top tempo
+    auto set = [&] (const char* id, float value) {
+        auto* parameter = plugin.apvts.getParameter (id);
+        parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+    };
+    set ("clockSource", 1.0f);
+    set ("clockRunning", 1.0f);
+    set ("clockTempo", 240.0f);
+    set ("steps", 16.0f);
+    set ("hits", 16.0f);
+    set ("ratchetChance", 1.0f);
+    set ("ratchetCount", 8.0f);
+    set ("rollRamp", 1.0f);
+    set ("microTiming", 0.25f);
+
+    juce::AudioBuffer<float> buffer (2, 256);
+    juce::MidiBuffer midi;
+
+    plugin.setNonRealtime (false);
+    BENCHMARK ("256-sample block, realtime")
+    {
+        midi.clear();
+        plugin.processBlock (buffer, midi);
+        return midi.getNumEvents();
+    };
+
+    plugin.setNonRealtime (true);
+    BENCHMARK ("256-sample block, offline")
+    {
+        midi.clear();
+        plugin.processBlock (buffer, midi);
+        return midi.getNumEvents();
+    };
+}
+
+TEST_CASE ("Preview synth")
+{
+    PreviewSynth synth;
+    synth.prepare (48000.0, 512);
+
+    // A held note with its filter sweeping, re-struck every block
+    juce::AudioBuffer<float> buffer (2, 512);
+    juce::MidiBuffer midi;
+    midi.addEvent (juce::MidiMessage::noteOn (1, 36, (juce::uint8) 110), 0);
+    midi.addEvent (juce::MidiMessage::controllerEvent (1, 74, 90), 256);
+
+    BENCHMARK ("512-sample block")
+    {
+        buffer.clear();
+        synth.render (buffer, midi, 0, 512);
+        return buffer.getSample (0, 511);
+    };
+}
+
+TEST_CASE ("MIDI output latency")
+{
+    // Counts what reaches the "port"; each run waits for its own message
+    struct CountingSink : MidiOutputScheduler::Sink
+    {
+        void send (const juce::MidiMessage&) override { sent.fetch_add (1); }
+        std::atomic<int> sent { 0 };
+    };
+
+    MidiOutputScheduler scheduler;
+    auto sink = std::make_unique<CountingSink>();
+    auto* counting = sink.get();
+    scheduler.setSink (std::move (sink));
+
+    auto sendAndWait = [&] (double delayMs) {
+        auto expected = counting->sent.load() + 1;
+        scheduler.push (juce::MidiMessage::noteOn (1, 36, (juce::uint8) 100), juce::Time::getMillisecondCounterHiRes() + delayMs);
+        while (counting->sent.load() < expected)
+            juce::Thread::yield();
+        return expected;
+    };
+
+    // How long a message due now takes to leave
+    BENCHMARK ("Due now")
+    {
+        return sendAndWait (0.0);
+    };
+
+    // A sixteenth at 180 BPM ahead: the mean over 5 ms is the lateness, the spread the jitter
+    BENCHMARK ("Due in 5 ms")
+    {
+        return sendAndWait (5.0);
+    };
+}
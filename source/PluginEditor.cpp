@@ -1,19 +1,21 @@
 #include "PluginEditor.h"
 #include "utils/MidiPatternExporter.h"
-#include "BinaryData.h"
+#include "utils/TraceRecorder.h"
 
 BasslineGeneratorEditor::BasslineGeneratorEditor(BasslineGeneratorProcessor& p)
     : AudioProcessorEditor(&p), processorRef(p)
 {
+    MB_TRACE_THREAD("Message");
     setSize(800, 480);  // Wider for logo, taller for bigger knobs
 
     // Make window resizable with constraints
     setResizable(true, true);
-    setResizeLimits(700, 420, 1100, 650);
+    setResizeLimits(700, 460, 1100, 650);
 
-    // Load logo from binary data
-    logoImage = juce::ImageCache::getFromMemory(BinaryData::makebasslogo_png, BinaryData::makebasslogo_pngSize);
+    // Decoded once per process, not per editor
+    logoImage = sharedResources->getLogo();
     logoComponent.setImage(logoImage);
+    logoComponent.onClick = [this](const juce::MouseEvent& e) { toggleDebugTools(e); };
     addAndMakeVisible(logoComponent);
 
     // Apply comic book look and feel to all components
@@ -43,10 +45,10 @@ BasslineGeneratorEditor::BasslineGeneratorEditor(BasslineGeneratorProcessor& p)
     setupSlider(rootNoteSlider, rootNoteLabel, "Root", "rootNote");
 
     // Scale selector
-    scaleSelector.addItemList({"Minor Pent", "Major", "Minor", "Dorian", "Chromatic"}, 1);
+    scaleSelector.addItemList(BasslineGeneratorProcessor::getScaleNames(), 1);
     addAndMakeVisible(scaleSelector);
     scaleAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(
-        processorRef.apvts, "scale", scaleSelector);
+        processorRef.apvts, "scaleType", scaleSelector);
 
     scaleLabel.setText("Scale", juce::dontSendNotification);
     scaleLabel.setJustificationType(juce::Justification::centred);
@@ -59,6 +61,58 @@ BasslineGeneratorEditor::BasslineGeneratorEditor(BasslineGeneratorProcessor& p)
     setupSlider(velocitySlider, velocityLabel, "Velocity", "velocity");
     setupSlider(humanizeSlider, humanizeLabel, "Humanize", "humanize");
     setupSlider(seedSlider, seedLabel, "Seed", "seed");
+    setupSlider(followChannelSlider, followChannelLabel, "Follow Ch", "followChannel");
+
+    // Follow selector: incoming MIDI sets the root or the chord
+    followSelector.addItemList({"Follow: Off", "Follow: Root", "Follow: Chord", "Follow: Track"}, 1);
+    addAndMakeVisible(followSelector);
+    followAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(
+        processorRef.apvts, "followMode", followSelector);
+
+    // Clock controls
+    clockSelector.addItemList({"Clock: Host", "Clock: Internal", "Clock: MIDI"}, 1);
+    addAndMakeVisible(clockSelector);
+    clockAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(
+        processorRef.apvts, "clockSource", clockSelector);
+
+    clockRunButton.setButtonText("Play");
+    clockRunButton.setClickingTogglesState(true);
+    clockRunButton.onClick = [this]()
+    {
+        clockRunButton.setButtonText(clockRunButton.getToggleState() ? "Stop" : "Play");
+    };
+    addAndMakeVisible(clockRunButton);
+    buttonAttachments.push_back(std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+        processorRef.apvts, "clockRunning", clockRunButton));
+    clockRunButton.onClick();
+
+    clockTempoSlider.setSliderStyle(juce::Slider::LinearBar);
+    clockTempoSlider.setTextValueSuffix(" BPM");
+    addAndMakeVisible(clockTempoSlider);
+    sliderAttachments.push_back(std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(
+        processorRef.apvts, "clockTempo", clockTempoSlider));
+
+    addAndMakeVisible(sendClockButton);
+    buttonAttachments.push_back(std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+        processorRef.apvts, "sendMidiClock", sendClockButton));
+
+    // MIDI output device, only meaningful in the Standalone app
+    if (processorRef.wrapperType == juce::AudioProcessor::wrapperType_Standalone)
+    {
+        refreshMidiOutputs();
+        midiOutSelector.onChange = [this]()
+        {
+            int index = midiOutSelector.getSelectedItemIndex() - 1;
+            auto identifier = juce::isPositiveAndBelow(index, midiOutDevices.size()) ? midiOutDevices[index].identifier : juce::String();
+            if (!processorRef.setMidiOutputDevice(identifier))
+                midiOutSelector.setSelectedItemIndex(0, juce::dontSendNotification);
+        };
+        addAndMakeVisible(midiOutSelector);
+
+        addAndMakeVisible(previewButton);
+        buttonAttachments.push_back(std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+            processorRef.apvts, "previewSynth", previewButton));
+    }
 
     // Regenerate button (hidden)
     regenerateButton.setButtonText("Regenerate");
@@ -69,6 +123,44 @@ BasslineGeneratorEditor::BasslineGeneratorEditor(BasslineGeneratorProcessor& p)
     };
     addAndMakeVisible(regenerateButton);
 
+    // Undo/redo (also cmd-Z / shift-cmd-Z when the editor has focus)
+    undoButton.onClick = [this]() { processorRef.undo(); };
+    redoButton.onClick = [this]() { processorRef.redo(); };
+    addAndMakeVisible(undoButton);
+    addAndMakeVisible(redoButton);
+    setWantsKeyboardFocus(true);
+
+    // A/B morph: click A or B to store the current pattern there
+    storeAButton.onClick = [this]() { processorRef.storeMorphSlot(BasslineGeneratorProcessor::MorphSlot::a); };
+    storeBButton.onClick = [this]() { processorRef.storeMorphSlot(BasslineGeneratorProcessor::MorphSlot::b); };
+    clearMorphButton.onClick = [this]() { processorRef.clearMorphSlots(); };
+    addAndMakeVisible(storeAButton);
+    addAndMakeVisible(storeBButton);
+    addAndMakeVisible(clearMorphButton);
+
+    morphSlider.setSliderStyle(juce::Slider::LinearBar);
+    morphSlider.setTextValueSuffix(" morph");
+    addAndMakeVisible(morphSlider);
+    sliderAttachments.push_back(std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(
+        processorRef.apvts, "morph", morphSlider));
+
+    // Song mode
+    addAndMakeVisible(songModeButton);
+    buttonAttachments.push_back(std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+        processorRef.apvts, "songMode", songModeButton));
+
+    sectionBarsSelector.addItemList({ "1 Bar", "2 Bars", "4 Bars", "8 Bars" }, 1);
+    sectionBarsSelector.setSelectedId(3, juce::dontSendNotification);
+    addAndMakeVisible(sectionBarsSelector);
+
+    addSectionButton.onClick = [this]()
+    {
+        processorRef.appendChainSection(1 << (sectionBarsSelector.getSelectedId() - 1));
+    };
+    clearChainButton.onClick = [this]() { processorRef.clearChain(); };
+    addAndMakeVisible(addSectionButton);
+    addAndMakeVisible(clearChainButton);
+
     // Randomize button
     randomizeButton.setButtonText("Randomize");
     randomizeButton.onClick = [this]()
@@ -81,39 +173,30 @@ BasslineGeneratorEditor::BasslineGeneratorEditor(BasslineGeneratorProcessor& p)
         // Get current steps to calculate hits range (but don't change steps)
         int currentSteps = static_cast<int>(processorRef.apvts.getRawParameterValue("steps")->load());
 
-        // Randomize rhythm parameters (excluding steps/length)
-        auto* hitsParam = processorRef.apvts.getParameter("hits");
-        auto* rotationParam = processorRef.apvts.getParameter("rotation");
+        // Everything below lands together on the next bar, as one host gesture
+        BasslineGeneratorProcessor::ParameterChanges changes;
 
         // Hits: 1 to currentSteps (favor 30-70% density)
         int minHits = juce::jmax(1, currentSteps / 3);
         int maxHits = juce::jmin(currentSteps, (currentSteps * 2) / 3);
-        int newHits = random.nextInt(juce::Range<int>(minHits, maxHits + 1));
-        hitsParam->setValueNotifyingHost((newHits - 1) / 15.0f);
+        changes.set("hits", static_cast<float>(random.nextInt(juce::Range<int>(minHits, maxHits + 1))));
 
         // Rotation: 0-15
-        int newRotation = random.nextInt(16);
-        rotationParam->setValueNotifyingHost(newRotation / 15.0f);
+        changes.set("rotation", static_cast<float>(random.nextInt(16)));
 
         // Randomize scale (sometimes)
         if (random.nextFloat() > 0.5f)
-        {
-            auto* scaleParam = processorRef.apvts.getParameter("scale");
-            int newScale = random.nextInt(5);
-            scaleParam->setValueNotifyingHost(newScale / 4.0f);
-        }
+            changes.set("scaleType", static_cast<float>(random.nextInt(ScaleEngine::numBuiltInScales)));
 
         // Randomize swing (sometimes, keep it subtle)
         if (random.nextFloat() > 0.6f)
-        {
-            auto* swingParam = processorRef.apvts.getParameter("swing");
-            float newSwing = random.nextFloat() * 0.4f; // 0-40% swing
-            swingParam->setValueNotifyingHost(newSwing / 0.75f);
-        }
+            changes.set("swing", random.nextFloat() * 0.4f); // 0-40% swing
 
         // Always randomize seed for new pitch variations
         auto* seedParam = processorRef.apvts.getParameter("seed");
-        seedParam->setValueNotifyingHost(random.nextFloat());
+        changes.set("seed", seedParam->convertFrom0to1(random.nextFloat()));
+
+        processorRef.applyParameterChanges(changes, BasslineGeneratorProcessor::TransactionBoundary::bar);
     };
     addAndMakeVisible(randomizeButton);
 
@@ -135,9 +218,10 @@ BasslineGeneratorEditor::BasslineGeneratorEditor(BasslineGeneratorProcessor& p)
     // Setup MIDI drag area
     addAndMakeVisible(midiDragArea);
     midiDragArea.onCreatePattern = [this]() { return createMidiPattern(); };
+    midiDragArea.onPress = [this]() { updateExport(true); };
 
     // Setup bar length selector
-    barLengthSelector.addItemList({"1 Bar", "2 Bars", "4 Bars", "8 Bars"}, 1);
+    barLengthSelector.addItemList({"1 Bar", "2 Bars", "4 Bars", "8 Bars", "Full Cycle"}, 1);
     barLengthSelector.setSelectedId(1, juce::dontSendNotification);
     barLengthSelector.onChange = [this]()
     {
@@ -148,6 +232,7 @@ BasslineGeneratorEditor::BasslineGeneratorEditor(BasslineGeneratorProcessor& p)
             case 2: bars = 2; break;
             case 3: bars = 4; break;
             case 4: bars = 8; break;
+            case 5: bars = 0; break;
         }
         midiDragArea.setNumBars(bars);
     };
@@ -157,6 +242,46 @@ BasslineGeneratorEditor::BasslineGeneratorEditor(BasslineGeneratorProcessor& p)
     barLengthLabel.setJustificationType(juce::Justification::centred);
     addAndMakeVisible(barLengthLabel);
 
+    // Chord track: switch to following it as soon as one is dropped
+    harmonyDropZone.onFileDropped = [this](const juce::File& file)
+    {
+        if (!processorRef.loadHarmonyFile(file))
+            return false;
+
+        auto* followParam = processorRef.apvts.getParameter("followMode");
+        followParam->setValueNotifyingHost(followParam->convertTo0to1(BasslineGeneratorProcessor::followHarmonyTrack));
+        return true;
+    };
+    harmonyDropZone.onCleared = [this]() { processorRef.clearHarmony(); };
+    addAndMakeVisible(harmonyDropZone);
+
+    // Scala scale: select the imported slot once it loads
+    scaleDropZone.onFileDropped = [this](const juce::File& file)
+    {
+        if (!processorRef.loadScalaFile(file))
+            return false;
+
+        auto* scaleParam = processorRef.apvts.getParameter("scaleType");
+        scaleParam->setValueNotifyingHost(scaleParam->convertTo0to1(static_cast<float>(ScaleEngine::userScaleIndex)));
+        return true;
+    };
+    scaleDropZone.onCleared = [this]() { processorRef.clearUserScale(); };
+    addAndMakeVisible(scaleDropZone);
+
+    // Groove template: analysed from any MIDI clip, applied at the groove amount
+    grooveDropZone.onFileDropped = [this](const juce::File& file) { return processorRef.loadGrooveFile(file); };
+    grooveDropZone.onCleared = [this]() { processorRef.clearGroove(); };
+    addAndMakeVisible(grooveDropZone);
+
+    // Kick pattern: the drum part the rhythm fits to, reduced to its kick
+    kickDropZone.onFileDropped = [this](const juce::File& file) { return processorRef.loadKickFile(file); };
+    kickDropZone.onCleared = [this]() { processorRef.clearKick(); };
+    addAndMakeVisible(kickDropZone);
+
+    // Debug overlay sits above everything, hidden until asked for
+    addChildComponent(statsOverlay);
+    statsOverlay.setAlwaysOnTop(true);
+
     startTimerHz(30); // For UI updates
 }
 
@@ -212,6 +337,11 @@ void BasslineGeneratorEditor::resized()
     barLengthSelector.setBounds(topRightArea.removeFromRight(100).reduced(5, 12));
     randomizeButton.setBounds(topRightArea.removeFromRight(100).reduced(5, 10));
 
+    // Top-left: follow mode
+    followSelector.setBounds(topArea.removeFromLeft(150).reduced(12, 12));
+    midiOutSelector.setBounds(topArea.removeFromLeft(170).reduced(8, 12));
+    previewButton.setBounds(topArea.removeFromLeft(90).reduced(5, 12));
+
     // Hide the label
     barLengthLabel.setBounds(0, 0, 0, 0);
 
@@ -255,6 +385,38 @@ void BasslineGeneratorEditor::resized()
     scaleLabel.setBounds(scaleArea.removeFromTop(labelHeight));
     scaleSelector.setBounds(scaleArea.removeFromTop(26).reduced(3, 0));
 
+    // Drop zones along the bottom
+    area.removeFromTop(10);
+    auto dropRow = area.removeFromTop(50);
+    harmonyDropZone.setBounds(dropRow.removeFromLeft(96).reduced(6, 0));
+    scaleDropZone.setBounds(dropRow.removeFromLeft(96).reduced(6, 0));
+    grooveDropZone.setBounds(dropRow.removeFromLeft(96).reduced(6, 0));
+    kickDropZone.setBounds(dropRow.removeFromLeft(96).reduced(6, 0));
+
+    // Clock controls share the row
+    dropRow = dropRow.withSizeKeepingCentre(dropRow.getWidth(), 30);
+    clockSelector.setBounds(dropRow.removeFromLeft(130).reduced(4, 0));
+    clockRunButton.setBounds(dropRow.removeFromLeft(64).reduced(4, 0));
+    clockTempoSlider.setBounds(dropRow.removeFromLeft(100).reduced(4, 0));
+    sendClockButton.setBounds(dropRow.removeFromLeft(90).reduced(4, 0));
+
+    // Undo/redo and the A/B morph
+    area.removeFromTop(6);
+    auto editRow = area.removeFromTop(30);
+    undoButton.setBounds(editRow.removeFromLeft(52).reduced(4, 0));
+    redoButton.setBounds(editRow.removeFromLeft(52).reduced(4, 0));
+    editRow.removeFromLeft(12);
+    storeAButton.setBounds(editRow.removeFromLeft(36).reduced(4, 0));
+    morphSlider.setBounds(editRow.removeFromLeft(140).reduced(4, 0));
+    storeBButton.setBounds(editRow.removeFromLeft(36).reduced(4, 0));
+    clearMorphButton.setBounds(editRow.removeFromLeft(56).reduced(4, 0));
+
+    // Song mode on the right
+    clearChainButton.setBounds(editRow.removeFromRight(56).reduced(4, 0));
+    addSectionButton.setBounds(editRow.removeFromRight(48).reduced(4, 0));
+    sectionBarsSelector.setBounds(editRow.removeFromRight(80).reduced(4, 0));
+    songModeButton.setBounds(editRow.removeFromRight(70).reduced(4, 0));
+
     // Hide all advanced controls (still functional, just not visible)
     rotationSlider.setBounds(0, 0, 0, 0);
     rotationLabel.setBounds(0, 0, 0, 0);
@@ -268,11 +430,41 @@ void BasslineGeneratorEditor::resized()
     humanizeLabel.setBounds(0, 0, 0, 0);
     seedSlider.setBounds(0, 0, 0, 0);
     seedLabel.setBounds(0, 0, 0, 0);
+    followChannelSlider.setBounds(0, 0, 0, 0);
+    followChannelLabel.setBounds(0, 0, 0, 0);
     regenerateButton.setBounds(0, 0, 0, 0);
+
+    statsOverlay.setBounds(getLocalBounds().reduced(24).removeFromBottom(140).removeFromLeft(380));
+}
+
+void BasslineGeneratorEditor::toggleDebugTools(const juce::MouseEvent& e)
+{
+    if (!e.mods.isAltDown())
+        return;
+
+    if (e.mods.isShiftDown())
+    {
+        if (!inspector)
+        {
+            inspector = std::make_unique<melatonin::Inspector>(*this);
+            inspector->onClose = [this]() { inspector.reset(); };
+        }
+
+        inspector->setVisible(true);
+        return;
+    }
+
+    statsOverlay.setVisible(!statsOverlay.isVisible());
 }
 
 void BasslineGeneratorEditor::timerCallback()
 {
+    MB_TRACE_SCOPE("ui", "timerCallback");
+
+    // Nothing moves on screen while the host bounces
+    if (processorRef.isNonRealtime())
+        return;
+
     // Update step grid with current pattern and playback state
     int steps = processorRef.apvts.getRawParameterValue("steps")->load();
     int hits = processorRef.apvts.getRawParameterValue("hits")->load();
@@ -283,9 +475,63 @@ void BasslineGeneratorEditor::timerCallback()
 
     stepGrid.setPattern(steps, hits, rotation);
     stepGrid.setCurrentStep(currentStep, isPlaying);
+    stepGrid.setCycle(processorRef.patternState.cycleStep.load(), processorRef.patternState.cycleLength.load());
+
+    // State may have been restored by the host
+    harmonyDropZone.setLoadedName(processorRef.getHarmonyName());
+    scaleDropZone.setLoadedName(processorRef.getUserScaleName());
+    grooveDropZone.setLoadedName(processorRef.getGrooveName());
+    kickDropZone.setLoadedName(processorRef.getKickName());
+
+    undoButton.setEnabled(processorRef.canUndo());
+    redoButton.setEnabled(processorRef.canRedo());
+
+    storeAButton.setToggleState(processorRef.hasMorphSlot(BasslineGeneratorProcessor::MorphSlot::a), juce::dontSendNotification);
+    storeBButton.setToggleState(processorRef.hasMorphSlot(BasslineGeneratorProcessor::MorphSlot::b), juce::dontSendNotification);
+
+    songModeButton.setTooltip(juce::String(processorRef.getNumChainSections()) + " sections, "
+                              + juce::String(processorRef.getChainBars()) + " bars");
+
+    updateExport(false);
 }
 
-juce::MemoryBlock BasslineGeneratorEditor::createMidiPattern()
+bool BasslineGeneratorEditor::keyPressed(const juce::KeyPress& key)
+{
+    if (key == juce::KeyPress('z', juce::ModifierKeys::commandModifier, 0))
+    {
+        processorRef.undo();
+        return true;
+    }
+
+    if (key == juce::KeyPress('z', juce::ModifierKeys::commandModifier | juce::ModifierKeys::shiftModifier, 0))
+    {
+        processorRef.redo();
+        return true;
+    }
+
+    return false;
+}
+
+void BasslineGeneratorEditor::refreshMidiOutputs()
+{
+    midiOutDevices = juce::MidiOutput::getAvailableDevices();
+
+    midiOutSelector.clear(juce::dontSendNotification);
+    midiOutSelector.addItem("MIDI Out: None", 1);
+
+    auto selected = processorRef.getMidiOutputDevice();
+    for (int i = 0; i < midiOutDevices.size(); ++i)
+    {
+        midiOutSelector.addItem(midiOutDevices[i].name, i + 2);
+        if (midiOutDevices[i].identifier == selected)
+            midiOutSelector.setSelectedId(i + 2, juce::dontSendNotification);
+    }
+
+    if (midiOutSelector.getSelectedId() == 0)
+        midiOutSelector.setSelectedId(1, juce::dontSendNotification);
+}
+
+MidiPatternExporter::PatternParams BasslineGeneratorEditor::getExportParams()
 {
     MidiPatternExporter::PatternParams params;
 
@@ -294,13 +540,48 @@ juce::MemoryBlock BasslineGeneratorEditor::createMidiPattern()
     params.hits = static_cast<int>(processorRef.apvts.getRawParameterValue("hits")->load());
     params.rotation = static_cast<int>(processorRef.apvts.getRawParameterValue("rotation")->load());
     params.rootNote = static_cast<int>(processorRef.apvts.getRawParameterValue("rootNote")->load());
-    params.scaleIndex = static_cast<int>(processorRef.apvts.getRawParameterValue("scale")->load());
+    params.scaleIndex = static_cast<int>(processorRef.apvts.getRawParameterValue("scaleType")->load());
     params.octaveRange = static_cast<int>(processorRef.apvts.getRawParameterValue("octaveRange")->load());
+    params.pitchModel = static_cast<int>(processorRef.apvts.getRawParameterValue("pitchModel")->load());
+    params.pitchSpread = processorRef.apvts.getRawParameterValue("pitchSpread")->load();
+    params.voiceLeading = processorRef.apvts.getRawParameterValue("voiceLeading")->load() >= 0.5f;
     params.velocity = static_cast<int>(processorRef.apvts.getRawParameterValue("velocity")->load());
     params.noteLength = processorRef.apvts.getRawParameterValue("noteLength")->load();
     params.swing = processorRef.apvts.getRawParameterValue("swing")->load();
     params.humanize = static_cast<int>(processorRef.apvts.getRawParameterValue("humanize")->load());
+    params.ratchetChance = processorRef.apvts.getRawParameterValue("ratchetChance")->load();
+    params.ratchetCount = static_cast<int>(processorRef.apvts.getRawParameterValue("ratchetCount")->load());
+    params.rollRamp = processorRef.apvts.getRawParameterValue("rollRamp")->load();
+    params.microTiming = processorRef.apvts.getRawParameterValue("microTiming")->load();
+    params.grooveAmount = processorRef.apvts.getRawParameterValue("grooveAmount")->load();
+    params.humanizeTiming = processorRef.apvts.getRawParameterValue("humanizeTiming")->load();
+    params.glideChance = processorRef.apvts.getRawParameterValue("glide")->load();
+    params.glideTime = processorRef.apvts.getRawParameterValue("glideTime")->load();
+    params.controlLanes = processorRef.getControlLaneSettings();
+    params.noteChannels = processorRef.getNoteChannelSettings();
+    params.probability = processorRef.apvts.getRawParameterValue("probability")->load();
+    params.variationCycle = static_cast<int>(processorRef.apvts.getRawParameterValue("variationCycle")->load());
+    params.groove = processorRef.getGroove();
+    params.kickMode = static_cast<int>(processorRef.apvts.getRawParameterValue("kickMode")->load());
+    if (processorRef.apvts.getRawParameterValue("kickChannel")->load() < 1.0f)
+        params.kick = processorRef.getKickPattern();
     params.seed = static_cast<int>(processorRef.apvts.getRawParameterValue("seed")->load());
+    params.fillEvery = processorRef.getFillEveryBars();
+    params.mutation = processorRef.apvts.getRawParameterValue("mutation")->load();
+    params.rotationDrift = static_cast<int>(processorRef.apvts.getRawParameterValue("rotationDrift")->load());
+    params.pitchLength = static_cast<int>(processorRef.apvts.getRawParameterValue("pitchLength")->load());
+    params.accentLength = static_cast<int>(processorRef.apvts.getRawParameterValue("accentLength")->load());
+
+    if (static_cast<int>(processorRef.apvts.getRawParameterValue("followMode")->load()) == BasslineGeneratorProcessor::followHarmonyTrack)
+        params.harmony = processorRef.getHarmonyTrack();
+
+    params.userScale = processorRef.getUserScale();
+    params.morphSlots = processorRef.getMorphSlots();
+    params.morph = processorRef.apvts.getRawParameterValue("morph")->load();
+
+    // In song mode the drag carries the arrangement
+    if (processorRef.apvts.getRawParameterValue("songMode")->load() >= 0.5f)
+        params.arrangement = processorRef.getArrangement();
 
     // Get number of bars from selector
     switch (barLengthSelector.getSelectedId())
@@ -309,6 +590,7 @@ juce::MemoryBlock BasslineGeneratorEditor::createMidiPattern()
         case 2: params.numBars = 2; break;
         case 3: params.numBars = 4; break;
         case 4: params.numBars = 8; break;
+        case 5: params.numBars = 0; break; // Whole cycle
         default: params.numBars = 1; break;
     }
 
@@ -325,5 +607,48 @@ juce::MemoryBlock BasslineGeneratorEditor::createMidiPattern()
         }
     }
 
+    return params;
+}
+
+// Renders once the parameters have settled (a knob being turned changes them every tick), or
+// straight away when a drag is about to start
+void BasslineGeneratorEditor::updateExport(bool now)
+{
+    auto params = getExportParams();
+    auto time = juce::Time::getMillisecondCounter();
+    if (params != settlingExportParams)
+    {
+        settlingExportParams = params;
+        exportParamsChangedAt = time;
+    }
+
+    if (params == exportParams || (!now && time - exportParamsChangedAt < exportSettleMs))
+        return;
+
+    // Supersedes the render for the previous parameters if it hasn't finished
+    exportParams = params;
+    juce::Component::SafePointer<BasslineGeneratorEditor> editor(this);
+    processorRef.getJobs().submit<juce::MemoryBlock>(
+        JobSystem::Priority::interactive, "export",
+        [params](const CancellationToken& token) { return MidiPatternExporter::exportToMemory(params, &token); },
+        [editor, params](juce::MemoryBlock data)
+        {
+            if (editor == nullptr)
+                return;
+
+            editor->exportedParams = params;
+            editor->exportedPattern = std::move(data);
+        });
+}
+
+juce::MemoryBlock BasslineGeneratorEditor::createMidiPattern()
+{
+    MB_TRACE_SCOPE("ui", "createMidiPattern");
+
+    // Rendered synchronously only if the drag beats the background job
+    auto params = getExportParams();
+    if (params == exportedParams && !exportedPattern.isEmpty())
+        return exportedPattern;
+
     return MidiPatternExporter::exportToMemory(params);
 }
@@ -5,6 +5,10 @@
 #include "ui/StepSequencerGrid.h"
 #include "ui/MidiDragComponent.h"
 #include "ui/ComicBookLookAndFeel.h"
+#include "ui/StatsOverlay.h"
+#include "ui/FileDropZone.h"
+#include "utils/MidiPatternExporter.h"
+#include "melatonin_inspector/melatonin_inspector.h"
 
 class BasslineGeneratorEditor : public juce::AudioProcessorEditor,
                                  private juce::Timer,
@@ -16,6 +20,7 @@ public:
 
     void paint(juce::Graphics&) override;
     void resized() override;
+    bool keyPressed(const juce::KeyPress& key) override;
 
 private:
     void timerCallback() override;
@@ -36,10 +41,40 @@ private:
     juce::Label velocityLabel, humanizeLabel, seedLabel;
     juce::TextButton regenerateButton;
 
+    // Key/chord follow from incoming MIDI
+    juce::ComboBox followSelector;
+    juce::Slider followChannelSlider;
+    juce::Label followChannelLabel;
+
+    // Clock: source, run/stop and tempo for the internal clock, MIDI clock out
+    juce::ComboBox clockSelector;
+    juce::TextButton clockRunButton;
+    juce::Slider clockTempoSlider;
+    juce::ToggleButton sendClockButton { "Clock Out" };
+
+    // Standalone only: MIDI device the output scheduler sends to
+    juce::ComboBox midiOutSelector;
+    juce::Array<juce::MidiDeviceInfo> midiOutDevices;
+    void refreshMidiOutputs();
+    juce::ToggleButton previewButton { "Preview" }; // The built-in synth
+
     // Randomization button
     juce::TextButton randomizeButton;
 
+    // Undo history
+    juce::TextButton undoButton { "Undo" }, redoButton { "Redo" };
+
+    // A/B morph: store buttons either side of the morph slider
+    juce::TextButton storeAButton { "A" }, storeBButton { "B" }, clearMorphButton { "Clear" };
+    juce::Slider morphSlider;
+
+    // Song mode: adds the current pattern to the chain for the chosen number of bars
+    juce::ToggleButton songModeButton { "Song" };
+    juce::ComboBox sectionBarsSelector;
+    juce::TextButton addSectionButton { "Add" }, clearChainButton { "Clear" };
+
     // Logo
+    juce::SharedResourcePointer<SharedResources> sharedResources;
     juce::Image logoImage;
 
     // Logo component
@@ -48,6 +83,14 @@ private:
     public:
         void setImage(const juce::Image& img) { image = img; repaint(); }
 
+        std::function<void(const juce::MouseEvent&)> onClick;
+
+        void mouseUp(const juce::MouseEvent& e) override
+        {
+            if (onClick && !e.mouseWasDraggedSinceMouseDown())
+                onClick(e);
+        }
+
         void paint(juce::Graphics& g) override
         {
             if (image.isValid())
@@ -60,6 +103,11 @@ private:
 
     LogoComponent logoComponent;
 
+    // Debug tools: alt-click the logo for block stats, alt-shift-click for the inspector
+    StatsOverlay statsOverlay { processorRef.blockStats };
+    std::unique_ptr<melatonin::Inspector> inspector;
+    void toggleDebugTools(const juce::MouseEvent& e);
+
     // Visualizer - big step grid
     StepSequencerGrid stepGrid;
 
@@ -68,14 +116,33 @@ private:
     juce::ComboBox barLengthSelector;
     juce::Label barLengthLabel;
 
+    // File drop targets
+    FileDropZone harmonyDropZone { "Chord Track", { "mid", "midi" } };
+    FileDropZone scaleDropZone { "Scale", { "scl", "kbm" } };
+    FileDropZone grooveDropZone { "Groove", { "mid", "midi" } };
+    FileDropZone kickDropZone { "Kick", { "mid", "midi" } };
+
     // Attachments
     std::vector<std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment>> sliderAttachments;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> scaleAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> followAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> clockAttachment;
+    std::vector<std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment>> buttonAttachments;
 
     // Custom look and feel
     ComicBookLookAndFeel comicLookAndFeel;
 
+    // Drag export: rendered in the background once the parameters settle, or when the mouse
+    // goes down on the drag area, so the drag itself usually only writes the file
+    static constexpr juce::uint32 exportSettleMs = 400;
+    MidiPatternExporter::PatternParams getExportParams();
+    void updateExport(bool now);
     juce::MemoryBlock createMidiPattern();
+    MidiPatternExporter::PatternParams settlingExportParams; // Latest seen, and since when
+    juce::uint32 exportParamsChangedAt = 0;
+    MidiPatternExporter::PatternParams exportParams; // Last submitted
+    MidiPatternExporter::PatternParams exportedParams; // What exportedPattern was rendered from
+    juce::MemoryBlock exportedPattern;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BasslineGeneratorEditor)
 };
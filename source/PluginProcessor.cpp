@@ -1,26 +1,166 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
-#include <random>
+#include "utils/TraceRecorder.h"
+#include "generator/ChordQuantiser.h"
+#include "utils/ScalaImport.h"
+#include <algorithm>
+#include <map>
 
 //==============================================================================
-BasslineGeneratorProcessor::BasslineGeneratorProcessor()
-    : AudioProcessor(BusesProperties()
+juce::AudioProcessor::BusesProperties BasslineGeneratorProcessor::createBuses()
+{
+    BusesProperties buses;
 #if !JucePlugin_IsMidiEffect
 #if !JucePlugin_IsSynth
-                         .withInput("Input", juce::AudioChannelSet::stereo(), true)
+    buses = buses.withInput("Input", juce::AudioChannelSet::stereo(), true);
 #endif
-                         .withOutput("Output", juce::AudioChannelSet::stereo(), true)
+    buses = buses.withOutput("Output", juce::AudioChannelSet::stereo(), true);
+#else
+    // A MIDI effect has no audio, except in the Standalone app: there's no synth after it
+    // there, so the preview synth gets an output to play through
+    if (juce::PluginHostType::getPluginLoadedAs() == wrapperType_Standalone)
+        buses = buses.withOutput("Preview", juce::AudioChannelSet::stereo(), true);
 #endif
-                         ),
+    return buses;
+}
+
+BasslineGeneratorProcessor::BasslineGeneratorProcessor()
+    : AudioProcessor(createBuses()),
       apvts(*this, nullptr, "Parameters", createParameterLayout())
 {
     // Initialize manual toggles to false
     for (auto& toggle : manualToggles)
         toggle.store(false);
+
+    stepsParam = apvts.getRawParameterValue("steps");
+    hitsParam = apvts.getRawParameterValue("hits");
+    rotationParam = apvts.getRawParameterValue("rotation");
+    rootNoteParam = apvts.getRawParameterValue("rootNote");
+    scaleParam = apvts.getRawParameterValue("scaleType");
+    octaveRangeParam = apvts.getRawParameterValue("octaveRange");
+    noteLengthParam = apvts.getRawParameterValue("noteLength");
+    velocityParam = apvts.getRawParameterValue("velocity");
+    swingParam = apvts.getRawParameterValue("swing");
+    humanizeParam = apvts.getRawParameterValue("humanize");
+    seedParam = apvts.getRawParameterValue("seed");
+    followModeParam = apvts.getRawParameterValue("followMode");
+    followChannelParam = apvts.getRawParameterValue("followChannel");
+    pitchModelParam = apvts.getRawParameterValue("pitchModel");
+    pitchSpreadParam = apvts.getRawParameterValue("pitchSpread");
+    voiceLeadingParam = apvts.getRawParameterValue("voiceLeading");
+    fillEveryParam = apvts.getRawParameterValue("fillEvery");
+    mutationParam = apvts.getRawParameterValue("mutation");
+    rotationDriftParam = apvts.getRawParameterValue("rotationDrift");
+    pitchLengthParam = apvts.getRawParameterValue("pitchLength");
+    accentLengthParam = apvts.getRawParameterValue("accentLength");
+    clockSourceParam = apvts.getRawParameterValue("clockSource");
+    clockTempoParam = apvts.getRawParameterValue("clockTempo");
+    clockTimeSigParam = apvts.getRawParameterValue("clockTimeSig");
+    clockRunningParam = apvts.getRawParameterValue("clockRunning");
+    sendMidiClockParam = apvts.getRawParameterValue("sendMidiClock");
+    morphParam = apvts.getRawParameterValue("morph");
+    songModeParam = apvts.getRawParameterValue("songMode");
+    ratchetChanceParam = apvts.getRawParameterValue("ratchetChance");
+    ratchetCountParam = apvts.getRawParameterValue("ratchetCount");
+    rollRampParam = apvts.getRawParameterValue("rollRamp");
+    microTimingParam = apvts.getRawParameterValue("microTiming");
+    grooveAmountParam = apvts.getRawParameterValue("grooveAmount");
+    humanizeTimingParam = apvts.getRawParameterValue("humanizeTiming");
+    probabilityParam = apvts.getRawParameterValue("probability");
+    variationCycleParam = apvts.getRawParameterValue("variationCycle");
+    kickModeParam = apvts.getRawParameterValue("kickMode");
+    kickChannelParam = apvts.getRawParameterValue("kickChannel");
+    glideParam = apvts.getRawParameterValue("glide");
+    glideTimeParam = apvts.getRawParameterValue("glideTime");
+    glideModeParam = apvts.getRawParameterValue("glideMode");
+    bendRangeParam = apvts.getRawParameterValue("bendRange");
+    envelopeCcParam = apvts.getRawParameterValue("envelopeCc");
+    envelopeFloorParam = apvts.getRawParameterValue("envelopeFloor");
+    envelopeAmountParam = apvts.getRawParameterValue("envelopeAmount");
+    envelopeDecayParam = apvts.getRawParameterValue("envelopeDecay");
+    curveRateParam = apvts.getRawParameterValue("curveRate");
+    curveDeadbandParam = apvts.getRawParameterValue("curveDeadband");
+    outputModeParam = apvts.getRawParameterValue("outputMode");
+    outputChannelParam = apvts.getRawParameterValue("outputChannel");
+    channelCountParam = apvts.getRawParameterValue("channelCount");
+    previewSynthParam = apvts.getRawParameterValue("previewSynth");
+    morphParameter = apvts.getParameter("morph");
+
+    // Map each parameter to the compiled field it feeds
+    const std::map<juce::String, CompiledPattern::Field> fields = {
+        { "steps", CompiledPattern::Field::rhythm },
+        { "hits", CompiledPattern::Field::rhythm },
+        { "rotation", CompiledPattern::Field::rhythm },
+        { "rootNote", CompiledPattern::Field::pitch },
+        { "scaleType", CompiledPattern::Field::pitch },
+        { "octaveRange", CompiledPattern::Field::pitch },
+        { "seed", CompiledPattern::Field::pitch },
+        { "pitchModel", CompiledPattern::Field::pitch },
+        { "pitchSpread", CompiledPattern::Field::pitch },
+        { "voiceLeading", CompiledPattern::Field::pitch },
+        { "velocity", CompiledPattern::Field::velocity },
+        { "humanize", CompiledPattern::Field::velocity },
+        { "swing", CompiledPattern::Field::timing },
+        { "noteLength", CompiledPattern::Field::timing },
+        { "ratchetChance", CompiledPattern::Field::timing },
+        { "ratchetCount", CompiledPattern::Field::timing },
+        { "rollRamp", CompiledPattern::Field::timing },
+        { "microTiming", CompiledPattern::Field::timing },
+        { "grooveAmount", CompiledPattern::Field::timing },
+        { "humanizeTiming", CompiledPattern::Field::timing },
+        { "glide", CompiledPattern::Field::timing },
+        { "glideTime", CompiledPattern::Field::timing },
+        { "probability", CompiledPattern::Field::phrase },
+        { "variationCycle", CompiledPattern::Field::phrase },
+        { "kickMode", CompiledPattern::Field::phrase },
+        { "kickChannel", CompiledPattern::Field::phrase },
+        { "fillEvery", CompiledPattern::Field::phrase },
+        { "mutation", CompiledPattern::Field::phrase },
+        { "rotationDrift", CompiledPattern::Field::phrase },
+        { "pitchLength", CompiledPattern::Field::phrase },
+        { "accentLength", CompiledPattern::Field::phrase }
+    };
+
+    for (auto* parameter : getParameters())
+    {
+        auto* withId = dynamic_cast<juce::AudioProcessorParameterWithID*>(parameter);
+        if (withId == nullptr)
+        {
+            fieldByParameterIndex.push_back(-1);
+            continue;
+        }
+
+        auto field = fields.find(withId->paramID);
+        fieldByParameterIndex.push_back(field != fields.end() ? static_cast<int>(field->second) : -1);
+
+        // Only pattern parameters are undoable; transport and routing aren't part of a pattern
+        if (field != fields.end())
+            parameter->addListener(this);
+        if (withId->paramID == "pitchLength")
+            pitchLengthParameterIndex = parameter->getParameterIndex();
+
+        // Same id scheme clap-juce-extensions uses to expose JUCE parameters
+        clapParameters.push_back({ static_cast<clap_id>(withId->paramID.hashCode()), apvts.getParameter(withId->paramID),
+                                   apvts.getRawParameterValue(withId->paramID) });
+    }
+
+    std::sort(clapParameters.begin(), clapParameters.end(), [](const auto& a, const auto& b) { return a.id < b.id; });
+    jassert(getParameters().size() <= static_cast<int>(clapAutomated.size() * 64));
+    startTimer(30);
+
+    syncParameters();
+    compiled.compileAll();
+    drawnPitches = compiled.pitches;
+    history.reset(captureHistoryState());
+
+    voiceLeadingWorker.inputsChanged();
 }
 
 BasslineGeneratorProcessor::~BasslineGeneratorProcessor()
 {
+    stopTimer();
+    for (auto* parameter : getParameters())
+        parameter->removeListener(this);
 }
 
 //==============================================================================
@@ -41,11 +181,18 @@ BasslineGeneratorProcessor::createParameterLayout()
     params.push_back(std::make_unique<juce::AudioParameterInt>(
         "rootNote", "Root Note", 24, 48, 36)); // C1 to C3, default C2
     params.push_back(std::make_unique<juce::AudioParameterChoice>(
-        "scale", "Scale",
-        juce::StringArray{"Minor Pentatonic", "Major", "Minor", "Dorian", "Chromatic"},
-        0));
+        "scaleType", "Scale", getScaleNames(), 0)); // Was "scale" with five scales (see savedParameterID)
     params.push_back(std::make_unique<juce::AudioParameterInt>(
         "octaveRange", "Octave Range", 1, 2, 1));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        "pitchModel", "Pitch Model",
+        juce::StringArray{"Uniform", "Weighted", "Markov", "Interval Walk"},
+        0));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        "pitchSpread", "Pitch Spread", juce::NormalisableRange<float>(0.0f, 1.0f, 1.0f / PitchModel::spreadLevels),
+        0.5f)); // 0 = focused, 1 = near uniform
+    params.push_back(std::make_unique<juce::AudioParameterBool>(
+        "voiceLeading", "Voice Leading", false)); // Optimise the whole bar's line
 
     // Note parameters
     params.push_back(std::make_unique<juce::AudioParameterFloat>(
@@ -65,16 +212,185 @@ BasslineGeneratorProcessor::createParameterLayout()
     params.push_back(std::make_unique<juce::AudioParameterBool>(
         "regenerate", "Regenerate", false));
 
+    // Follow parameters (incoming MIDI sets the root or the chord)
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        "followMode", "Follow Mode",
+        juce::StringArray{"Off", "Root", "Chord", "Harmony Track"},
+        0));
+    params.push_back(std::make_unique<juce::AudioParameterInt>(
+        "followChannel", "Follow Channel", 0, 16, 0)); // 0 = any channel
+
+    // Phrase parameters (variation from bar to bar)
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        "fillEvery", "Fill Every",
+        juce::StringArray{"Off", "2 Bars", "4 Bars", "8 Bars"},
+        0));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        "mutation", "Mutation", 0.0f, 1.0f, 0.0f)); // Chance per step of a new pitch
+    params.push_back(std::make_unique<juce::AudioParameterInt>(
+        "rotationDrift", "Rotation Drift", 0, 15, 0)); // Steps per bar
+
+    // Polymeter: pitch and accent sequence lengths, 0 = same as steps
+    params.push_back(std::make_unique<juce::AudioParameterInt>(
+        "pitchLength", "Pitch Length", 0, 16, 0));
+    params.push_back(std::make_unique<juce::AudioParameterInt>(
+        "accentLength", "Accent Length", 0, 16, 0));
+
+    // Clock parameters (internal clock and MIDI clock for the Standalone app and hardware rigs)
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        "clockSource", "Clock Source",
+        juce::StringArray{"Host", "Internal", "MIDI Clock"},
+        0));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        "clockTempo", "Clock Tempo", juce::NormalisableRange<float>(40.0f, 240.0f, 0.1f), 120.0f));
+    params.push_back(std::make_unique<juce::AudioParameterInt>(
+        "clockTimeSig", "Clock Beats Per Bar", 1, 16, 4));
+    params.push_back(std::make_unique<juce::AudioParameterBool>(
+        "clockRunning", "Clock Running", false));
+    params.push_back(std::make_unique<juce::AudioParameterBool>(
+        "sendMidiClock", "Send MIDI Clock", false));
+
+    // A/B morph: 0 plays slot A, 1 plays slot B
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        "morph", "Morph", 0.0f, 1.0f, 0.0f));
+
+    // Song mode: play the pattern chain instead of the pattern parameters
+    params.push_back(std::make_unique<juce::AudioParameterBool>(
+        "songMode", "Song Mode", false));
+
+    // Ratchets and micro-timing
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        "ratchetChance", "Ratchet", 0.0f, 1.0f, 0.0f)); // Chance per step of a ratchet
+    params.push_back(std::make_unique<juce::AudioParameterInt>(
+        "ratchetCount", "Ratchet Count", 2, CompiledPattern::maxRatchets, 4)); // Most notes per ratchet
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        "rollRamp", "Roll", -1.0f, 1.0f, 0.0f)); // < 0 fades a ratchet out, > 0 rolls it in
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        "microTiming", "Micro Timing", 0.0f, 0.5f, 0.0f)); // Most a step is laid back, fraction of step
+
+    // Groove template: how much of the imported groove is applied
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        "grooveAmount", "Groove Amount", 0.0f, 1.0f, 1.0f));
+
+    // Humanize timing and hit probability, drawn afresh each bar unless a cycle repeats them
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        "humanizeTiming", "Humanize Timing", 0.0f, 0.2f, 0.0f)); // Most a note moves either way, fraction of step
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        "probability", "Probability", 0.0f, 1.0f, 1.0f)); // Chance each hit plays
+    params.push_back(std::make_unique<juce::AudioParameterInt>(
+        "variationCycle", "Variation Cycle", 0, 16, 0)); // Bars before the draws repeat, 0 = never
+
+    // Drum-aware rhythm: how the hits sit against a kick, dropped in as a file or played in live
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        "kickMode", "Kick Fit", juce::StringArray{"Off", "Lock", "Avoid", "Interlock"}, 0));
+    params.push_back(std::make_unique<juce::AudioParameterInt>(
+        "kickChannel", "Kick Channel", 0, 16, 0)); // MIDI channel the kick comes in on, 0 = file only
+
+    // Glide: slides between steps, as pitch bend or the synth's own portamento
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        "glide", "Glide", 0.0f, 1.0f, 0.0f)); // Chance per step of a slide into it
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        "glideTime", "Glide Time", 0.05f, 1.0f, 0.5f)); // Fraction of a step
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        "glideMode", "Glide Mode", juce::StringArray{"Pitch Bend", "Portamento"}, 0));
+    params.push_back(std::make_unique<juce::AudioParameterInt>(
+        "bendRange", "Bend Range", 1, 24, 2)); // Semitones, to match the synth
+
+    // Envelope lane: a CC (filter cutoff, say) that jumps with each note and decays
+    params.push_back(std::make_unique<juce::AudioParameterInt>(
+        "envelopeCc", "Envelope CC", 0, 119, 0)); // 0 = off
+    params.push_back(std::make_unique<juce::AudioParameterInt>(
+        "envelopeFloor", "Envelope Floor", 0, 127, 32));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        "envelopeAmount", "Envelope Amount", 0.0f, 1.0f, 0.5f));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        "envelopeDecay", "Envelope Decay", 0.1f, 4.0f, 1.0f)); // Steps
+
+    // Curve output: points on a grid, thinned to the ones that moved
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        "curveRate", "Curve Resolution", 1.0f, 50.0f, 5.0f)); // Milliseconds between points
+    params.push_back(std::make_unique<juce::AudioParameterInt>(
+        "curveDeadband", "Curve Deadband", 1, 8, 1)); // Least change sent, CC steps
+
+    // Output channels: one, a round robin, one per note role, or MPE (lower zone, per-note
+    // bend, pressure and timbre)
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        "outputMode", "Output Mode", juce::StringArray{"Single Channel", "Round Robin", "By Role", "MPE"}, 0));
+    params.push_back(std::make_unique<juce::AudioParameterInt>(
+        "outputChannel", "Output Channel", 1, 16, 1)); // First channel; MPE always uses the lower zone
+    params.push_back(std::make_unique<juce::AudioParameterInt>(
+        "channelCount", "Channels", 1, 15, 15)); // Round robin channels, or MPE member channels
+
+    // Standalone only: plays the output on the built-in bass synth
+    params.push_back(std::make_unique<juce::AudioParameterBool>(
+        "previewSynth", "Preview Synth", true));
+
     return {params.begin(), params.end()};
 }
 
 //==============================================================================
-void BasslineGeneratorProcessor::prepareToPlay(double sampleRate, int /*samplesPerBlock*/)
+void BasslineGeneratorProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
     currentSampleRate = sampleRate;
+    blockStats.prepare(sampleRate);
     lastPpqPosition = -1;
-    currentStep = 0;
+    currentStep = -1;
+    playingBar = -1;
     activeNote = -1;
+    holdForSlide = false;
+    burstIndex = CompiledPattern::maxRatchets;
+    controlLanes.stop([](const juce::MidiMessage&) {}); // A fresh start; nothing to undo
+    noteChannels.reset();
+    lastClockTick = -1;
+    samplesProcessed = 0;
+    midiClockIn.prepare(sampleRate);
+    previewSynth.prepare(sampleRate, samplesPerBlock);
+
+    // Worst case for a block: ratchets are at least a sample apart, so a note-on and note-off
+    // per sample, each note-on with up to four lane messages ahead of it, a point per curve
+    // lane at the finest resolution, the MPE zone setup, plus the clock ticks of a very fast
+    // host tempo and the start/stop messages. Neither output path then allocates, however
+    // dense the ratchets.
+    constexpr double maxHostBpm = 999.0;
+    constexpr double finestCurveMs = 1.0;
+    constexpr size_t mpeSetupEvents = 3 * 16;
+    constexpr size_t bytesPerEvent = 12;
+    auto blockSamples = static_cast<size_t>(juce::jmax(samplesPerBlock, 512));
+    auto maxTicks = static_cast<size_t>(std::ceil(static_cast<double>(blockSamples) * maxHostBpm / 60.0
+                                                  * MidiClockInput::ticksPerQuarter / sampleRate));
+    auto maxCurvePoints = 3 * static_cast<size_t>(std::ceil(static_cast<double>(blockSamples) / (finestCurveMs * 0.001 * sampleRate)) + 1);
+    maxBlockMidiBytes = (6 * blockSamples + maxCurvePoints + mpeSetupEvents + maxTicks + 8) * bytesPerEvent;
+    clapMidiOut.ensureSize(maxBlockMidiBytes);
+    blockMidiOut.ensureSize(maxBlockMidiBytes);
+
+    syncParameters();
+}
+
+void BasslineGeneratorProcessor::setNonRealtime(bool nonRealtime) noexcept
+{
+    // Some hosts call this before every bounce; only a switch to offline has work to do
+    bool switchingToOffline = nonRealtime && !isNonRealtime();
+    AudioProcessor::setNonRealtime(nonRealtime);
+    if (!switchingToOffline)
+        return;
+
+    // A voice line job that may not have run yet goes out now; the first offline block
+    // waits for it, so the optimiser never runs here or under the callback lock
+    voiceLeadingWorker.submitForOffline();
+
+    // Hosts switch modes between blocks; the callback lock keeps a late block out regardless
+    const juce::ScopedLock sl(getCallbackLock());
+
+    currentHarmony = harmony.acquire();
+    currentUserScale = userScale.acquire();
+    currentGroove = groove.acquire();
+    currentKick = kickPattern.acquire();
+    currentVoiceLine = voiceLine.acquire();
+    currentMorphSlots = morphSlots.acquire();
+    currentArrangement = arrangements.acquire();
+    syncParameters();
+    syncMorph();
+    phrase.bar(0); // Bounces usually start from the top
 }
 
 void BasslineGeneratorProcessor::releaseResources()
@@ -83,206 +399,1965 @@ void BasslineGeneratorProcessor::releaseResources()
     // spare memory, etc.
 }
 
-void BasslineGeneratorProcessor::processBlock(juce::AudioBuffer<float>& buffer,
-                                               juce::MidiBuffer& midiMessages)
+//==============================================================================
+// Incremental pattern compilation
+
+// Block start: picks up a newly committed transaction, then syncs whatever it doesn't cover
+void BasslineGeneratorProcessor::syncBlock()
 {
-    // Clear any incoming MIDI (we're generating, not processing)
-    midiMessages.clear();
+    auto serial = transactionSerial.load();
+    acquireTransaction();
+    syncParameters();
 
-    // Get host playhead info
-    auto* playHead = getPlayHead();
-    if (playHead == nullptr)
+    // A commit started while we were reading, so some of its values may have been synced
+    // already. Apply all of it now rather than play a mix of old and new.
+    if (transactionSerial.load() != serial && acquireTransaction())
+        applyTransaction();
+
+    // Song mode syncs nothing, so a replaced scale has to be picked up here
+    if (playingSection >= 0)
+        rebindUserScale();
+
+    syncMorph();
+}
+
+void BasslineGeneratorProcessor::syncParameters()
+{
+    using Field = CompiledPattern::Field;
+    auto frozen = frozenFields();
+
+    if ((frozen & CompiledPattern::fieldBit(Field::rhythm)) == 0)
+        syncRhythm();
+    if ((frozen & CompiledPattern::fieldBit(Field::pitch)) == 0)
+        syncPitch();
+    if ((frozen & CompiledPattern::fieldBit(Field::velocity)) == 0)
+        syncVelocity();
+    if ((frozen & CompiledPattern::fieldBit(Field::timing)) == 0)
+        syncTiming();
+    if ((frozen & CompiledPattern::fieldBit(Field::phrase)) == 0)
+        syncPhrase();
+    if ((frozen & CompiledPattern::fieldBit(Field::pitch)) == 0)
+        syncVoiceLeading();
+}
+
+void BasslineGeneratorProcessor::syncParameter(const juce::AudioProcessorParameter& parameter)
+{
+    if (&parameter == morphParameter)
+    {
+        syncMorph();
         return;
+    }
 
-    auto posInfo = playHead->getPosition();
-    if (!posInfo.hasValue())
+    auto index = static_cast<size_t>(parameter.getParameterIndex());
+    if (index >= fieldByParameterIndex.size() || fieldByParameterIndex[index] < 0)
         return;
 
-    // Only generate when playing
-    if (!posInfo->getIsPlaying())
-    {
-        // Send note-off if we were playing a note
-        if (activeNote >= 0)
-        {
-            midiMessages.addEvent(juce::MidiMessage::noteOff(1, activeNote), 0);
-            activeNote = -1;
-        }
-        lastPpqPosition = -1;
-        patternState.isPlaying.store(false);
+    if ((frozenFields() & (1u << fieldByParameterIndex[index])) != 0)
         return;
+
+    switch (static_cast<CompiledPattern::Field>(fieldByParameterIndex[index]))
+    {
+        case CompiledPattern::Field::rhythm: syncRhythm(); break;
+        case CompiledPattern::Field::pitch: syncPitch(); break;
+        case CompiledPattern::Field::velocity: syncVelocity(); break;
+        case CompiledPattern::Field::timing: syncTiming(); break;
+        case CompiledPattern::Field::phrase: syncPhrase(); break;
     }
 
-    patternState.isPlaying.store(true);
+    syncVoiceLeading();
+    syncMorph();
+}
 
-    // Get timing info
-    auto bpm = posInfo->getBpm().orFallback(120.0);
-    auto ppqPosition = posInfo->getPpqPosition().orFallback(0.0);
-    auto timeSignature = posInfo->getTimeSignature().orFallback(
-        juce::AudioPlayHead::TimeSignature{4, 4});
+// Clears the field's stale bit, returning whether it was set
+bool BasslineGeneratorProcessor::takeStaleField(CompiledPattern::Field field) noexcept
+{
+    auto bit = CompiledPattern::fieldBit(field);
+    bool stale = (staleFields & bit) != 0;
+    staleFields &= ~bit;
+    return stale;
+}
 
-    // Calculate timing values
-    int numSteps = apvts.getRawParameterValue("steps")->load();
-    double beatsPerBar = timeSignature.numerator;
-    double ppqPerStep = beatsPerBar / numSteps; // Subdivide bar into steps
-    double samplesPerBeat = (currentSampleRate * 60.0) / bpm;
-    double samplesPerStep = samplesPerBeat * ppqPerStep;
+void BasslineGeneratorProcessor::syncRhythm()
+{
+    int steps = static_cast<int>(stepsParam->load());
+    int hits = static_cast<int>(hitsParam->load());
+    int rotation = static_cast<int>(rotationParam->load());
 
-    // Get swing amount (0.0 to 0.75)
-    float swingAmount = apvts.getRawParameterValue("swing")->load();
+    if (!takeStaleField(CompiledPattern::Field::rhythm)
+        && steps == compiled.steps && hits == compiled.hits && rotation == compiled.rotation)
+        return;
 
-    // Get note length
-    float noteLengthFraction = apvts.getRawParameterValue("noteLength")->load();
-    noteDurationSamples = static_cast<int>(samplesPerStep * noteLengthFraction);
+    compiled.steps = steps;
+    compiled.hits = hits;
+    compiled.rotation = rotation;
+    compiled.compileRhythm();
+    compiled.compileBursts(); // The groove is laid over the new steps
+    phrase.invalidate();
+    voiceLineDirty = true; // Hits moved, the line lands on different steps
+}
 
-    // Process each sample in the buffer
-    int numSamples = buffer.getNumSamples();
+void BasslineGeneratorProcessor::syncPitch()
+{
+    int rootNote = static_cast<int>(rootNoteParam->load());
+    int scaleIndex = static_cast<int>(scaleParam->load());
+    int octaveRange = static_cast<int>(octaveRangeParam->load());
+    int seed = static_cast<int>(seedParam->load());
+    auto pitchModelType = static_cast<PitchModel::Type>(juce::jlimit(0, 3, static_cast<int>(pitchModelParam->load())));
+    float pitchSpread = pitchSpreadParam->load();
 
-    for (int sample = 0; sample < numSamples; ++sample)
-    {
-        // Calculate PPQ at this sample
-        double samplePpq = ppqPosition + (sample * bpm) / (currentSampleRate * 60.0);
+    // A newly imported scale only matters while it is selected
+    bool userScaleChanged = currentUserScale != compiledUserScale && scaleIndex == ScaleEngine::userScaleIndex;
 
-        // Determine which step we're on (accounting for swing)
-        double barPosition = std::fmod(samplePpq, beatsPerBar);
+    if (!takeStaleField(CompiledPattern::Field::pitch)
+        && rootNote == compiled.rootNote && scaleIndex == compiled.scaleIndex
+        && octaveRange == compiled.octaveRange && seed == compiled.seed && !userScaleChanged
+        && pitchModelType == compiled.pitchModelType && pitchSpread == compiled.pitchSpread)
+        return;
 
-        // Apply swing: delay even steps
-        double adjustedBarPosition = barPosition;
-        if (swingAmount > 0.0f)
-        {
-            double stepProgress = barPosition / ppqPerStep;
-            int baseStep = static_cast<int>(stepProgress);
-            double fractionalStep = stepProgress - baseStep;
+    bool seedChanged = seed != compiled.seed;
 
-            // If we're on an even step, delay it
-            if (baseStep % 2 == 1)
-            {
-                adjustedBarPosition = barPosition + (ppqPerStep * swingAmount * fractionalStep);
-            }
-        }
+    compiled.rootNote = rootNote;
+    compiled.scaleIndex = scaleIndex;
+    compiled.octaveRange = octaveRange;
+    compiled.seed = seed;
+    compiled.pitchModelType = pitchModelType;
+    compiled.pitchSpread = pitchSpread;
+    compiled.compilePitches(currentUserScale);
+    compiledUserScale = currentUserScale;
+    drawnPitches = compiled.pitches;
+    voiceLineDirty = true;
 
-        int step = static_cast<int>(adjustedBarPosition / ppqPerStep) % numSteps;
+    // Ratchets and micro-timing are seeded too
+    if (seedChanged)
+        compiled.compileBursts();
 
-        // Detect step change (new step triggered)
-        if (step != currentStep)
-        {
-            currentStep = step;
-            patternState.currentStep.store(step);
+    phrase.invalidate();
+}
 
-            // Check if this step should trigger a note (Euclidean pattern)
-            int hits = apvts.getRawParameterValue("hits")->load();
-            int rotation = apvts.getRawParameterValue("rotation")->load();
+void BasslineGeneratorProcessor::syncVelocity()
+{
+    int velocity = static_cast<int>(velocityParam->load());
+    int humanize = static_cast<int>(humanizeParam->load());
 
-            bool shouldTrigger = euclidean.shouldTrigger(step, numSteps, hits, rotation);
+    if (!takeStaleField(CompiledPattern::Field::velocity)
+        && velocity == compiled.velocity && humanize == compiled.humanize)
+        return;
 
-            // Apply manual toggles if present
-            if (hasManualToggles.load() && step < 16)
-            {
-                if (manualToggles[step].load())
-                    shouldTrigger = !shouldTrigger; // Toggle the state
-            }
+    compiled.velocity = velocity;
+    compiled.humanize = humanize;
+    compiled.compileVelocities();
+    phrase.invalidate();
+}
 
-            if (shouldTrigger)
-            {
-                // Send note-off for previous note if active
-                if (activeNote >= 0)
-                {
-                    midiMessages.addEvent(
-                        juce::MidiMessage::noteOff(1, activeNote), sample);
-                }
-
-                // Generate pitch
-                int rootNote = apvts.getRawParameterValue("rootNote")->load();
-                int scaleIndex = apvts.getRawParameterValue("scale")->load();
-                int octaveRange = apvts.getRawParameterValue("octaveRange")->load();
-                int seed = apvts.getRawParameterValue("seed")->load();
-
-                int pitch = pitchGen.generatePitch(
-                    rootNote, scaleIndex, octaveRange, step, seed);
-
-                // Apply velocity with humanization
-                int baseVelocity = apvts.getRawParameterValue("velocity")->load();
-                int humanizeAmount = apvts.getRawParameterValue("humanize")->load();
-
-                int velocity = baseVelocity;
-                if (humanizeAmount > 0)
-                {
-                    // Use seed + step for deterministic but varied humanization
-                    std::mt19937 rng(seed + step * 251);
-                    std::uniform_int_distribution<int> velDist(-humanizeAmount, humanizeAmount);
-                    velocity = juce::jlimit(1, 127, baseVelocity + velDist(rng));
-                }
-
-                // Send note-on
-                midiMessages.addEvent(
-                    juce::MidiMessage::noteOn(1, pitch, (juce::uint8)velocity),
-                    sample);
-
-                activeNote = pitch;
-                samplesUntilNoteOff = noteDurationSamples;
-            }
-        }
+void BasslineGeneratorProcessor::syncTiming()
+{
+    compiled.noteLength = noteLengthParam->load();
+
+    float swing = swingParam->load();
+    float grooveAmount = grooveAmountParam->load();
+    float ratchetChance = ratchetChanceParam->load();
+    int ratchetCount = static_cast<int>(ratchetCountParam->load());
+    float rollRamp = rollRampParam->load();
+    float microTiming = microTimingParam->load();
+    float humanizeTiming = humanizeTimingParam->load();
+    float glideChance = glideParam->load();
+    compiled.glideTime = glideTimeParam->load();
+
+    if (!takeStaleField(CompiledPattern::Field::timing)
+        && glideChance == compiled.glideChance && humanizeTiming == compiled.humanizeTiming && swing == compiled.swing && grooveAmount == compiled.grooveAmount && currentGroove == compiledGroove
+        && ratchetChance == compiled.ratchetChance && ratchetCount == compiled.ratchetCount
+        && rollRamp == compiled.rollRamp && microTiming == compiled.microTiming)
+        return;
+
+    compiled.swing = swing;
+    compiled.grooveAmount = grooveAmount;
+    GrooveTemplate::apply(currentGroove, compiled);
+    compiledGroove = currentGroove;
+    compiled.ratchetChance = ratchetChance;
+    compiled.ratchetCount = ratchetCount;
+    compiled.rollRamp = rollRamp;
+    compiled.microTiming = microTiming;
+    compiled.humanizeTiming = humanizeTiming;
+    compiled.glideChance = glideChance;
+    compiled.compileBursts();
+    phrase.invalidate(); // Bars hold the humanized timing
+}
+
+// Lays the optimised line over the drawn pitches once it matches what we're playing.
+// Until the worker catches up, the drawn pitches play.
+void BasslineGeneratorProcessor::syncVoiceLeading()
+{
+    bool enabled = voiceLeadingParam->load() >= 0.5f;
+    if (!voiceLineDirty && currentVoiceLine == appliedVoiceLine && enabled == voiceLeadingApplied)
+        return;
+
+    compiled.pitches = drawnPitches;
+    if (enabled && currentVoiceLine != nullptr && currentVoiceLine->key == VoiceLine::Key::of(compiled, currentUserScale))
+        currentVoiceLine->applyTo(compiled);
+
+    appliedVoiceLine = currentVoiceLine;
+    voiceLeadingApplied = enabled;
+    voiceLineDirty = false;
+    phrase.invalidate();
+}
+
+bool BasslineGeneratorProcessor::readVoiceLeadingInputs(CompiledPattern& pattern,
+                                                        std::shared_ptr<const ScaleEngine::UserScale>& scale) const
+{
+    if (voiceLeadingParam->load() < 0.5f)
+        return false;
+
+    pattern.steps = static_cast<int>(stepsParam->load());
+    pattern.hits = static_cast<int>(hitsParam->load());
+    pattern.rootNote = static_cast<int>(rootNoteParam->load());
+    pattern.scaleIndex = static_cast<int>(scaleParam->load());
+    pattern.octaveRange = static_cast<int>(octaveRangeParam->load());
+    pattern.seed = static_cast<int>(seedParam->load());
+    pattern.pitchModelType = static_cast<PitchModel::Type>(juce::jlimit(0, 3, static_cast<int>(pitchModelParam->load())));
+    pattern.pitchSpread = pitchSpreadParam->load();
+    pattern.pitchLength = static_cast<int>(pitchLengthParam->load());
+    scale = userScale.getLatest();
+    return true;
+}
 
-        // Handle note-off timing
-        if (activeNote >= 0)
+// While both morph slots are stored, the morphed bar replaces the triggers, pitches and
+// velocities compiled from the parameters. Anything that recompiles those (a knob, the voice
+// line, a transaction) is overridden again here. Slots stored with another step count or
+// other cycle lengths than the parameters now give leave the parameters' pattern playing.
+void BasslineGeneratorProcessor::syncMorph() noexcept
+{
+    if (currentMorphSlots == nullptr || !currentMorphSlots->fit(compiled))
+    {
+        if (morphApplied)
         {
-            samplesUntilNoteOff--;
-            if (samplesUntilNoteOff <= 0)
-            {
-                midiMessages.addEvent(
-                    juce::MidiMessage::noteOff(1, activeNote), sample);
-                activeNote = -1;
-            }
+            // Back to the pattern the parameters describe
+            compiled.compileRhythm();
+            compiled.compileVelocities();
+            voiceLineDirty = true;
+            syncVoiceLeading();
+            morph.reset();
+            morphApplied = false;
         }
+        return;
+    }
+
+    morph.update(*currentMorphSlots, morphParam->load());
+    morphApplied = true;
+
+    if (compiled.triggerMask == morph.triggerMask && compiled.pitches == morph.pitches
+        && compiled.velocities == morph.velocities)
+        return;
+
+    compiled.triggerMask = morph.triggerMask;
+    compiled.pitches = morph.pitches;
+    compiled.velocities = morph.velocities;
+    phrase.invalidate();
+}
+
+// Returns true when the compiled pattern changed: a different section, or back to the
+// parameters once song mode is off
+bool BasslineGeneratorProcessor::loadSection(int barIndex) noexcept
+{
+    bool songMode = songModeParam->load() >= 0.5f && currentArrangement != nullptr;
+    int section = songMode ? currentArrangement->sectionAt(barIndex) : -1;
+
+    if (section < 0)
+    {
+        if (playingSection < 0)
+            return false;
+
+        // Every field is recompiled from the parameters, whatever the section left in compiled;
+        // fields a transaction has frozen stay stale until it lands or they sync
+        playingSection = -1;
+        playingArrangement = nullptr;
+        staleFields = ~0u;
+        voiceLineDirty = true;
+        syncParameters();
+        syncMorph();
+        return true;
     }
+
+    if (section == playingSection && currentArrangement == playingArrangement)
+        return false;
+
+    compiled = currentArrangement->patterns[static_cast<size_t>(section)];
+    compiledUserScale = currentArrangement->userScale.get();
+    drawnPitches = compiled.pitches;
+    phrase.invalidate();
+    rebindUserScale();
+
+    playingSection = section;
+    playingArrangement = currentArrangement;
+    MB_TRACE_INSTANT("audio", "section", section);
+
+    syncMorph();
+    return true;
 }
 
-//==============================================================================
-juce::AudioProcessorEditor* BasslineGeneratorProcessor::createEditor()
+int BasslineGeneratorProcessor::getFillEveryBars() const
 {
-    return new BasslineGeneratorEditor(*this);
+    return fillEveryBarsForChoice(fillEveryParam->load());
 }
 
-//==============================================================================
-void BasslineGeneratorProcessor::getStateInformation(juce::MemoryBlock& destData)
+ControlLanes::Settings BasslineGeneratorProcessor::getControlLaneSettings() const
 {
-    auto state = apvts.copyState();
-    std::unique_ptr<juce::XmlElement> xml(state.createXml());
-    copyXmlToBinary(*xml, destData);
+    ControlLanes::Settings settings;
+    settings.glide = static_cast<ControlLanes::Glide>(juce::jlimit(0, 1, static_cast<int>(glideModeParam->load())));
+    settings.bendRange = static_cast<int>(bendRangeParam->load());
+    settings.envelopeCc = static_cast<int>(envelopeCcParam->load());
+    settings.envelopeFloor = static_cast<int>(envelopeFloorParam->load());
+    settings.envelopeAmount = envelopeAmountParam->load();
+    settings.envelopeDecay = envelopeDecayParam->load();
+    settings.resolutionMs = curveRateParam->load();
+    settings.deadband = static_cast<int>(curveDeadbandParam->load());
+    settings.perNote = static_cast<int>(outputModeParam->load()) == static_cast<int>(NoteChannels::Mode::mpe);
+    return settings;
 }
 
-void BasslineGeneratorProcessor::setStateInformation(const void* data, int sizeInBytes)
+NoteChannels::Settings BasslineGeneratorProcessor::getNoteChannelSettings() const
 {
-    std::unique_ptr<juce::XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
-    if (xml != nullptr && xml->hasTagName(apvts.state.getType()))
+    NoteChannels::Settings settings;
+    settings.mode = static_cast<NoteChannels::Mode>(juce::jlimit(0, 3, static_cast<int>(outputModeParam->load())));
+    settings.channel = static_cast<int>(outputChannelParam->load());
+    settings.count = static_cast<int>(channelCountParam->load());
+    return settings;
+}
+
+int BasslineGeneratorProcessor::fillEveryBarsForChoice(float choice)
+{
+    static constexpr int fillChoices[] = { 0, 2, 4, 8 };
+    return fillChoices[juce::jlimit(0, 3, static_cast<int>(choice))];
+}
+
+void BasslineGeneratorProcessor::syncPhrase()
+{
+    int fillEvery = getFillEveryBars();
+    float mutation = mutationParam->load();
+    int rotationDrift = static_cast<int>(rotationDriftParam->load());
+    int pitchLength = static_cast<int>(pitchLengthParam->load());
+    int accentLength = static_cast<int>(accentLengthParam->load());
+    float probability = probabilityParam->load();
+    int variationCycle = static_cast<int>(variationCycleParam->load());
+    int kickMode = static_cast<int>(kickModeParam->load());
+
+    // A live kick is written straight into compiled at each bar line (see applyLiveKick). A
+    // stale phrase has another pattern's kick bars.
+    bool stale = takeStaleField(CompiledPattern::Field::phrase);
+    bool liveKick = kickChannelParam->load() >= 1.0f;
+    bool kickChanged = stale || (liveKick ? compiledKick != nullptr : currentKick != compiledKick || liveKickApplied);
+
+    if (fillEvery == compiled.fillEvery && mutation == compiled.mutation && rotationDrift == compiled.rotationDrift
+        && pitchLength == compiled.pitchLength && accentLength == compiled.accentLength
+        && probability == compiled.probability && variationCycle == compiled.variationCycle
+        && kickMode == compiled.kickMode && !kickChanged)
+        return;
+
+    if (pitchLength != compiled.pitchLength)
+        voiceLineDirty = true; // The line covers the pitch cycle, which changed length
+
+    compiled.fillEvery = fillEvery;
+    compiled.mutation = mutation;
+    compiled.rotationDrift = rotationDrift;
+    compiled.pitchLength = pitchLength;
+    compiled.accentLength = accentLength;
+    compiled.probability = probability;
+    compiled.variationCycle = variationCycle;
+    compiled.kickMode = kickMode;
+
+    if (kickChanged)
     {
-        apvts.replaceState(juce::ValueTree::fromXml(*xml));
+        compiledKick = liveKick ? nullptr : currentKick;
+        KickPattern::apply(compiledKick, compiled);
+        liveKickApplied = false;
     }
+
+    phrase.invalidate();
 }
 
 //==============================================================================
-// Manual pattern editing
-void BasslineGeneratorProcessor::toggleStep(int step)
+// Parameter transactions
+
+void BasslineGeneratorProcessor::applyParameterChanges(const ParameterChanges& changes, TransactionBoundary boundary)
 {
-    if (step >= 0 && step < 16)
+    commitTransaction(changes, boundary, nullptr);
+}
+
+// writeParameters stores the new values; by default each one is set inside a single gesture
+void BasslineGeneratorProcessor::commitTransaction(const ParameterChanges& changes, TransactionBoundary boundary,
+                                                   const std::function<void()>& writeParameters)
+{
+    auto transaction = std::make_shared<Transaction>();
+    transaction->atBar = boundary == TransactionBoundary::bar;
+
+    // Staged values snapped the way the parameters will store them, so the audio thread finds
+    // nothing left to recompile once the writes land
+    std::vector<std::pair<juce::RangedAudioParameter*, float>> staged;
+    for (const auto& [parameterID, value] : changes.values)
     {
-        bool currentState = manualToggles[step].load();
-        manualToggles[step].store(!currentState);
-        hasManualToggles.store(true);
+        if (auto* parameter = apvts.getParameter(parameterID))
+        {
+            staged.emplace_back(parameter, parameter->convertFrom0to1(parameter->convertTo0to1(value)));
+
+            auto index = static_cast<size_t>(parameter->getParameterIndex());
+            if (index < fieldByParameterIndex.size() && fieldByParameterIndex[index] >= 0)
+                transaction->fields |= 1u << fieldByParameterIndex[index];
+        }
+    }
+
+    if (staged.empty())
+    {
+        if (writeParameters != nullptr)
+            writeParameters();
+        return;
+    }
+
+    // The whole pattern, compiled once
+    readPatternParameters(transaction->pattern, [&](const std::atomic<float>* raw, const char* parameterID)
+    {
+        for (const auto& [parameter, stagedValue] : staged)
+            if (parameter->paramID == parameterID)
+                return stagedValue;
+        return raw->load();
+    });
+
+    transaction->userScale = userScale.getLatest();
+    transaction->groove = groove.getLatest();
+    GrooveTemplate::apply(transaction->groove.get(), transaction->pattern);
+    transaction->kick = kickChannelParam->load() >= 1.0f ? nullptr : kickPattern.getLatest();
+    KickPattern::apply(transaction->kick.get(), transaction->pattern);
+    transaction->pattern.compileAll(transaction->userScale.get());
+
+    // Odd while the parameters are being written: the audio thread syncs nothing from them
+    transaction->serial = transactionSerial.fetch_add(1) + 1;
+    transactions.publish(std::move(transaction));
+
+    if (writeParameters != nullptr)
+    {
+        writeParameters();
+    }
+    else
+    {
+        for (auto& [parameter, stagedValue] : staged)
+            parameter->beginChangeGesture();
+        for (auto& [parameter, stagedValue] : staged)
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(stagedValue));
+        for (auto& [parameter, stagedValue] : staged)
+            parameter->endChangeGesture();
     }
+
+    transactionSerial.fetch_add(1);
 }
 
-bool BasslineGeneratorProcessor::isStepManuallyToggled(int step) const
+// value(raw, id) supplies each parameter: the live one, or a staged or stored replacement
+void BasslineGeneratorProcessor::readPatternParameters(CompiledPattern& pattern, const PatternValue& value) const
 {
-    if (step >= 0 && step < 16)
-        return manualToggles[step].load();
-    return false;
+    pattern.steps = static_cast<int>(value(stepsParam, "steps"));
+    pattern.hits = static_cast<int>(value(hitsParam, "hits"));
+    pattern.rotation = static_cast<int>(value(rotationParam, "rotation"));
+    pattern.rootNote = static_cast<int>(value(rootNoteParam, "rootNote"));
+    pattern.scaleIndex = static_cast<int>(value(scaleParam, "scaleType"));
+    pattern.octaveRange = static_cast<int>(value(octaveRangeParam, "octaveRange"));
+    pattern.seed = static_cast<int>(value(seedParam, "seed"));
+    pattern.pitchModelType = static_cast<PitchModel::Type>(juce::jlimit(0, 3, static_cast<int>(value(pitchModelParam, "pitchModel"))));
+    pattern.pitchSpread = value(pitchSpreadParam, "pitchSpread");
+    pattern.velocity = static_cast<int>(value(velocityParam, "velocity"));
+    pattern.humanize = static_cast<int>(value(humanizeParam, "humanize"));
+    pattern.swing = value(swingParam, "swing");
+    pattern.noteLength = value(noteLengthParam, "noteLength");
+    pattern.ratchetChance = value(ratchetChanceParam, "ratchetChance");
+    pattern.ratchetCount = static_cast<int>(value(ratchetCountParam, "ratchetCount"));
+    pattern.rollRamp = value(rollRampParam, "rollRamp");
+    pattern.microTiming = value(microTimingParam, "microTiming");
+    pattern.grooveAmount = value(grooveAmountParam, "grooveAmount");
+    pattern.fillEvery = fillEveryBarsForChoice(value(fillEveryParam, "fillEvery"));
+    pattern.mutation = value(mutationParam, "mutation");
+    pattern.rotationDrift = static_cast<int>(value(rotationDriftParam, "rotationDrift"));
+    pattern.pitchLength = static_cast<int>(value(pitchLengthParam, "pitchLength"));
+    pattern.accentLength = static_cast<int>(value(accentLengthParam, "accentLength"));
+    pattern.humanizeTiming = value(humanizeTimingParam, "humanizeTiming");
+    pattern.glideChance = value(glideParam, "glide");
+    pattern.glideTime = value(glideTimeParam, "glideTime");
+    pattern.probability = value(probabilityParam, "probability");
+    pattern.variationCycle = static_cast<int>(value(variationCycleParam, "variationCycle"));
+    pattern.kickMode = static_cast<int>(value(kickModeParam, "kickMode"));
 }
 
-void BasslineGeneratorProcessor::clearManualToggles()
+// Only the user scale this block acquired is guaranteed to outlive the block, so the compiled
+// pitch table mustn't point into any other
+void BasslineGeneratorProcessor::rebindUserScale() noexcept
 {
-    for (auto& toggle : manualToggles)
-        toggle.store(false);
-    hasManualToggles.store(false);
+    if (compiledUserScale == currentUserScale || compiled.scaleIndex != ScaleEngine::userScaleIndex)
+        return;
+
+    compiled.compilePitches(currentUserScale);
+    compiledUserScale = currentUserScale;
+    drawnPitches = compiled.pitches;
+    voiceLineDirty = true;
+    phrase.invalidate();
+}
+
+uint32_t BasslineGeneratorProcessor::frozenFields() const noexcept
+{
+    // Mid-commit, nothing read from the parameters belongs to a consistent set; in song mode
+    // the arrangement plays instead of them
+    if (transactionSerial.load() % 2 != 0 || playingSection >= 0)
+        return ~0u;
+
+    return pendingTransaction != nullptr ? pendingTransaction->fields : 0u;
+}
+
+// True when a transaction newer than the applied one is waiting
+bool BasslineGeneratorProcessor::acquireTransaction() noexcept
+{
+    const auto* latest = transactions.acquire();
+    pendingTransaction = latest != nullptr && latest->serial > appliedTransactionSerial ? latest : nullptr;
+    return pendingTransaction != nullptr;
+}
+
+bool BasslineGeneratorProcessor::transactionDue(int step) const noexcept
+{
+    if (step == 0)
+        return true;
+
+    return !pendingTransaction->atBar && pendingTransaction->pattern.steps == compiled.steps;
+}
+
+void BasslineGeneratorProcessor::applyTransaction() noexcept
+{
+    // In song mode the parameters are written but the arrangement keeps playing
+    if (playingSection < 0)
+    {
+        compiled = pendingTransaction->pattern;
+        staleFields = 0;
+        compiledUserScale = pendingTransaction->userScale.get();
+        compiledGroove = pendingTransaction->groove.get();
+        compiledKick = pendingTransaction->kick.get();
+        liveKickApplied = false;
+        rebindUserScale();
+
+        drawnPitches = compiled.pitches;
+        voiceLineDirty = true;
+        phrase.invalidate();
+    }
+
+    appliedTransactionSerial = pendingTransaction->serial;
+    pendingTransaction = nullptr;
+    MB_TRACE_INSTANT("audio", "transaction", static_cast<int>(appliedTransactionSerial));
+
+    syncMorph();
+}
+
+//==============================================================================
+void BasslineGeneratorProcessor::processBlock(juce::AudioBuffer<float>& buffer,
+                                               juce::MidiBuffer& midiMessages)
+{
+    BlockStats::BlockScope statsScope(blockStats, midiMessages, buffer.getNumSamples());
+    MB_TRACE_THREAD("Audio");
+    MB_TRACE_SCOPE("audio", "processBlock");
+
+    auto callbackTimeMs = juce::Time::getMillisecondCounterHiRes();
+    auto numSamples = buffer.getNumSamples();
+
+    // Incoming notes only drive key/chord follow or the live kick, and clock messages the MIDI
+    // clock; nothing is passed through
+    numPendingKicks = 0;
+    for (const auto metadata : midiMessages)
+        handleIncomingMessage(metadata.getMessage(), metadata.samplePosition);
+
+    // Output goes to the larger of the reserved buffer and the host's, and is swapped into the
+    // host's at the end. A host that hands the same buffer back gets the reserved storage on
+    // alternate blocks, so nothing grows on the audio thread.
+    midiMessages.clear();
+    if (midiMessages.data.getNumAllocated() > blockMidiOut.data.getNumAllocated())
+        midiMessages.swapWith(blockMidiOut);
+    blockMidiOut.clear();
+
+    if (isNonRealtime())
+        voiceLeadingWorker.waitForPending();
+
+    // VST3/AU deliver parameter changes at the block start, so one sync covers the block
+    currentHarmony = harmony.acquire();
+    currentUserScale = userScale.acquire();
+    currentGroove = groove.acquire();
+    currentKick = kickPattern.acquire();
+    currentVoiceLine = voiceLine.acquire();
+    currentMorphSlots = morphSlots.acquire();
+    currentArrangement = arrangements.acquire();
+    syncBlock();
+
+    // Get host playhead info
+    Transport transport;
+    bool hasHostTransport = false;
+    if (auto* playHead = getPlayHead())
+    {
+        if (auto posInfo = playHead->getPosition())
+        {
+            hasHostTransport = true;
+            transport.isPlaying = posInfo->getIsPlaying();
+            transport.bpm = posInfo->getBpm().orFallback(120.0);
+            transport.ppqPosition = posInfo->getPpqPosition().orFallback(0.0);
+            transport.timeSigNumerator = posInfo->getTimeSignature().orFallback(
+                juce::AudioPlayHead::TimeSignature{4, 4}).numerator;
+        }
+    }
+
+    if (resolveTransport(transport, hasHostTransport, numSamples))
+    {
+        // Only generate when playing
+        if (transport.isPlaying)
+            renderRange(transport, 0, numSamples, blockMidiOut);
+        else
+            stopPlayback(blockMidiOut);
+    }
+
+    midiMessages.swapWith(blockMidiOut);
+    samplesProcessed += numSamples;
+
+    // Standalone: the preview synth plays what was just generated (nothing else has an output)
+    buffer.clear();
+    if (getTotalNumOutputChannels() > 0 && previewSynthParam->load() >= 0.5f)
+    {
+        previewSynth.setBendRange(static_cast<int>(bendRangeParam->load()));
+        previewSynth.render(buffer, midiMessages, 0, numSamples);
+    }
+    else
+    {
+        previewSynth.reset();
+    }
+
+    // Standalone: the scheduler thread sends each event to the MIDI device at its own time
+    if (midiOutput.isActive() && !isNonRealtime())
+        midiOutput.scheduleBlock(midiMessages, callbackTimeMs, currentSampleRate, numSamples);
+}
+
+bool BasslineGeneratorProcessor::resolveTransport(Transport& transport, bool hasHostTransport, int numSamples)
+{
+    auto source = static_cast<int>(clockSourceParam->load());
+
+    if (source == clockHost && hasHostTransport)
+        return true;
+
+    if (source == clockMidi)
+    {
+        transport.isPlaying = midiClockIn.isPlaying();
+        transport.bpm = midiClockIn.getBpm();
+        transport.ppqPosition = midiClockIn.getPpqAt(samplesProcessed);
+        transport.timeSigNumerator = static_cast<int>(clockTimeSigParam->load());
+        return true;
+    }
+
+    // A plugin without a timeline has nothing to follow; the Standalone app never has a
+    // playhead, so it falls back to the internal clock
+    if (source == clockHost && wrapperType != wrapperType_Standalone)
+        return false;
+
+    auto position = internalClock.advance(clockRunningParam->load() >= 0.5f, clockTempoParam->load(),
+                                          numSamples, currentSampleRate);
+    transport.isPlaying = position.isPlaying;
+    transport.bpm = position.bpm;
+    transport.ppqPosition = position.ppqPosition;
+    transport.timeSigNumerator = static_cast<int>(clockTimeSigParam->load());
+    return true;
+}
+
+void BasslineGeneratorProcessor::stopPlayback(juce::MidiBuffer& midiMessages)
+{
+    // Nothing is playing, so there's no boundary to wait for
+    if (pendingTransaction != nullptr)
+        applyTransaction();
+
+    // Send note-off if we were playing a note
+    if (activeNote >= 0)
+        releaseActiveNote(0, midiMessages);
+    burstIndex = CompiledPattern::maxRatchets; // Drop the rest of a ratchet
+    numPendingKicks = 0;
+    liveKickFit = {};
+    controlLanes.stop([&](const juce::MidiMessage& message) { midiMessages.addEvent(message, 0); });
+    noteChannels.reset(); // MPE is configured again on the next start
+    if (lastClockTick >= 0)
+    {
+        midiMessages.addEvent(juce::MidiMessage::midiStop(), 0);
+        lastClockTick = -1;
+    }
+
+    lastPpqPosition = -1;
+    currentStep = -1;
+    patternState.isPlaying.store(false);
+}
+
+void BasslineGeneratorProcessor::renderRange(const Transport& transport, int startSample, int endSample,
+                                             juce::MidiBuffer& midiMessages)
+{
+    if (!isNonRealtime())
+        patternState.isPlaying.store(true);
+
+    recordKicks(transport);
+
+    // Timing is worked out again whenever a transaction swaps the pattern mid-range
+    int sample = startSample;
+    while (sample < endSample)
+    {
+        auto timing = getRangeTiming(transport);
+
+        if (!timing.publishState)
+        {
+            sample = renderOffline(transport, timing, sample, endSample, midiMessages);
+            continue;
+        }
+
+        while (sample < endSample && renderSample(transport, timing, sample, midiMessages))
+            ++sample;
+    }
+}
+
+BasslineGeneratorProcessor::RangeTiming BasslineGeneratorProcessor::getRangeTiming(const Transport& transport)
+{
+    RangeTiming timing;
+    timing.publishState = !isNonRealtime();
+
+    // Calculate timing values
+    timing.numSteps = compiled.steps;
+    timing.beatsPerBar = transport.timeSigNumerator;
+    timing.ppqPerStep = timing.beatsPerBar / timing.numSteps; // Subdivide bar into steps
+    timing.ppqPerSample = transport.bpm / (currentSampleRate * 60.0);
+    timing.samplesPerStep = timing.ppqPerStep / timing.ppqPerSample;
+
+    // Swing and groove are compiled into each step's notes; steps just start early enough
+    // for the earliest of them
+    timing.leadPpq = compiled.timingLead * timing.ppqPerStep;
+
+    // Get note length
+    noteDurationSamples = static_cast<int>(timing.samplesPerStep * compiled.noteLength);
+    controlLanes.prepare(getControlLaneSettings(), currentSampleRate);
+    noteChannels.prepare(getNoteChannelSettings());
+
+    // Clock out, except when we're following incoming clock
+    timing.sendClock = sendMidiClockParam->load() >= 0.5f && static_cast<int>(clockSourceParam->load()) != clockMidi;
+    return timing;
+}
+
+bool BasslineGeneratorProcessor::renderSample(const Transport& transport, const RangeTiming& timing, int sample,
+                                              juce::MidiBuffer& midiMessages)
+{
+    int numSteps = timing.numSteps;
+    double beatsPerBar = timing.beatsPerBar;
+    double ppqPerStep = timing.ppqPerStep;
+
+    // Calculate PPQ at this sample
+    double samplePpq = transport.ppqPosition + sample * timing.ppqPerSample;
+
+    if (timing.sendClock)
+        addClockTick(samplePpq, sample, midiMessages);
+
+    // Determine which step we're on; each step's notes are offsets from its start
+    double stepPpq = samplePpq + timing.leadPpq;
+    double barPosition = std::fmod(stepPpq, beatsPerBar);
+
+    int step = static_cast<int>(barPosition / ppqPerStep) % numSteps;
+    int barIndex = static_cast<int>(std::floor(stepPpq / beatsPerBar));
+
+    // A committed transaction takes over on its boundary; the step is then played from the
+    // new pattern, on timing worked out again from it
+    if (step != currentStep && pendingTransaction != nullptr && transactionDue(step))
+    {
+        applyTransaction();
+        currentStep = -1;
+        return false;
+    }
+
+    // Song mode changes pattern on the bar line, or wherever a seek lands, the same way
+    if (step != currentStep && barIndex != playingBar)
+    {
+        playingBar = barIndex;
+        if (loadSection(barIndex))
+        {
+            currentStep = -1;
+            return false;
+        }
+    }
+
+    // Detect step change (new step triggered)
+    if (step != currentStep)
+    {
+        currentStep = step;
+        if (timing.publishState)
+        {
+            patternState.currentStep.store(step);
+
+            auto cycleSteps = compiled.cycleSteps();
+            auto globalStep = static_cast<int64_t>(juce::jmax(barIndex, 0)) * numSteps + step;
+            patternState.cycleStep.store(static_cast<int>(globalStep % cycleSteps));
+            patternState.cycleLength.store(static_cast<int>(cycleSteps));
+        }
+        MB_TRACE_INSTANT("audio", "stepChange", step);
+
+        // This bar of the phrase; only computed the first time it is reached
+        applyLiveKick(barIndex);
+        const auto& bar = phrase.bar(barIndex);
+
+        // Check if this step should trigger a note (Euclidean pattern, then the step edits)
+        bool shouldTrigger = stepTriggers(bar, step);
+
+        // A note held for a slide that isn't coming after all (the pattern changed since) ends
+        if (holdForSlide && !(shouldTrigger && compiled.bursts[static_cast<size_t>(step)].slide))
+            releaseActiveNote(sample, midiMessages);
+
+        if (shouldTrigger)
+        {
+            // The step's notes are played below as their offsets come round, the first of
+            // them on this sample unless micro-timing lays it back
+            burst = compiled.bursts[static_cast<size_t>(step)];
+            burstIndex = 0;
+            burstPitch = applyFollow(bar.pitches[static_cast<size_t>(step)], stepPpq - barPosition + step * ppqPerStep);
+            burstVelocity = bar.velocities[static_cast<size_t>(step)];
+            burstAccent = bar.accented(step);
+            burstShift = bar.shifts[static_cast<size_t>(step)];
+            burstSamplesPerStep = timing.samplesPerStep;
+            samplesUntilRetrigger = juce::roundToInt((burst.offsets[0] + burstShift) * burstSamplesPerStep) + 1;
+        }
+
+        blockStats.markStepChange();
+    }
+
+    // Curve points, then the next note of the burst (which may restart the curves)
+    controlLanes.step([&](const juce::MidiMessage& message) { midiMessages.addEvent(message, sample); });
+
+    if (burstIndex < burst.count && --samplesUntilRetrigger <= 0)
+        playBurstNote(sample, midiMessages);
+
+    // Handle note-off timing
+    if (activeNote >= 0 && !holdForSlide)
+    {
+        samplesUntilNoteOff--;
+        if (samplesUntilNoteOff <= 0)
+            releaseActiveNote(sample, midiMessages);
+    }
+
+    return true;
+}
+
+void BasslineGeneratorProcessor::playBurstNote(int sample, juce::MidiBuffer& midiMessages)
+{
+    auto index = static_cast<size_t>(burstIndex++);
+
+    // Rolls ramp from (or to) silence, but a note-on of velocity 0 would be a note-off
+    int velocity = juce::jlimit(1, 127, juce::roundToInt(static_cast<float>(burstVelocity) * burst.gains[index]));
+
+    // A slide is played legato: the note before was held into this step, and ends once the new
+    // one has started
+    bool slide = index == 0 && burst.slide;
+    bool legato = slide && activeNote >= 0 && activeNote != burstPitch;
+
+    // Send note-off for previous note if active
+    if (activeNote >= 0 && !legato)
+        releaseActiveNote(sample, midiMessages);
+
+    // The channel (and in MPE the zone setup, once), then the lanes' start values, all ahead
+    // of the note
+    auto emit = [&](const juce::MidiMessage& message) { midiMessages.addEvent(message, sample); };
+    auto role = NoteChannels::roleOf(static_cast<int>(index), slide, burstAccent);
+    int channel = noteChannels.noteOn(burstPitch, role, static_cast<int>(bendRangeParam->load()), emit);
+    controlLanes.noteOn(channel, burstPitch, velocity, slide, compiled.glideTime, burstSamplesPerStep, emit);
+
+    // Send note-on
+    midiMessages.addEvent(
+        juce::MidiMessage::noteOn(channel, burstPitch, (juce::uint8)velocity),
+        sample);
+    MB_TRACE_INSTANT("audio", "noteOn", burstPitch);
+
+    if (legato)
+        releaseActiveNote(sample, midiMessages);
+
+    activeNote = burstPitch;
+    activeChannel = channel;
+    samplesUntilNoteOff = juce::jmax(1, static_cast<int>(noteDurationSamples * burst.length));
+    holdForSlide = burstIndex >= burst.count && nextStepSlides();
+
+    // Offsets are rounded from the step start, so a burst doesn't drift; at least a sample
+    // apart, so a block never holds more than a note-on and note-off per sample
+    if (burstIndex < burst.count)
+        samplesUntilRetrigger = juce::jmax(1, juce::roundToInt((burst.offsets[index + 1] + burstShift) * burstSamplesPerStep)
+                                                  - juce::roundToInt((burst.offsets[index] + burstShift) * burstSamplesPerStep));
+}
+
+void BasslineGeneratorProcessor::releaseActiveNote(int sample, juce::MidiBuffer& midiMessages)
+{
+    midiMessages.addEvent(
+        juce::MidiMessage::noteOff(activeChannel, activeNote), sample);
+    MB_TRACE_INSTANT("audio", "noteOff", activeNote);
+    noteChannels.noteOff(activeChannel, activeNote);
+    activeNote = -1;
+    holdForSlide = false;
+}
+
+bool BasslineGeneratorProcessor::stepTriggers(const PhraseGenerator::Bar& bar, int step) const noexcept
+{
+    bool triggers = bar.triggers(step);
+    if (hasManualToggles.load() && step < 16 && manualToggles[static_cast<size_t>(step)].load())
+        triggers = !triggers;
+    return triggers;
+}
+
+// Whether the step after the current one plays and slides in, in which case the current step's
+// last note is held until the slide starts. The exporter holds it the same way.
+bool BasslineGeneratorProcessor::nextStepSlides() noexcept
+{
+    int step = currentStep + 1;
+    int barIndex = playingBar;
+    if (step >= compiled.steps)
+    {
+        step = 0;
+        ++barIndex;
+    }
+
+    return compiled.bursts[static_cast<size_t>(step)].slide && stepTriggers(phrase.bar(barIndex), step);
+}
+
+// Same output as the per-sample walk, but only the samples where something can change are
+// rendered: step boundaries, clock ticks, ratchets and the pending note-off. Each
+// candidate is taken a sample early and re-checked, so rounding never skips a change.
+int BasslineGeneratorProcessor::renderOffline(const Transport& transport, const RangeTiming& timing,
+                                              int startSample, int endSample, juce::MidiBuffer& midiMessages)
+{
+    int sample = startSample;
+    while (sample < endSample)
+    {
+        if (!renderSample(transport, timing, sample, midiMessages))
+            return sample;
+
+        int next = nextEventSample(transport, timing, sample);
+
+        // The per-sample walk counts the held note and the next ratchet down on every sample we skip
+        int skipped = juce::jmin(next, endSample) - sample - 1;
+        if (activeNote >= 0 && !holdForSlide)
+            samplesUntilNoteOff -= skipped;
+        if (burstIndex < burst.count)
+            samplesUntilRetrigger -= skipped;
+        controlLanes.skip(skipped);
+
+        sample = next;
+    }
+
+    return endSample;
+}
+
+int BasslineGeneratorProcessor::nextEventSample(const Transport& transport, const RangeTiming& timing, int sample) const
+{
+    double ppq = transport.ppqPosition + sample * timing.ppqPerSample;
+    double barPosition = std::fmod(ppq + timing.leadPpq, timing.beatsPerBar);
+
+    // Next step start
+    double boundary = (std::floor(barPosition / timing.ppqPerStep) + 1.0) * timing.ppqPerStep;
+    double nextPpq = ppq - barPosition + boundary;
+    if (timing.sendClock)
+    {
+        double nextTick = (std::floor(ppq * MidiClockInput::ticksPerQuarter) + 1.0) / MidiClockInput::ticksPerQuarter;
+        nextPpq = juce::jmin(nextPpq, nextTick);
+    }
+
+    // First sample at or past the boundary, less one for rounding; capped so it can't overflow
+    double samplesAway = std::ceil((nextPpq - ppq) / timing.ppqPerSample) - 1.0;
+    int next = sample + static_cast<int>(juce::jmin(samplesAway, 1.0e6));
+
+    if (activeNote >= 0 && !holdForSlide)
+        next = juce::jmin(next, sample + samplesUntilNoteOff);
+    if (burstIndex < burst.count)
+        next = juce::jmin(next, sample + samplesUntilRetrigger);
+    if (controlLanes.untilNext() != CurveLane::idle)
+        next = juce::jmin(next, sample + controlLanes.untilNext());
+
+    return juce::jmax(next, sample + 1);
+}
+
+//==============================================================================
+// Key/chord follow
+
+// 24 ticks per quarter; the first tick after a stop is preceded by a start
+// (or a song position and continue when starting mid-song)
+void BasslineGeneratorProcessor::addClockTick(double ppq, int sample, juce::MidiBuffer& midiMessages)
+{
+    auto tick = static_cast<int64_t>(std::floor(ppq * MidiClockInput::ticksPerQuarter));
+    if (tick == lastClockTick)
+        return;
+
+    if (lastClockTick < 0)
+    {
+        if (tick <= 0)
+        {
+            midiMessages.addEvent(juce::MidiMessage::midiStart(), sample);
+        }
+        else
+        {
+            midiMessages.addEvent(juce::MidiMessage::songPositionPointer(static_cast<int>(tick / 6)), sample);
+            midiMessages.addEvent(juce::MidiMessage::midiContinue(), sample);
+        }
+    }
+
+    midiMessages.addEvent(juce::MidiMessage::midiClock(), sample);
+    lastClockTick = tick;
+}
+
+void BasslineGeneratorProcessor::handleIncomingMessage(const juce::MidiMessage& message, int samplePosition)
+{
+    if (midiClockIn.handleMessage(message, samplesProcessed + samplePosition))
+        return;
+
+    if (!message.isNoteOnOrOff() || !handleKickNote(message.getChannel(), message.isNoteOn(), samplePosition))
+        handleFollowMessage(message);
+}
+
+void BasslineGeneratorProcessor::handleFollowMessage(const juce::MidiMessage& message)
+{
+    if (message.isNoteOn())
+        handleFollowNote(message.getChannel(), message.getNoteNumber(), true);
+    else if (message.isNoteOff())
+        handleFollowNote(message.getChannel(), message.getNoteNumber(), false);
+    else if (message.isAllNotesOff() || message.isAllSoundOff())
+        heldNotes.clear();
+}
+
+// Notes on the kick channel are the live kick and nothing else
+bool BasslineGeneratorProcessor::handleKickNote(int channel, bool isNoteOn, int samplePosition) noexcept
+{
+    int kickChannel = static_cast<int>(kickChannelParam->load());
+    if (kickChannel == 0 || channel != kickChannel)
+        return false;
+
+    if (isNoteOn && numPendingKicks < static_cast<int>(pendingKicks.size()))
+        pendingKicks[static_cast<size_t>(numPendingKicks++)] = samplePosition;
+    return true;
+}
+
+// Onsets go to the nearest sixteenth; one just before a bar line is the next bar's downbeat
+void BasslineGeneratorProcessor::recordKicks(const Transport& transport) noexcept
+{
+    double ppqPerSample = transport.bpm / (currentSampleRate * 60.0);
+    double beatsPerBar = transport.timeSigNumerator;
+    double slotPpq = beatsPerBar / KickPattern::slots;
+
+    for (int i = 0; i < numPendingKicks; ++i)
+    {
+        double ppq = transport.ppqPosition + pendingKicks[static_cast<size_t>(i)] * ppqPerSample;
+        auto slot = static_cast<int64_t>(std::llround(ppq / slotPpq));
+        auto barIndex = static_cast<int>(std::floor(static_cast<double>(slot) / KickPattern::slots));
+
+        auto& kickBar = liveKicks[static_cast<size_t>(barIndex & 1)];
+        if (kickBar.bar != barIndex)
+            kickBar = { barIndex, 0 };
+        kickBar.mask |= static_cast<uint16_t>(1u << (slot - static_cast<int64_t>(barIndex) * KickPattern::slots));
+    }
+
+    numPendingKicks = 0;
+}
+
+// Each bar is fitted to the kick of the bar before it, the nearest the kick can be known. The
+// kick is taken as the bar starts: a kick late in the bar may already be the next bar's downbeat,
+// which by parity overwrites the bar before.
+void BasslineGeneratorProcessor::applyLiveKick(int barIndex) noexcept
+{
+    if (kickChannelParam->load() < 1.0f)
+        return;
+
+    if (liveKickFit.bar != barIndex)
+    {
+        const auto& previous = liveKicks[static_cast<size_t>((barIndex - 1) & 1)];
+        liveKickFit = { barIndex, previous.bar == barIndex - 1 ? previous.mask : uint16_t{ 0 } };
+    }
+
+    uint16_t mask = liveKickFit.mask;
+    if (liveKickApplied && compiled.kickBars[0] == mask)
+        return;
+
+    compiled.kickBars[0] = mask;
+    compiled.numKickBars = 1;
+    liveKickApplied = true;
+    if (compiled.kickMode != 0)
+        phrase.invalidate();
+}
+
+void BasslineGeneratorProcessor::handleFollowNote(int channel, int note, bool isNoteOn)
+{
+    int followChannel = static_cast<int>(followChannelParam->load());
+    if (followChannel != 0 && channel != followChannel)
+        return;
+
+    if (isNoteOn)
+        heldNotes.noteOn(note);
+    else
+        heldNotes.noteOff(note);
+}
+
+int BasslineGeneratorProcessor::applyFollow(int pitch, double ppq)
+{
+    int mode = static_cast<int>(followModeParam->load());
+
+    if (mode == followHarmonyTrack)
+    {
+        if (currentHarmony == nullptr)
+            return pitch;
+
+        auto* region = harmonyCursor.find(*currentHarmony, ppq);
+        return region != nullptr ? region->apply(pitch, compiled.rootNote) : pitch;
+    }
+
+    int bassNote = heldNotes.getBassNote();
+    if (mode == followOff || bassNote < 0)
+        return pitch;
+
+    // Move the line to the played key, staying in the register set by the root parameter
+    pitch += ChordQuantiser::nearestTranspose(compiled.rootNote, bassNote);
+
+    if (mode == followChord)
+        pitch = ChordQuantiser::quantise(pitch, heldNotes.getChordMask());
+
+    return juce::jlimit(0, 127, pitch);
+}
+
+//==============================================================================
+// Harmony track
+
+bool BasslineGeneratorProcessor::loadHarmonyFile(const juce::File& file)
+{
+    juce::MemoryBlock data;
+    if (!file.loadFileAsData(data) || !loadHarmonyData(data))
+        return false;
+
+    apvts.state.setProperty("harmonyMidi", data.toBase64Encoding(), nullptr);
+    apvts.state.setProperty("harmonyName", file.getFileNameWithoutExtension(), nullptr);
+    return true;
+}
+
+bool BasslineGeneratorProcessor::loadHarmonyData(const juce::MemoryBlock& midiData)
+{
+    // Every instance restoring the same progression shares one parsed track
+    std::string key(static_cast<const char*>(midiData.getData()), midiData.getSize());
+    auto track = sharedResources->harmonyTracks.getOrCreate(key, [&]() -> std::shared_ptr<const HarmonyTrack>
+    {
+        juce::MemoryInputStream stream(midiData, false);
+        juce::MidiFile midiFile;
+        if (!midiFile.readFrom(stream))
+            return nullptr;
+
+        return HarmonyTrack::fromMidiFile(midiFile);
+    });
+
+    if (track == nullptr)
+        return false;
+
+    harmony.publish(std::move(track));
+    return true;
+}
+
+void BasslineGeneratorProcessor::clearHarmony()
+{
+    harmony.publish(nullptr);
+    apvts.state.removeProperty("harmonyMidi", nullptr);
+    apvts.state.removeProperty("harmonyName", nullptr);
+}
+
+juce::String BasslineGeneratorProcessor::getHarmonyName() const
+{
+    return apvts.state.getProperty("harmonyName").toString();
+}
+
+//==============================================================================
+// Groove template
+
+bool BasslineGeneratorProcessor::loadGrooveFile(const juce::File& file)
+{
+    juce::MemoryBlock data;
+    if (!file.loadFileAsData(data) || !loadGrooveData(data))
+        return false;
+
+    apvts.state.setProperty("grooveMidi", data.toBase64Encoding(), nullptr);
+    apvts.state.setProperty("grooveName", file.getFileNameWithoutExtension(), nullptr);
+
+    // Song sections were compiled with the old groove
+    publishArrangement();
+    return true;
+}
+
+bool BasslineGeneratorProcessor::loadGrooveData(const juce::MemoryBlock& midiData)
+{
+    std::string key(static_cast<const char*>(midiData.getData()), midiData.getSize());
+    auto loaded = sharedResources->grooves.getOrCreate(key, [&]() -> std::shared_ptr<const GrooveTemplate>
+    {
+        juce::MemoryInputStream stream(midiData, false);
+        juce::MidiFile midiFile;
+        if (!midiFile.readFrom(stream))
+            return nullptr;
+
+        return GrooveTemplate::fromMidiFile(midiFile);
+    });
+
+    if (loaded == nullptr)
+        return false;
+
+    groove.publish(std::move(loaded));
+    return true;
+}
+
+void BasslineGeneratorProcessor::clearGroove()
+{
+    groove.publish(nullptr);
+    apvts.state.removeProperty("grooveMidi", nullptr);
+    apvts.state.removeProperty("grooveName", nullptr);
+    publishArrangement();
+}
+
+juce::String BasslineGeneratorProcessor::getGrooveName() const
+{
+    return apvts.state.getProperty("grooveName").toString();
+}
+
+//==============================================================================
+// Kick pattern
+
+bool BasslineGeneratorProcessor::loadKickFile(const juce::File& file)
+{
+    juce::MemoryBlock data;
+    if (!file.loadFileAsData(data) || !loadKickData(data))
+        return false;
+
+    apvts.state.setProperty("kickMidi", data.toBase64Encoding(), nullptr);
+    apvts.state.setProperty("kickName", file.getFileNameWithoutExtension(), nullptr);
+
+    // Song sections were fitted to the old kick
+    publishArrangement();
+    return true;
+}
+
+bool BasslineGeneratorProcessor::loadKickData(const juce::MemoryBlock& midiData)
+{
+    std::string key(static_cast<const char*>(midiData.getData()), midiData.getSize());
+    auto loaded = sharedResources->kickPatterns.getOrCreate(key, [&]() -> std::shared_ptr<const KickPattern>
+    {
+        juce::MemoryInputStream stream(midiData, false);
+        juce::MidiFile midiFile;
+        if (!midiFile.readFrom(stream))
+            return nullptr;
+
+        return KickPattern::fromMidiFile(midiFile);
+    });
+
+    if (loaded == nullptr)
+        return false;
+
+    kickPattern.publish(std::move(loaded));
+    return true;
+}
+
+void BasslineGeneratorProcessor::clearKick()
+{
+    kickPattern.publish(nullptr);
+    apvts.state.removeProperty("kickMidi", nullptr);
+    apvts.state.removeProperty("kickName", nullptr);
+    publishArrangement();
+}
+
+juce::String BasslineGeneratorProcessor::getKickName() const
+{
+    return apvts.state.getProperty("kickName").toString();
+}
+
+//==============================================================================
+// Imported scales
+
+juce::StringArray BasslineGeneratorProcessor::getScaleNames()
+{
+    juce::StringArray names;
+    for (const auto& scale : ScaleEngine::builtInScales)
+        names.add(scale.name);
+
+    names.add("User (Scala)");
+    return names;
+}
+
+bool BasslineGeneratorProcessor::loadScalaFile(const juce::File& file)
+{
+    auto text = file.loadFileAsString();
+    auto scl = apvts.state.getProperty("scalaScl").toString();
+    auto kbm = apvts.state.getProperty("scalaKbm").toString();
+    auto name = apvts.state.getProperty("scalaName").toString();
+
+    // A .kbm remaps the scale already loaded; a new .scl drops the old mapping
+    if (file.hasFileExtension("kbm"))
+    {
+        kbm = text;
+        name = name.upToFirstOccurrenceOf(" / ", false, false) + " / " + file.getFileNameWithoutExtension();
+    }
+    else
+    {
+        scl = text;
+        kbm = {};
+        name = file.getFileNameWithoutExtension();
+    }
+
+    if (!loadScalaText(scl, kbm))
+        return false;
+
+    apvts.state.setProperty("scalaScl", scl, nullptr);
+    apvts.state.setProperty("scalaKbm", kbm, nullptr);
+    apvts.state.setProperty("scalaName", name, nullptr);
+    return true;
+}
+
+bool BasslineGeneratorProcessor::loadScalaText(const juce::String& scl, const juce::String& kbm)
+{
+    // Tables for every root and octave range are built here, off the audio thread, and only
+    // by the first instance to load this scale and mapping
+    auto key = scl.toStdString() + '\0' + kbm.toStdString();
+    auto scale = sharedResources->userScales.getOrCreate(key, [&]() -> std::shared_ptr<const ScaleEngine::UserScale>
+    {
+        auto definition = ScalaImport::parseScl(scl);
+        if (definition.has_value() && kbm.isNotEmpty())
+            definition = ScalaImport::applyKbm(*definition, kbm);
+
+        if (!definition.has_value())
+            return nullptr;
+
+        return std::make_shared<const ScaleEngine::UserScale>(*definition);
+    });
+
+    if (scale == nullptr)
+        return false;
+
+    userScale.publish(std::move(scale));
+    voiceLeadingWorker.inputsChanged();
+    return true;
+}
+
+void BasslineGeneratorProcessor::clearUserScale()
+{
+    userScale.publish(nullptr);
+    voiceLeadingWorker.inputsChanged();
+    apvts.state.removeProperty("scalaScl", nullptr);
+    apvts.state.removeProperty("scalaKbm", nullptr);
+    apvts.state.removeProperty("scalaName", nullptr);
+}
+
+//==============================================================================
+// MIDI output device (Standalone)
+
+bool BasslineGeneratorProcessor::setMidiOutputDevice(const juce::String& identifier)
+{
+    if (identifier.isEmpty())
+    {
+        midiOutput.setSink(nullptr);
+        apvts.state.removeProperty("midiOutputDevice", nullptr);
+        return true;
+    }
+
+    auto device = juce::MidiOutput::openDevice(identifier);
+    if (device == nullptr)
+        return false;
+
+    midiOutput.setSink(std::make_unique<MidiOutputScheduler::DeviceSink>(std::move(device)));
+    apvts.state.setProperty("midiOutputDevice", identifier, nullptr);
+    return true;
+}
+
+juce::String BasslineGeneratorProcessor::getMidiOutputDevice() const
+{
+    return apvts.state.getProperty("midiOutputDevice").toString();
+}
+
+juce::String BasslineGeneratorProcessor::getUserScaleName() const
+{
+    return apvts.state.getProperty("scalaName").toString();
+}
+
+//==============================================================================
+// CLAP direct processing
+
+clap_process_status BasslineGeneratorProcessor::clap_direct_process(const clap_process* process) noexcept
+{
+    auto numSamples = static_cast<int>(process->frames_count);
+
+    clapMidiOut.clear();
+    BlockStats::BlockScope statsScope(blockStats, clapMidiOut, numSamples);
+    MB_TRACE_THREAD("Audio");
+    MB_TRACE_SCOPE("audio", "processBlock");
+
+    Transport transport;
+    const auto* clapTransport = process->transport;
+    if (clapTransport != nullptr)
+    {
+        transport.isPlaying = (clapTransport->flags & CLAP_TRANSPORT_IS_PLAYING) != 0;
+        if ((clapTransport->flags & CLAP_TRANSPORT_HAS_TEMPO) != 0)
+            transport.bpm = clapTransport->tempo;
+        if ((clapTransport->flags & CLAP_TRANSPORT_HAS_BEATS_TIMELINE) != 0)
+            transport.ppqPosition = static_cast<double>(clapTransport->song_pos_beats) / static_cast<double>(CLAP_BEATTIME_FACTOR);
+        if ((clapTransport->flags & CLAP_TRANSPORT_HAS_TIME_SIGNATURE) != 0)
+            transport.timeSigNumerator = clapTransport->tsig_num;
+    }
+
+    if (isNonRealtime())
+        voiceLeadingWorker.waitForPending();
+
+    // Picks up anything the editor changed since the last block
+    currentHarmony = harmony.acquire();
+    currentUserScale = userScale.acquire();
+    currentGroove = groove.acquire();
+    currentKick = kickPattern.acquire();
+    currentVoiceLine = voiceLine.acquire();
+    currentMorphSlots = morphSlots.acquire();
+    currentArrangement = arrangements.acquire();
+    syncBlock();
+
+    // Clock messages have to be seen before the transport is resolved
+    const auto* in = process->in_events;
+    auto numEvents = in->size(in);
+
+    for (uint32_t i = 0; i < numEvents; ++i)
+    {
+        const auto* header = in->get(in, i);
+        if (header->space_id == CLAP_CORE_EVENT_SPACE_ID && header->type == CLAP_EVENT_MIDI)
+        {
+            const auto* midi = reinterpret_cast<const clap_event_midi*>(header);
+            auto message = clapMidiMessage(*midi);
+            if (!message.isNoteOnOrOff())
+                midiClockIn.handleMessage(message, samplesProcessed + header->time);
+        }
+    }
+
+    // Without a transport there is no timeline to follow (same as a missing playhead)
+    if (!resolveTransport(transport, clapTransport != nullptr, numSamples))
+    {
+        samplesProcessed += numSamples;
+        return CLAP_PROCESS_CONTINUE;
+    }
+
+    // Render up to each parameter event, apply it, carry on from there
+    int renderedUpTo = 0;
+    numPendingKicks = 0;
+
+    for (uint32_t i = 0; i < numEvents; ++i)
+    {
+        const auto* header = in->get(in, i);
+        if (header->space_id != CLAP_CORE_EVENT_SPACE_ID)
+            continue;
+
+        if (header->type == CLAP_EVENT_NOTE_ON || header->type == CLAP_EVENT_NOTE_OFF)
+        {
+            // CLAP channels are 0-based, -1 means any channel
+            const auto* note = reinterpret_cast<const clap_event_note*>(header);
+            auto channel = note->channel < 0 ? 0 : note->channel + 1;
+            bool isNoteOn = header->type == CLAP_EVENT_NOTE_ON;
+            if (!handleKickNote(channel, isNoteOn, static_cast<int>(header->time)))
+                handleFollowNote(channel, note->key, isNoteOn);
+            continue;
+        }
+
+        if (header->type == CLAP_EVENT_MIDI)
+        {
+            const auto* midi = reinterpret_cast<const clap_event_midi*>(header);
+            auto message = clapMidiMessage(*midi);
+            if (!message.isNoteOnOrOff() || !handleKickNote(message.getChannel(), message.isNoteOn(), static_cast<int>(header->time)))
+                handleFollowMessage(message);
+            continue;
+        }
+
+        if (header->type != CLAP_EVENT_PARAM_VALUE)
+            continue;
+
+        auto eventSample = juce::jlimit(renderedUpTo, numSamples, static_cast<int>(header->time));
+        if (transport.isPlaying && eventSample > renderedUpTo)
+        {
+            renderRange(transport, renderedUpTo, eventSample, clapMidiOut);
+            renderedUpTo = eventSample;
+        }
+
+        applyClapParameterEvent(*reinterpret_cast<const clap_event_param_value*>(header));
+    }
+
+    if (transport.isPlaying)
+        renderRange(transport, renderedUpTo, numSamples, clapMidiOut);
+    else
+        stopPlayback(clapMidiOut);
+
+    samplesProcessed += numSamples;
+    pushClapMidiEvents(clapMidiOut, process->out_events);
+    return CLAP_PROCESS_CONTINUE;
+}
+
+// Sized by its status byte: clock ticks, start and stop are one byte, program changes and
+// channel pressure two
+juce::MidiMessage BasslineGeneratorProcessor::clapMidiMessage(const clap_event_midi& midi)
+{
+    return juce::MidiMessage(midi.data, juce::MidiMessage::getMessageLengthFromFirstByte(midi.data[0]));
+}
+
+// Audio thread: no listener is called from here, as they post messages and take locks
+void BasslineGeneratorProcessor::applyClapParameterEvent(const clap_event_param_value& event)
+{
+    auto found = std::lower_bound(clapParameters.begin(), clapParameters.end(), event.param_id,
+                                  [](const ClapParameter& entry, clap_id id) { return entry.id < id; });
+    if (found == clapParameters.end() || found->id != event.param_id)
+        return;
+
+    // clap-juce-extensions exposes parameters normalised to 0..1
+    auto* parameter = found->parameter;
+    auto normalised = static_cast<float>(event.value);
+    parameter->setValue(normalised);
+    found->value->store(parameter->convertFrom0to1(parameter->getValue()));
+    syncParameter(*parameter);
+
+    auto index = parameter->getParameterIndex();
+    if (isVoiceLeadingInput(index))
+        voiceLeadingWorker.inputsChanged();
+    clapAutomated[static_cast<size_t>(index / 64)].fetch_or(uint64_t { 1 } << (index % 64), std::memory_order_release);
+}
+
+// The raw value is already current, so the state tree is written here rather than through
+// the tree's own parameter listener, which only passes on a change
+void BasslineGeneratorProcessor::timerCallback()
+{
+    for (size_t word = 0; word < clapAutomated.size(); ++word)
+    {
+        auto bits = clapAutomated[word].exchange(0, std::memory_order_acquire);
+        for (int bit = 0; bits != 0; ++bit, bits >>= 1)
+        {
+            if ((bits & 1) == 0)
+                continue;
+
+            auto* parameter = dynamic_cast<juce::RangedAudioParameter*>(getParameters()[static_cast<int>(word) * 64 + bit]);
+            if (parameter == nullptr)
+                continue;
+
+            apvts.state.getChildWithProperty("id", parameter->paramID)
+                .setProperty("value", parameter->convertFrom0to1(parameter->getValue()), nullptr);
+            parameter->sendValueChangedMessageToListeners(parameter->getValue());
+        }
+    }
+}
+
+void BasslineGeneratorProcessor::pushClapMidiEvents(const juce::MidiBuffer& midiMessages, const clap_output_events* out)
+{
+    for (const auto metadata : midiMessages)
+    {
+        if (metadata.numBytes > 3)
+            continue;
+
+        clap_event_midi event {};
+        event.header.size = sizeof(clap_event_midi);
+        event.header.time = static_cast<uint32_t>(metadata.samplePosition);
+        event.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+        event.header.type = CLAP_EVENT_MIDI;
+        event.header.flags = 0;
+        event.port_index = 0;
+        std::copy(metadata.data, metadata.data + metadata.numBytes, event.data);
+
+        out->try_push(out, &event.header);
+    }
+}
+
+//==============================================================================
+juce::AudioProcessorEditor* BasslineGeneratorProcessor::createEditor()
+{
+    return new BasslineGeneratorEditor(*this);
+}
+
+//==============================================================================
+void BasslineGeneratorProcessor::getStateInformation(juce::MemoryBlock& destData)
+{
+    auto state = apvts.copyState();
+    state.appendChild(history.toValueTree(), nullptr);
+
+    juce::ValueTree slots("MorphSlots");
+    slots.appendChild(storedPatternToValueTree("A", morphSlotValues[0]), nullptr);
+    slots.appendChild(storedPatternToValueTree("B", morphSlotValues[1]), nullptr);
+    state.appendChild(slots, nullptr);
+
+    juce::ValueTree chain("Chain");
+    for (const auto& section : chainSections)
+        chain.appendChild(storedPatternToValueTree("Section", section.values).setProperty("bars", section.bars, nullptr), nullptr);
+    state.appendChild(chain, nullptr);
+    std::unique_ptr<juce::XmlElement> xml(state.createXml());
+    copyXmlToBinary(*xml, destData);
+}
+
+void BasslineGeneratorProcessor::setStateInformation(const void* data, int sizeInBytes)
+{
+    std::unique_ptr<juce::XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
+    if (xml != nullptr && xml->hasTagName(apvts.state.getType()))
+    {
+        auto newState = juce::ValueTree::fromXml(*xml);
+
+        // The history rides along with the state but isn't part of the parameter tree
+        auto savedHistory = newState.getChildWithName(UndoHistory::historyType);
+        newState.removeChild(savedHistory, nullptr);
+
+        // So do the morph slots and the song chain
+        auto savedSlots = newState.getChildWithName("MorphSlots");
+        newState.removeChild(savedSlots, nullptr);
+        morphSlotValues[0] = storedPatternFromValueTree(savedSlots.getChildWithName("A"));
+        morphSlotValues[1] = storedPatternFromValueTree(savedSlots.getChildWithName("B"));
+
+        auto savedChain = newState.getChildWithName("Chain");
+        newState.removeChild(savedChain, nullptr);
+        chainSections.clear();
+        for (const auto& section : savedChain)
+            chainSections.push_back({ storedPatternFromValueTree(section), juce::jlimit(1, Arrangement::maxBars, static_cast<int>(section.getProperty("bars", 1))) });
+
+        // replaceState sets the parameters one at a time; as a transaction the audio thread
+        // goes straight from the old pattern to the new one at the next step (the next bar if
+        // the step count changes), as a preset the user picks should be heard without waiting
+        ParameterChanges changes;
+        for (auto child : newState)
+        {
+            if (child.hasProperty("id") && child.hasProperty("value"))
+            {
+                child.setProperty("id", savedParameterID(child.getProperty("id").toString()), nullptr);
+                changes.set(child.getProperty("id").toString(), static_cast<float>(child.getProperty("value")));
+            }
+        }
+
+        commitTransaction(changes, TransactionBoundary::step, [&] { apvts.replaceState(newState); });
+
+        // Step edits come back from the history's current entry. Sessions from before the
+        // history was saved, or whose history no longer fits the parameters, start a fresh one.
+        if (history.fromValueTree(savedHistory, historyChunkSizes()))
+        {
+            setManualToggles(history.current()->edits);
+        }
+        else
+        {
+            clearManualToggles();
+            history.reset(captureHistoryState());
+        }
+
+        // The harmony track travels with the state as the original MIDI file
+        auto encodedHarmony = apvts.state.getProperty("harmonyMidi").toString();
+        juce::MemoryBlock harmonyData;
+        if (encodedHarmony.isEmpty() || !harmonyData.fromBase64Encoding(encodedHarmony) || !loadHarmonyData(harmonyData))
+            harmony.publish(nullptr);
+
+        // So does the groove
+        auto encodedGroove = apvts.state.getProperty("grooveMidi").toString();
+        juce::MemoryBlock grooveData;
+        if (encodedGroove.isEmpty() || !grooveData.fromBase64Encoding(encodedGroove) || !loadGrooveData(grooveData))
+            groove.publish(nullptr);
+
+        // And the kick
+        auto encodedKick = apvts.state.getProperty("kickMidi").toString();
+        juce::MemoryBlock kickData;
+        if (encodedKick.isEmpty() || !kickData.fromBase64Encoding(encodedKick) || !loadKickData(kickData))
+            kickPattern.publish(nullptr);
+
+        auto scl = apvts.state.getProperty("scalaScl").toString();
+        if (scl.isEmpty() || !loadScalaText(scl, apvts.state.getProperty("scalaKbm").toString()))
+        {
+            userScale.publish(nullptr);
+            voiceLeadingWorker.inputsChanged();
+        }
+
+        // After the scale, which stored patterns compile against
+        publishMorphSlots();
+        publishArrangement();
+
+        // Devices are only ever chosen in the Standalone app
+        if (wrapperType == wrapperType_Standalone)
+            setMidiOutputDevice(getMidiOutputDevice());
+    }
+}
+
+//==============================================================================
+// Manual pattern editing
+void BasslineGeneratorProcessor::toggleStep(int step)
+{
+    if (step >= 0 && step < 16)
+    {
+        bool currentState = manualToggles[step].load();
+        manualToggles[step].store(!currentState);
+        hasManualToggles.store(true);
+        recordHistory();
+    }
+}
+
+bool BasslineGeneratorProcessor::isStepManuallyToggled(int step) const
+{
+    if (step >= 0 && step < 16)
+        return manualToggles[step].load();
+    return false;
+}
+
+void BasslineGeneratorProcessor::clearManualToggles()
+{
+    for (auto& toggle : manualToggles)
+        toggle.store(false);
+    hasManualToggles.store(false);
+}
+
+void BasslineGeneratorProcessor::setManualToggles(uint32_t mask)
+{
+    for (size_t step = 0; step < manualToggles.size(); ++step)
+        manualToggles[step].store((mask & (1u << step)) != 0);
+    hasManualToggles.store(mask != 0);
+}
+
+//==============================================================================
+// Undo history
+
+static_assert(UndoHistory::numChunks == static_cast<int>(CompiledPattern::Field::phrase) + 1);
+
+void BasslineGeneratorProcessor::parameterValueChanged(int parameterIndex, float newValue)
+{
+    juce::ignoreUnused(newValue);
+
+    if (isVoiceLeadingInput(parameterIndex))
+        voiceLeadingWorker.inputsChanged();
+}
+
+// The rhythm, the pitch parameters and the pitch length are what the voice line reads
+bool BasslineGeneratorProcessor::isVoiceLeadingInput(int parameterIndex) const noexcept
+{
+    using Field = CompiledPattern::Field;
+    auto index = static_cast<size_t>(parameterIndex);
+    return index < fieldByParameterIndex.size()
+           && (fieldByParameterIndex[index] == static_cast<int>(Field::rhythm)
+               || fieldByParameterIndex[index] == static_cast<int>(Field::pitch)
+               || parameterIndex == pitchLengthParameterIndex);
+}
+
+void BasslineGeneratorProcessor::parameterGestureChanged(int parameterIndex, bool gestureIsStarting)
+{
+    juce::ignoreUnused(parameterIndex);
+
+    // Gestures come from the editor; a transaction ends several at once, and only the first
+    // finds anything new to record
+    if (!gestureIsStarting && juce::MessageManager::existsAndIsCurrentThread())
+        recordHistory();
+}
+
+void BasslineGeneratorProcessor::recordHistory()
+{
+    if (!restoringHistory)
+        history.record(captureHistoryState());
+}
+
+UndoHistory::State BasslineGeneratorProcessor::captureHistoryState() const
+{
+    std::array<UndoHistory::Chunk, UndoHistory::numChunks> chunks;
+
+    auto& parameters = getParameters();
+    for (size_t index = 0; index < fieldByParameterIndex.size(); ++index)
+        if (auto field = fieldByParameterIndex[index]; field >= 0)
+            if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameters[static_cast<int>(index)]))
+                chunks[static_cast<size_t>(field)].push_back(ranged->convertFrom0to1(ranged->getValue()));
+
+    UndoHistory::State state;
+    for (size_t i = 0; i < chunks.size(); ++i)
+        state.chunks[i] = std::make_shared<const UndoHistory::Chunk>(std::move(chunks[i]));
+
+    for (size_t step = 0; step < manualToggles.size(); ++step)
+        if (manualToggles[step].load())
+            state.edits |= 1u << step;
+
+    return state;
+}
+
+std::array<size_t, UndoHistory::numChunks> BasslineGeneratorProcessor::historyChunkSizes() const
+{
+    std::array<size_t, UndoHistory::numChunks> sizes {};
+    for (auto field : fieldByParameterIndex)
+        if (field >= 0)
+            ++sizes[static_cast<size_t>(field)];
+    return sizes;
+}
+
+// Walks the parameters in the same order captureHistoryState filled the chunks
+void BasslineGeneratorProcessor::restoreHistoryState(const UndoHistory::State& state)
+{
+    ParameterChanges changes;
+    std::array<size_t, UndoHistory::numChunks> next {};
+
+    auto& parameters = getParameters();
+    for (size_t index = 0; index < fieldByParameterIndex.size(); ++index)
+    {
+        auto field = fieldByParameterIndex[index];
+        auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameters[static_cast<int>(index)]);
+        if (field < 0 || ranged == nullptr)
+            continue;
+
+        const auto& chunk = *state.chunks[static_cast<size_t>(field)];
+        auto slot = next[static_cast<size_t>(field)]++;
+        if (slot < chunk.size() && chunk[slot] != ranged->convertFrom0to1(ranged->getValue()))
+            changes.set(ranged->paramID, chunk[slot]);
+    }
+
+    const juce::ScopedValueSetter<bool> restoring(restoringHistory, true);
+
+    setManualToggles(state.edits);
+    applyParameterChanges(changes, TransactionBoundary::step);
+}
+
+bool BasslineGeneratorProcessor::undo()
+{
+    auto* state = history.undo();
+    if (state != nullptr)
+        restoreHistoryState(*state);
+    return state != nullptr;
+}
+
+bool BasslineGeneratorProcessor::redo()
+{
+    auto* state = history.redo();
+    if (state != nullptr)
+        restoreHistoryState(*state);
+    return state != nullptr;
+}
+
+//==============================================================================
+// A/B morph
+
+void BasslineGeneratorProcessor::storeMorphSlot(MorphSlot slot)
+{
+    morphSlotValues[static_cast<size_t>(slot)] = capturePattern();
+    publishMorphSlots();
+}
+
+void BasslineGeneratorProcessor::clearMorphSlots()
+{
+    for (auto& values : morphSlotValues)
+        values.values.clear();
+    publishMorphSlots();
+}
+
+void BasslineGeneratorProcessor::publishMorphSlots()
+{
+    if (!hasMorphSlot(MorphSlot::a) || !hasMorphSlot(MorphSlot::b))
+    {
+        morphSlots.publish(nullptr);
+        return;
+    }
+
+    auto scale = userScale.getLatest();
+    auto pattern = std::make_unique<CompiledPattern>();
+    auto slots = std::make_shared<PatternMorph::Slots>();
+
+    compileStoredPattern(morphSlotValues[0], scale.get(), *pattern);
+    slots->a = PatternMorph::Slot::capture(*pattern);
+    compileStoredPattern(morphSlotValues[1], scale.get(), *pattern);
+    slots->b = PatternMorph::Slot::capture(*pattern);
+
+    morphSlots.publish(std::move(slots));
+}
+
+//==============================================================================
+// Stored patterns (morph slots and song sections)
+
+BasslineGeneratorProcessor::ParameterChanges BasslineGeneratorProcessor::capturePattern() const
+{
+    ParameterChanges values;
+    auto& parameters = getParameters();
+    for (size_t index = 0; index < fieldByParameterIndex.size(); ++index)
+        if (fieldByParameterIndex[index] >= 0)
+            if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameters[static_cast<int>(index)]))
+                values.set(ranged->paramID, ranged->convertFrom0to1(ranged->getValue()));
+    return values;
+}
+
+// Off the audio thread: voice leading is optimised in place, as for an export
+void BasslineGeneratorProcessor::compileStoredPattern(const ParameterChanges& stored,
+                                                      const ScaleEngine::UserScale* scale, CompiledPattern& pattern) const
+{
+    auto value = [&](const std::atomic<float>* raw, const char* parameterID)
+    {
+        for (const auto& [storedID, storedValue] : stored.values)
+            if (storedID == parameterID)
+                return storedValue;
+        return raw->load();
+    };
+
+    readPatternParameters(pattern, value);
+    GrooveTemplate::apply(groove.getLatest().get(), pattern);
+    if (kickChannelParam->load() < 1.0f)
+        KickPattern::apply(kickPattern.getLatest().get(), pattern);
+    pattern.compileAll(scale);
+
+    if (value(voiceLeadingParam, "voiceLeading") >= 0.5f)
+    {
+        auto optimiser = std::make_unique<VoiceLeadingOptimiser>();
+        optimiser->optimise(pattern, scale).applyTo(pattern);
+    }
+}
+
+// Saved as one child per pattern, a property per parameter
+juce::ValueTree BasslineGeneratorProcessor::storedPatternToValueTree(const juce::Identifier& type,
+                                                                     const ParameterChanges& stored)
+{
+    juce::ValueTree tree(type);
+    for (const auto& [parameterID, value] : stored.values)
+        tree.setProperty(parameterID, value, nullptr);
+    return tree;
+}
+
+BasslineGeneratorProcessor::ParameterChanges
+BasslineGeneratorProcessor::storedPatternFromValueTree(const juce::ValueTree& tree)
+{
+    ParameterChanges stored;
+    for (int i = 0; i < tree.getNumProperties(); ++i)
+    {
+        auto name = tree.getPropertyName(i);
+        if (name != juce::Identifier("bars"))
+            stored.set(savedParameterID(name.toString()), static_cast<float>(tree.getProperty(name)));
+    }
+    return stored;
+}
+
+// The ID a parameter saved under id has now. The scale choice grew from five scales to the
+// built-ins plus the imported one; a new ID keeps hosts from reading automation recorded
+// against the five-entry list, whose normalised values now land on other scales. Its
+// plain value, the index, still means the same scale.
+juce::String BasslineGeneratorProcessor::savedParameterID(const juce::String& id)
+{
+    return id == "scale" ? juce::String("scaleType") : id;
+}
+
+//==============================================================================
+// Song mode
+
+void BasslineGeneratorProcessor::appendChainSection(int bars)
+{
+    chainSections.push_back({ capturePattern(), juce::jlimit(1, Arrangement::maxBars, bars) });
+    publishArrangement();
+}
+
+void BasslineGeneratorProcessor::clearChain()
+{
+    chainSections.clear();
+    publishArrangement();
+}
+
+int BasslineGeneratorProcessor::getChainBars() const
+{
+    int bars = 0;
+    for (const auto& section : chainSections)
+        bars += section.bars;
+    return bars;
+}
+
+void BasslineGeneratorProcessor::publishArrangement()
+{
+    if (chainSections.empty())
+    {
+        arrangements.publish(nullptr);
+        return;
+    }
+
+    auto arrangement = std::make_shared<Arrangement>();
+    arrangement->userScale = userScale.getLatest();
+
+    auto pattern = std::make_unique<CompiledPattern>();
+    for (const auto& section : chainSections)
+    {
+        compileStoredPattern(section.values, arrangement->userScale.get(), *pattern);
+        if (!arrangement->addSection(*pattern, section.bars))
+            break;
+    }
+
+    arrangements.publish(std::move(arrangement));
 }
 
 //==============================================================================
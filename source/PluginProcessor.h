@@ -1,10 +1,32 @@
 #pragma once
 #include <juce_audio_processors/juce_audio_processors.h>
+#include <clap-juce-extensions/clap-juce-extensions.h>
 #include "generator/EuclideanRhythm.h"
 #include "generator/PitchGenerator.h"
 #include "generator/PatternState.h"
+#include "generator/CompiledPattern.h"
+#include "generator/PhraseGenerator.h"
+#include "generator/PatternMorph.h"
+#include "generator/Arrangement.h"
+#include "generator/VoiceLeadingWorker.h"
+#include "generator/HeldNotes.h"
+#include "generator/HarmonyTrack.h"
+#include "generator/GrooveTemplate.h"
+#include "generator/KickPattern.h"
+#include "generator/ControlLanes.h"
+#include "generator/NoteChannels.h"
+#include "utils/BlockStats.h"
+#include "utils/RealtimePublisher.h"
+#include "utils/TransportClock.h"
+#include "utils/MidiOutputScheduler.h"
+#include "utils/SharedResources.h"
+#include "utils/UndoHistory.h"
+#include "utils/PreviewSynth.h"
 
-class BasslineGeneratorProcessor : public juce::AudioProcessor
+class BasslineGeneratorProcessor : public juce::AudioProcessor,
+                                   public clap_juce_extensions::clap_juce_audio_processor_capabilities,
+                                   private juce::AudioProcessorParameter::Listener,
+                                   private juce::Timer
 {
 public:
     BasslineGeneratorProcessor();
@@ -14,6 +36,15 @@ public:
     void releaseResources() override;
     void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
 
+    // Offline bounces skip the per-sample walk and the UI state; switching to offline
+    // compiles everything up front so the first block has nothing to catch up on
+    void setNonRealtime(bool nonRealtime) noexcept override;
+
+    // CLAP hosts deliver timestamped parameter events, so we process them ourselves
+    // and split the block at each one for sample-accurate automation
+    bool supportsDirectProcess() override { return true; }
+    clap_process_status clap_direct_process(const clap_process* process) noexcept override;
+
     juce::AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override { return true; }
 
@@ -38,31 +69,465 @@ public:
     // Pattern state for UI access (lock-free)
     PatternState patternState;
 
+    // Rolling per-block timing statistics (read by the editor's debug overlay)
+    BlockStats blockStats;
+
     // Manual pattern editing
     void toggleStep(int step);
     bool isStepManuallyToggled(int step) const;
     void clearManualToggles();
 
+    // Harmony track: a chord progression the bassline follows during playback and export
+    bool loadHarmonyFile(const juce::File& file);
+    void clearHarmony();
+    std::shared_ptr<const HarmonyTrack> getHarmonyTrack() const { return harmony.getLatest(); }
+    juce::String getHarmonyName() const;
+
+    // Groove template: per-sixteenth timing and velocity analysed from a reference MIDI file
+    bool loadGrooveFile(const juce::File& file);
+    void clearGroove();
+    std::shared_ptr<const GrooveTemplate> getGroove() const { return groove.getLatest(); }
+    juce::String getGrooveName() const;
+
+    // Kick pattern the rhythm fits to (see "kickMode"): a dropped drum file, unless the kick is
+    // played in live on "kickChannel"
+    bool loadKickFile(const juce::File& file);
+    void clearKick();
+    std::shared_ptr<const KickPattern> getKickPattern() const { return kickPattern.getLatest(); }
+    juce::String getKickName() const;
+
+    // Imported Scala scale (.scl), optionally remapped by a keyboard mapping (.kbm)
+    bool loadScalaFile(const juce::File& file);
+    void clearUserScale();
+    std::shared_ptr<const ScaleEngine::UserScale> getUserScale() const { return userScale.getLatest(); }
+    juce::String getUserScaleName() const;
+
+    // Scale choice names: the built-ins followed by the imported scale slot
+    static juce::StringArray getScaleNames();
+
+    // Bars between fills from the "fillEvery" choice, 0 when off
+    int getFillEveryBars() const;
+    ControlLanes::Settings getControlLaneSettings() const; // Glide output and envelope lane
+    NoteChannels::Settings getNoteChannelSettings() const;
+
+    // Several parameter changes applied as one (Randomize, preset loads). The pattern is
+    // compiled once here, swapped in whole on the audio thread at the next step or bar, and
+    // the host gets every change inside a single gesture. Message thread.
+    struct ParameterChanges
+    {
+        ParameterChanges& set(const juce::String& parameterID, float value)
+        {
+            values.emplace_back(parameterID, value);
+            return *this;
+        }
+
+        std::vector<std::pair<juce::String, float>> values; // Plain (not normalised) values
+    };
+
+    // A change of step count always waits for the bar, since the step grid moves
+    enum class TransactionBoundary
+    {
+        step,
+        bar
+    };
+
+    void applyParameterChanges(const ParameterChanges& changes, TransactionBoundary boundary);
+
+    // Undo/redo of pattern parameters and step edits. An entry is recorded when a gesture ends
+    // or a step is toggled; moving through the history lands at the next step. Message thread.
+    bool undo();
+    bool redo();
+    bool canUndo() const { return history.canUndo(); }
+    bool canRedo() const { return history.canRedo(); }
+
+    // A/B morph: two stored patterns the "morph" parameter crossfades between. Morphing takes
+    // over from the pattern parameters once both slots are stored; step edits still apply on
+    // top. Message thread.
+    enum class MorphSlot
+    {
+        a,
+        b
+    };
+
+    void storeMorphSlot(MorphSlot slot);
+    void clearMorphSlots();
+    bool hasMorphSlot(MorphSlot slot) const { return !morphSlotValues[static_cast<size_t>(slot)].values.empty(); }
+    std::shared_ptr<const PatternMorph::Slots> getMorphSlots() const { return morphSlots.getLatest(); }
+
+    // Song mode: a chain of stored patterns, each played for a number of bars, compiled into
+    // one arrangement. While "songMode" is on it plays instead of the pattern parameters,
+    // changing pattern on bar lines. Message thread.
+    void appendChainSection(int bars); // The current pattern
+    void clearChain();
+    int getNumChainSections() const { return static_cast<int>(chainSections.size()); }
+    int getChainBars() const;
+    std::shared_ptr<const Arrangement> getArrangement() const { return arrangements.getLatest(); }
+
+    // Background work (export, previews, scans); submit from the message thread
+    JobSystem& getJobs() { return jobs; }
+
+    // Standalone: MIDI device the scheduler sends to (empty identifier = none)
+    bool setMidiOutputDevice(const juce::String& identifier);
+    juce::String getMidiOutputDevice() const;
+
+    enum FollowMode
+    {
+        followOff,
+        followRoot,
+        followChord,
+        followHarmonyTrack
+    };
+
+    // Where the timeline comes from ("clockSource" choice index)
+    enum ClockSource
+    {
+        clockHost,
+        clockInternal,
+        clockMidi
+    };
+
 private:
+    // Host transport, sampled once per block
+    struct Transport
+    {
+        bool isPlaying = false;
+        double bpm = 120.0;
+        double ppqPosition = 0.0;
+        int timeSigNumerator = 4;
+    };
+
+    // Step grid and clock settings for one rendered range
+    struct RangeTiming
+    {
+        int numSteps = 16;
+        double beatsPerBar = 4.0;
+        double ppqPerStep = 0.25;
+        double ppqPerSample = 0.0;
+        double samplesPerStep = 0.0;
+        double leadPpq = 0.0; // Steps start this far ahead of the grid (CompiledPattern::timingLead)
+        bool sendClock = false;
+        bool publishState = true; // Off when bouncing; nobody is watching
+    };
+
+    // A committed set of parameter changes, compiled and waiting for its boundary
+    struct Transaction
+    {
+        int64_t serial = 0;
+        uint32_t fields = 0; // Bit per CompiledPattern::Field it touches
+        bool atBar = false;
+        CompiledPattern pattern;
+        std::shared_ptr<const ScaleEngine::UserScale> userScale; // The one pattern.pitchTable points into
+        std::shared_ptr<const GrooveTemplate> groove;            // The one copied into pattern
+        std::shared_ptr<const KickPattern> kick;                 // Likewise
+    };
+
     // Manual step overrides (16 steps max)
     std::array<std::atomic<bool>, 16> manualToggles;
     std::atomic<bool> hasManualToggles{false};
+    void setManualToggles(uint32_t mask); // Bit per step
     juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+    static BusesProperties createBuses();
+
+    // Incremental pattern compilation: only the fields fed by a changed parameter are rebuilt
+    // (or every field forced stale, once compiled no longer came from the parameters)
+    void syncBlock();
+    void syncParameters();
+    void syncParameter(const juce::AudioProcessorParameter& parameter);
+    bool takeStaleField(CompiledPattern::Field field) noexcept;
+    void syncRhythm();
+    void syncPitch();
+    void syncVelocity();
+    void syncTiming();
+    void syncPhrase();
+    void syncVoiceLeading();
+    bool readVoiceLeadingInputs(CompiledPattern& pattern, std::shared_ptr<const ScaleEngine::UserScale>& scale) const;
+    static int fillEveryBarsForChoice(float choice);
+
+    using PatternValue = std::function<float(const std::atomic<float>* raw, const char* parameterID)>;
+    void readPatternParameters(CompiledPattern& pattern, const PatternValue& value) const;
+
+    // Lays the morphed bar over the compiled one (or takes it off again)
+    void syncMorph() noexcept;
+    void publishMorphSlots();
+
+    // Stored patterns: pattern parameter values, compiled off the audio thread
+    ParameterChanges capturePattern() const;
+    void compileStoredPattern(const ParameterChanges& stored, const ScaleEngine::UserScale* scale,
+                              CompiledPattern& pattern) const;
+    static juce::ValueTree storedPatternToValueTree(const juce::Identifier& type, const ParameterChanges& stored);
+    static ParameterChanges storedPatternFromValueTree(const juce::ValueTree& tree);
+    static juce::String savedParameterID(const juce::String& id);
+
+    // Song mode
+    void publishArrangement();
+    bool loadSection(int barIndex) noexcept;
+    void rebindUserScale() noexcept;
+
+    // Parameter transactions: fields a pending one covers aren't synced from the parameters
+    void commitTransaction(const ParameterChanges& changes, TransactionBoundary boundary,
+                           const std::function<void()>& writeParameters);
+    uint32_t frozenFields() const noexcept;
+    bool acquireTransaction() noexcept;
+    void applyTransaction() noexcept;
+    bool transactionDue(int step) const noexcept;
+
+    // Renders samples [startSample, endSample) of the current block
+    void renderRange(const Transport& transport, int startSample, int endSample, juce::MidiBuffer& midiMessages);
+    RangeTiming getRangeTiming(const Transport& transport);
+
+    // Returns false, without rendering, when a transaction was swapped in at this sample
+    bool renderSample(const Transport& transport, const RangeTiming& timing, int sample, juce::MidiBuffer& midiMessages);
+
+    // Offline: visits only the samples where a step, clock tick, ratchet or note-off can happen.
+    // Returns the sample it stopped at (endSample, or where a transaction was swapped in).
+    int renderOffline(const Transport& transport, const RangeTiming& timing, int startSample, int endSample,
+                      juce::MidiBuffer& midiMessages);
+    int nextEventSample(const Transport& transport, const RangeTiming& timing, int sample) const;
+    void playBurstNote(int sample, juce::MidiBuffer& midiMessages);
+    bool stepTriggers(const PhraseGenerator::Bar& bar, int step) const noexcept; // With the step edits
+    bool nextStepSlides() noexcept;
+    void releaseActiveNote(int sample, juce::MidiBuffer& midiMessages);
+    void stopPlayback(juce::MidiBuffer& midiMessages);
+
+    // Replaces the host transport with the internal or MIDI clock when selected.
+    // Returns false when there is no timeline at all.
+    bool resolveTransport(Transport& transport, bool hasHostTransport, int numSamples);
+    void addClockTick(double ppq, int sample, juce::MidiBuffer& midiMessages);
+    void handleIncomingMessage(const juce::MidiMessage& message, int samplePosition);
+
+    // Key/chord follow from incoming notes on the follow channel
+    void handleFollowMessage(const juce::MidiMessage& message);
+    void handleFollowNote(int channel, int note, bool isNoteOn);
+    int applyFollow(int pitch, double ppq);
+    bool loadHarmonyData(const juce::MemoryBlock& midiData);
+    bool loadGrooveData(const juce::MemoryBlock& midiData);
+    bool loadKickData(const juce::MemoryBlock& midiData);
+
+    // Live kick: onsets on the kick channel are kept as block positions until the transport is
+    // known, then quantised into the bar they fall in. Each bar is fitted to the one before it.
+    bool handleKickNote(int channel, bool isNoteOn, int samplePosition) noexcept;
+    void recordKicks(const Transport& transport) noexcept;
+    void applyLiveKick(int barIndex) noexcept;
+    bool loadScalaText(const juce::String& scl, const juce::String& kbm);
+
+    // Undo history: states are captured from the parameters that feed the compiled pattern.
+    // Value changes only tell the voice leading worker, as they can come from any thread.
+    void parameterValueChanged(int parameterIndex, float newValue) override;
+    void parameterGestureChanged(int parameterIndex, bool gestureIsStarting) override;
+    UndoHistory::State captureHistoryState() const;
+    void restoreHistoryState(const UndoHistory::State& state);
+    void recordHistory();
+    std::array<size_t, UndoHistory::numChunks> historyChunkSizes() const;
+
+    void applyClapParameterEvent(const clap_event_param_value& event);
+    void timerCallback() override; // Catches listeners up with CLAP automation
+    bool isVoiceLeadingInput(int parameterIndex) const noexcept;
+    static juce::MidiMessage clapMidiMessage(const clap_event_midi& midi);
+    static void pushClapMidiEvents(const juce::MidiBuffer& midiMessages, const clap_output_events* out);
+
+    // Parsed tunings and progressions, shared with every other instance in the process
+    juce::SharedResourcePointer<SharedResources> sharedResources;
 
     // Generator components
     EuclideanRhythm euclidean;
-    PitchGenerator pitchGen;
+    CompiledPattern compiled;
+    PhraseGenerator phrase { compiled };
+    HeldNotes heldNotes;
+
+    RealtimePublisher<HarmonyTrack> harmony;
+    const HarmonyTrack* currentHarmony = nullptr; // Acquired once per block
+    HarmonyTrack::Cursor harmonyCursor;
+
+    RealtimePublisher<ScaleEngine::UserScale> userScale;
+    const ScaleEngine::UserScale* currentUserScale = nullptr; // Acquired once per block
+    const ScaleEngine::UserScale* compiledUserScale = nullptr; // The one compiled.pitches came from
+
+    RealtimePublisher<GrooveTemplate> groove;
+    const GrooveTemplate* currentGroove = nullptr;  // Acquired once per block
+    const GrooveTemplate* compiledGroove = nullptr; // The one copied into compiled
+
+    RealtimePublisher<KickPattern> kickPattern;
+    const KickPattern* currentKick = nullptr;  // Acquired once per block
+    const KickPattern* compiledKick = nullptr; // The one copied into compiled
+    bool liveKickApplied = false;              // compiled holds the live kick instead
+
+    struct LiveKickBar
+    {
+        int bar = INT_MIN;
+        uint16_t mask = 0;
+    };
+
+    std::array<int, 64> pendingKicks{}; // Sample positions in this block
+    int numPendingKicks = 0;
+    std::array<LiveKickBar, 2> liveKicks{}; // This bar and the last, by bar parity
+    LiveKickBar liveKickFit;                // The bar being played and the kick it fits to
+
+    // Voice leading: the worker publishes optimised lines, the audio thread lays them over
+    // the pitches the model drew
+    RealtimePublisher<VoiceLine> voiceLine;
+    const VoiceLine* currentVoiceLine = nullptr; // Acquired once per block
+    const VoiceLine* appliedVoiceLine = nullptr;
+    bool voiceLeadingApplied = false;
+    bool voiceLineDirty = true;
+    std::array<int, CompiledPattern::maxSteps> drawnPitches{};
+
+    // A/B morph: stored parameter values per slot, compiled and published as a pair
+    std::array<ParameterChanges, 2> morphSlotValues;
+    RealtimePublisher<PatternMorph::Slots> morphSlots;
+    const PatternMorph::Slots* currentMorphSlots = nullptr; // Acquired once per block
+    PatternMorph morph;
+    bool morphApplied = false;
+
+    // Song mode: sections as stored, and the arrangement compiled from them
+    struct ChainSection
+    {
+        ParameterChanges values;
+        int bars = 1;
+    };
+
+    std::vector<ChainSection> chainSections;
+    RealtimePublisher<Arrangement> arrangements;
+    const Arrangement* currentArrangement = nullptr; // Acquired once per block
+    const Arrangement* playingArrangement = nullptr; // The one compiled came from
+    int playingSection = -1; // -1 while the parameters play
+    int playingBar = -1;     // Bar the section was last looked up for
+    uint32_t staleFields = 0; // Bit per CompiledPattern::Field to recompile whatever compiled holds
+
+    RealtimePublisher<Transaction> transactions;
+    const Transaction* pendingTransaction = nullptr; // Acquired, waiting for its boundary
+    int64_t appliedTransactionSerial = 0;
+    std::atomic<int64_t> transactionSerial { 0 }; // Odd while a commit is writing parameters
+
+    // Cached raw parameter values (avoids string lookups on the audio thread)
+    std::atomic<float>* stepsParam = nullptr;
+    std::atomic<float>* hitsParam = nullptr;
+    std::atomic<float>* rotationParam = nullptr;
+    std::atomic<float>* rootNoteParam = nullptr;
+    std::atomic<float>* scaleParam = nullptr;
+    std::atomic<float>* octaveRangeParam = nullptr;
+    std::atomic<float>* pitchModelParam = nullptr;
+    std::atomic<float>* pitchSpreadParam = nullptr;
+    std::atomic<float>* voiceLeadingParam = nullptr;
+    std::atomic<float>* noteLengthParam = nullptr;
+    std::atomic<float>* velocityParam = nullptr;
+    std::atomic<float>* swingParam = nullptr;
+    std::atomic<float>* humanizeParam = nullptr;
+    std::atomic<float>* seedParam = nullptr;
+    std::atomic<float>* followModeParam = nullptr;
+    std::atomic<float>* followChannelParam = nullptr;
+    std::atomic<float>* fillEveryParam = nullptr;
+    std::atomic<float>* mutationParam = nullptr;
+    std::atomic<float>* rotationDriftParam = nullptr;
+    std::atomic<float>* pitchLengthParam = nullptr;
+    std::atomic<float>* accentLengthParam = nullptr;
+    std::atomic<float>* clockSourceParam = nullptr;
+    std::atomic<float>* clockTempoParam = nullptr;
+    std::atomic<float>* clockTimeSigParam = nullptr;
+    std::atomic<float>* clockRunningParam = nullptr;
+    std::atomic<float>* sendMidiClockParam = nullptr;
+    std::atomic<float>* morphParam = nullptr;
+    std::atomic<float>* songModeParam = nullptr;
+    std::atomic<float>* ratchetChanceParam = nullptr;
+    std::atomic<float>* ratchetCountParam = nullptr;
+    std::atomic<float>* rollRampParam = nullptr;
+    std::atomic<float>* microTimingParam = nullptr;
+    std::atomic<float>* grooveAmountParam = nullptr;
+    std::atomic<float>* humanizeTimingParam = nullptr;
+    std::atomic<float>* probabilityParam = nullptr;
+    std::atomic<float>* variationCycleParam = nullptr;
+    std::atomic<float>* kickModeParam = nullptr;
+    std::atomic<float>* kickChannelParam = nullptr;
+    std::atomic<float>* glideParam = nullptr;
+    std::atomic<float>* glideTimeParam = nullptr;
+    std::atomic<float>* glideModeParam = nullptr;
+    std::atomic<float>* bendRangeParam = nullptr;
+    std::atomic<float>* envelopeCcParam = nullptr;
+    std::atomic<float>* envelopeFloorParam = nullptr;
+    std::atomic<float>* envelopeAmountParam = nullptr;
+    std::atomic<float>* envelopeDecayParam = nullptr;
+    std::atomic<float>* curveRateParam = nullptr;
+    std::atomic<float>* curveDeadbandParam = nullptr;
+    std::atomic<float>* outputModeParam = nullptr;
+    std::atomic<float>* outputChannelParam = nullptr;
+    std::atomic<float>* channelCountParam = nullptr;
+    std::atomic<float>* previewSynthParam = nullptr;
+    const juce::AudioProcessorParameter* morphParameter = nullptr;
+
+    // Compiled field each parameter feeds, by parameter index (-1 for none)
+    std::vector<int> fieldByParameterIndex;
+    int pitchLengthParameterIndex = -1;
+
+    UndoHistory history;
+    bool restoringHistory = false; // Gestures from an undo aren't new entries
+
+    // CLAP parameter ids (hash of the JUCE parameter ID), sorted by id for the audio thread's
+    // lookup. Automation lands in the parameter and its raw value there; the listeners (the
+    // editor, the state tree) hear of it from the message thread, by bit per parameter index.
+    struct ClapParameter
+    {
+        clap_id id;
+        juce::RangedAudioParameter* parameter;
+        std::atomic<float>* value;
+    };
+
+    std::vector<ClapParameter> clapParameters;
+    std::array<std::atomic<uint64_t>, 2> clapAutomated{};
+
+    // Scratch output for the CLAP path, sized in prepareToPlay
+    juce::MidiBuffer clapMidiOut;
+
+    // processBlock renders here, then swaps it with the host's buffer. Sized in prepareToPlay.
+    juce::MidiBuffer blockMidiOut;
 
     // Timing state
     double currentSampleRate = 44100.0;
     double ppqPerSample = 0.0;
     int64_t lastPpqPosition = -1;
-    int currentStep = 0;
+    int currentStep = -1;
+
+    // Clocks
+    InternalClock internalClock;
+    MidiClockInput midiClockIn;
+    int64_t samplesProcessed = 0;
+    int64_t lastClockTick = -1; // Last MIDI clock tick sent, -1 while stopped
+    MidiOutputScheduler midiOutput;
 
     // Note tracking for note-offs
     int activeNote = -1;
+    int activeChannel = 1;
+    NoteChannels noteChannels;
     int noteDurationSamples = 0;
     int samplesUntilNoteOff = 0;
+    bool holdForSlide = false; // The note runs on into the next step's slide, which releases it
+
+    // The step's burst of ratchets (one note when unratcheted), played from the compiled table
+    CompiledPattern::Burst burst;
+    int burstIndex = CompiledPattern::maxRatchets; // Next note to play; past burst.count once done
+    int burstPitch = 0;
+    int burstVelocity = 0;
+    bool burstAccent = false;
+    float burstShift = 0.0f;      // Humanized timing of this bar's step, fractions of a step
+    double burstSamplesPerStep = 0.0;
+    int samplesUntilRetrigger = 0;
+
+    // Glide and envelope lanes, counted down per sample like the notes
+    ControlLanes controlLanes;
+
+    // The Standalone app's built-in synth, on its preview output
+    PreviewSynth previewSynth;
+
+    size_t maxBlockMidiBytes = 0; // Worst case for a block's output, reserved in prepareToPlay
+
+    // Declared late so running jobs finish before anything they read is destroyed
+    JobSystem jobs { sharedResources->jobPool };
+
+    // After the job system it submits to
+    VoiceLeadingWorker voiceLeadingWorker {
+        jobs,
+        [this](CompiledPattern& pattern, std::shared_ptr<const ScaleEngine::UserScale>& scale)
+        { return readVoiceLeadingInputs(pattern, scale); },
+        voiceLine
+    };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BasslineGeneratorProcessor)
 };
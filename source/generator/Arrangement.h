@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "CompiledPattern.h"
+
+// A song: stored patterns played one after another, each for its number of bars, then round
+// again. Compiled ahead into one pattern per section and a flat bar -> section table, so the
+// pattern for any transport position, after a seek too, is a single lookup.
+struct Arrangement
+{
+    static constexpr int maxBars = 1024;
+
+    std::vector<CompiledPattern> patterns;    // One per section
+    std::vector<uint16_t> sectionByBar;       // The timeline, one entry per bar
+    std::shared_ptr<const ScaleEngine::UserScale> userScale; // What the patterns' pitch tables point into
+
+    // Returns false once the timeline is full
+    bool addSection(const CompiledPattern& pattern, int bars)
+    {
+        if (bars < 1 || numBars() + bars > maxBars)
+            return false;
+
+        patterns.push_back(pattern);
+        sectionByBar.insert(sectionByBar.end(), static_cast<size_t>(bars), static_cast<uint16_t>(patterns.size() - 1));
+        return true;
+    }
+
+    int numBars() const noexcept { return static_cast<int>(sectionByBar.size()); }
+
+    // Loops; pre-roll plays the first section. -1 when empty.
+    int sectionAt(int bar) const noexcept
+    {
+        if (sectionByBar.empty())
+            return -1;
+
+        return sectionByBar[static_cast<size_t>((bar < 0 ? 0 : bar) % numBars())];
+    }
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Snaps pitches onto the tones of a chord.
+// The chord is a 12-bit pitch-class mask; for every possible mask we precompute, at compile
+// time, the semitone offset that moves each pitch class to its nearest chord tone. Quantising
+// a note is then a single table load.
+namespace ChordQuantiser
+{
+    using OffsetRow = std::array<int8_t, 12>;
+
+    constexpr OffsetRow buildRow(uint16_t chordMask)
+    {
+        OffsetRow row {};
+        for (int pc = 0; pc < 12; ++pc)
+        {
+            // Empty chord: leave everything where it is
+            if (chordMask == 0)
+                continue;
+
+            // Search outwards, preferring the tone below on ties (keeps bass lines low)
+            for (int distance = 0; distance <= 6; ++distance)
+            {
+                if ((chordMask >> ((pc - distance + 12) % 12)) & 1)
+                {
+                    row[static_cast<size_t>(pc)] = static_cast<int8_t>(-distance);
+                    break;
+                }
+                if ((chordMask >> ((pc + distance) % 12)) & 1)
+                {
+                    row[static_cast<size_t>(pc)] = static_cast<int8_t>(distance);
+                    break;
+                }
+            }
+        }
+        return row;
+    }
+
+    constexpr std::array<OffsetRow, 4096> buildTable()
+    {
+        std::array<OffsetRow, 4096> table {};
+        for (int mask = 0; mask < 4096; ++mask)
+            table[static_cast<size_t>(mask)] = buildRow(static_cast<uint16_t>(mask));
+        return table;
+    }
+
+    inline constexpr std::array<OffsetRow, 4096> table = buildTable();
+
+    // Row for one chord; hold on to it to quantise many notes against the same chord
+    inline const OffsetRow& rowFor(uint16_t chordMask) noexcept
+    {
+        return table[chordMask & 0x0fffu];
+    }
+
+    inline int quantise(int note, const OffsetRow& row) noexcept
+    {
+        return note + row[static_cast<size_t>(note % 12)];
+    }
+
+    inline int quantise(int note, uint16_t chordMask) noexcept
+    {
+        return quantise(note, rowFor(chordMask));
+    }
+
+    // Interval from `from` to the pitch class of `to`, wrapped into [-6, 5]
+    inline int nearestTranspose(int from, int to) noexcept
+    {
+        int interval = ((to - from) % 12 + 12) % 12;
+        return interval > 5 ? interval - 12 : interval;
+    }
+}
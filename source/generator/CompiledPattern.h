@@ -0,0 +1,253 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <numeric>
+#include "EuclideanRhythm.h"
+#include "PitchGenerator.h"
+#include "PitchModel.h"
+#include "CounterRng.h"
+
+// Everything the audio thread needs to play a bar, precomputed from the parameters.
+// Each group of fields is recompiled on its own, so a change to one parameter only
+// touches the steps it affects instead of regenerating the whole pattern.
+struct CompiledPattern
+{
+    static constexpr int maxSteps = 16;
+
+    // Which compiled fields a parameter feeds
+    enum class Field
+    {
+        rhythm,   // steps, hits, rotation
+        pitch,    // rootNote, scale, octaveRange, seed, pitchModel, pitchSpread
+        velocity, // velocity, humanize
+        timing,   // swing, groove, noteLength, ratchets, microTiming, humanizeTiming, glide
+        phrase    // fillEvery, mutation, rotationDrift, pitchLength, accentLength, probability, variationCycle, kickMode
+    };
+
+    static constexpr uint32_t fieldBit(Field field) noexcept { return 1u << static_cast<int>(field); }
+
+    // Rhythm
+    int steps = 8;
+    int hits = 3;
+    int rotation = 0;
+    uint32_t triggerMask = 0;
+
+    // Pitch
+    int rootNote = 36;
+    int scaleIndex = 0;
+    int octaveRange = 1;
+    int seed = 42;
+    PitchModel::Type pitchModelType = PitchModel::Type::uniform;
+    float pitchSpread = 0.5f;
+    std::array<int, maxSteps> pitches{};
+    const ScaleEngine::PitchTable* pitchTable = nullptr; // Table the pitches were drawn from
+    PitchModel pitchModel;                               // Alias tables compiled from the above
+
+    // Velocity
+    int velocity = 100;
+    int humanize = 0; // Most a note's velocity moves either way, drawn per bar (see PhraseGenerator)
+    std::array<int, maxSteps> velocities{};
+
+    // Timing
+    float swing = 0.0f;       // Odd steps are late by this fraction of a step
+    float noteLength = 0.5f;
+
+    // Groove template: timing and velocity per sixteenth of the bar, laid over the steps
+    static constexpr int grooveSlots = 16;
+    std::array<float, grooveSlots> grooveOffsets{};   // Fractions of a sixteenth, + is late
+    std::array<float, grooveSlots> grooveVelocities{}; // Change in velocity scale, 0 = unchanged
+    float grooveAmount = 1.0f;
+
+    // Swing, groove, ratchets and micro-timing: every step's notes as offsets into the step,
+    // so a burst is played from the table with no per-note work beyond scaling to samples or
+    // ticks, live and in exports alike
+    static constexpr int maxRatchets = 8;
+
+    struct Burst
+    {
+        int count = 1;
+        std::array<float, maxRatchets> offsets{}; // Fractions of a step
+        std::array<float, maxRatchets> gains{};   // Velocity scale per note
+        float length = 1.0f;                      // Room per note, as a fraction of a step
+        bool slide = false;                       // First note glides from the note before
+    };
+
+    float ratchetChance = 0.0f; // Chance per step of a ratchet
+    int ratchetCount = 4;       // Most notes in a ratchet (2-8)
+    float rollRamp = 0.0f;      // Velocity across a ratchet: < 0 fades out, > 0 rolls in
+    float microTiming = 0.0f;   // Most a step is laid back, as a fraction of a step
+    float glideChance = 0.0f;   // Chance per step of a slide into it
+    float glideTime = 0.5f;     // Length of a slide, as a fraction of a step
+    std::array<Burst, maxSteps> bursts{};
+
+    // Most a step's notes move either way, as a fraction of a step, drawn per bar
+    float humanizeTiming = 0.0f;
+
+    // Steps start this fraction of a step ahead of the grid, so a groove or humanize can pull
+    // notes early and every offset is still a delay
+    float timingLead = 0.0f;
+
+    // Phrase (variation across bars, see PhraseGenerator)
+    int fillEvery = 0;        // 0 = no fills
+    float mutation = 0.0f;    // Chance per step of a different scale tone
+    int rotationDrift = 0;    // Steps the rhythm rotates per bar
+    float probability = 1.0f; // Chance each hit plays, drawn per bar
+    int variationCycle = 0;   // Bars before humanize and probability repeat, 0 = never
+
+    // Kick the rhythm is fitted to, a sixteenth-grid onset mask per bar, looping (see DrumFit)
+    static constexpr int maxKickBars = 64;
+    int kickMode = 0; // DrumFit::Mode
+    std::array<uint16_t, maxKickBars> kickBars{};
+    int numKickBars = 0; // 0 = no kick
+
+    // Polymeter: the pitch and accent sequences cycle independently of the rhythm (0 = steps)
+    int pitchLength = 0;
+    int accentLength = 0;
+    static constexpr int accentBoost = 20; // Added on the first step of each accent cycle
+
+    bool triggers(int step) const noexcept
+    {
+        return step >= 0 && step < maxSteps && ((triggerMask >> step) & 1u) != 0;
+    }
+
+    int pitchCycle() const noexcept { return pitchLength > 0 ? pitchLength : steps; }
+    int accentCycle() const noexcept { return accentLength > 0 ? accentLength : steps; }
+
+    // Steps until rhythm, pitch and accent line up again. Only ever used for indexing and
+    // lengths; the combined cycle itself is never built.
+    int64_t cycleSteps() const noexcept
+    {
+        return std::lcm(std::lcm(static_cast<int64_t>(steps), static_cast<int64_t>(pitchCycle())),
+                        static_cast<int64_t>(accentCycle()));
+    }
+
+    // Pitch and velocity at a step counted from the start of the song
+    int pitchAt(int64_t globalStep) const noexcept
+    {
+        return pitches[static_cast<size_t>(globalStep % pitchCycle())];
+    }
+
+    int velocityAt(int64_t globalStep) const noexcept
+    {
+        int v = velocities[static_cast<size_t>(globalStep % accentCycle())];
+        if (isAccent(globalStep))
+            v += accentBoost;
+        return v > 127 ? 127 : v;
+    }
+
+    // The first step of each accent cycle; its note plays in the accent role too
+    bool isAccent(int64_t globalStep) const noexcept
+    {
+        return accentLength > 0 && globalStep % accentCycle() == 0;
+    }
+
+    void compileRhythm() noexcept
+    {
+        triggerMask = EuclideanRhythm::mask(steps, hits, rotation) & ((1u << maxSteps) - 1u);
+    }
+
+    // Pitch only depends on the step index, so every slot is filled regardless of steps
+    void compilePitches(const ScaleEngine::UserScale* userScale = nullptr)
+    {
+        PitchGenerator pitchGen;
+        const auto& table = ScaleEngine::lookup(scaleIndex, rootNote, octaveRange, userScale);
+        pitchTable = &table;
+        pitchModel.compile(pitchModelType, table, pitchSpread);
+
+        // The uniform model keeps the original mt19937 draws so existing patterns don't change
+        if (pitchModelType == PitchModel::Type::uniform)
+        {
+            for (int step = 0; step < maxSteps; ++step)
+                pitches[static_cast<size_t>(step)] = pitchGen.generatePitch(table, step, seed);
+            return;
+        }
+
+        // Other models walk the bar from the root, one alias-table draw per step
+        int previous = 0;
+        for (int step = 0; step < maxSteps; ++step)
+        {
+            previous = pitchModel.sample(previous, CounterRng::get(seed, 0, step, CounterRng::pitch));
+            pitches[static_cast<size_t>(step)] = table.notes[static_cast<size_t>(previous)];
+        }
+    }
+
+    // The user scale a table came from must outlive this pattern (or the next compilePitches)
+    const ScaleEngine::PitchTable& getPitchTable() const noexcept
+    {
+        return pitchTable != nullptr ? *pitchTable : ScaleEngine::lookup(scaleIndex, rootNote, octaveRange);
+    }
+
+    // Humanize is added per bar, on top of these
+    void compileVelocities()
+    {
+        int v = velocity < 1 ? 1 : (velocity > 127 ? 127 : velocity);
+        velocities.fill(v);
+    }
+
+    // Where a step's notes sit against the grid, as a fraction of a step (+ is late)
+    float stepOffset(int step) const noexcept
+    {
+        auto slot = static_cast<size_t>(((step * grooveSlots + steps / 2) / steps) % grooveSlots);
+        float groove = grooveAmount * grooveOffsets[slot] * static_cast<float>(steps) / grooveSlots;
+        return groove + (step % 2 == 1 ? swing : 0.0f);
+    }
+
+    float stepGain(int step) const noexcept
+    {
+        auto slot = static_cast<size_t>(((step * grooveSlots + steps / 2) / steps) % grooveSlots);
+        return 1.0f + grooveAmount * grooveVelocities[slot];
+    }
+
+    // Seeded per step, like the pitches. Depends on steps too (the groove is per sixteenth).
+    void compileBursts() noexcept
+    {
+        // Latest a burst may start. Humanize moves a whole burst up to humanizeTiming either
+        // way, so bursts start at least that far into the step and ratchets are spaced to end
+        // that far before it ends: the next step's notes never cut one short.
+        constexpr float maxDelay = 0.875f;
+
+        int mostNotes = ratchetCount < 2 ? 2 : (ratchetCount > maxRatchets ? maxRatchets : ratchetCount);
+        int numSteps = steps < 1 ? 1 : (steps > maxSteps ? maxSteps : steps);
+
+        timingLead = 0.0f;
+        for (int step = 0; step < numSteps; ++step)
+            timingLead = std::max(timingLead, -stepOffset(step));
+        timingLead += humanizeTiming;
+
+        for (int step = 0; step < maxSteps; ++step)
+        {
+            auto& burst = bursts[static_cast<size_t>(step)];
+
+            float delay = timingLead + stepOffset(step)
+                          + microTiming * CounterRng::unit(CounterRng::get(seed, 0, step, CounterRng::microTiming));
+            delay = std::clamp(delay, humanizeTiming, maxDelay - humanizeTiming);
+
+            burst.count = 1;
+            if (ratchetChance > 0.0f && CounterRng::unit(CounterRng::get(seed, 0, step, CounterRng::ratchet)) < ratchetChance)
+                burst.count = 2 + static_cast<int>(CounterRng::get(seed, 0, step, CounterRng::ratchetCount) % static_cast<uint32_t>(mostNotes - 1));
+
+            burst.slide = glideChance > 0.0f && CounterRng::unit(CounterRng::get(seed, 0, step, CounterRng::slide)) < glideChance;
+
+            // A ratchet shares what's left of the step; a single note keeps a whole step, as
+            // a swung or laid-back note always has
+            float spacing = (1.0f - humanizeTiming - delay) / static_cast<float>(burst.count);
+            burst.length = burst.count > 1 ? spacing : 1.0f;
+            for (int note = 0; note < burst.count; ++note)
+            {
+                float position = burst.count > 1 ? static_cast<float>(note) / static_cast<float>(burst.count - 1) : 1.0f;
+                burst.offsets[static_cast<size_t>(note)] = delay + static_cast<float>(note) * spacing;
+                burst.gains[static_cast<size_t>(note)] = stepGain(step) * (rollRamp >= 0.0f ? 1.0f - rollRamp * (1.0f - position)
+                                                                                            : 1.0f + rollRamp * position);
+            }
+        }
+    }
+
+    void compileAll(const ScaleEngine::UserScale* userScale = nullptr)
+    {
+        compileRhythm();
+        compilePitches(userScale);
+        compileVelocities();
+        compileBursts();
+    }
+};
@@ -0,0 +1,274 @@
+#pragma once
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+
+// One continuous controller as a curve from a note's start value to where it settles, sent as
+// points on a fixed grid. A point only goes out when it has moved by the deadband since the
+// last one sent, and the end value always does, so a curve costs at most one event per grid
+// step and usually far fewer. Units are whatever the caller counts in: samples live, ticks in
+// an export.
+class CurveLane
+{
+public:
+    static constexpr int idle = INT_MAX;
+
+    int untilNext = idle; // Counted down by the caller; next() when it reaches 0
+
+    void setResolution(int newInterval, int newDeadband) noexcept
+    {
+        interval = newInterval < 1 ? 1 : newInterval;
+        deadband = newDeadband < 1 ? 1 : newDeadband;
+    }
+
+    // Exponential curves are 99% of the way there at the end. Returns the start value to send
+    // with the note, or -1 if it's the one already sent.
+    int start(float from, float to, int length, bool exponential) noexcept
+    {
+        startValue = from;
+        endValue = to;
+        curveLength = length < 1 ? 1 : length;
+        isExponential = exponential;
+        position = 0;
+        untilNext = interval < curveLength ? interval : curveLength;
+        return sendIfChanged(juce::roundToInt(from), 1);
+    }
+
+    // Jumps straight to a value and holds it
+    int set(int value) noexcept
+    {
+        untilNext = idle;
+        return sendIfChanged(value, 1);
+    }
+
+    // The point now due, or -1 if it's within the deadband of the last one sent
+    int next() noexcept
+    {
+        position += interval < curveLength - position ? interval : curveLength - position;
+        if (position >= curveLength)
+        {
+            untilNext = idle;
+            return sendIfChanged(juce::roundToInt(endValue), 1);
+        }
+
+        untilNext = interval < curveLength - position ? interval : curveLength - position;
+        return sendIfChanged(juce::roundToInt(valueAt(position)), deadband);
+    }
+
+    int getLastSent() const noexcept { return lastSent; }
+
+    // Forgets what the receiver was sent, e.g. after a stop
+    void reset() noexcept
+    {
+        untilNext = idle;
+        lastSent = -1;
+    }
+
+private:
+    int interval = 1;
+    int deadband = 1;
+    float startValue = 0.0f;
+    float endValue = 0.0f;
+    int curveLength = 1;
+    int position = 0;
+    bool isExponential = false;
+    int lastSent = -1;
+
+    float valueAt(int at) const noexcept
+    {
+        auto progress = static_cast<float>(at) / static_cast<float>(curveLength);
+        if (isExponential)
+            progress = 1.0f - std::exp(-4.6f * progress); // e^-4.6 = 1%
+
+        return startValue + (endValue - startValue) * progress;
+    }
+
+    int sendIfChanged(int value, int least) noexcept
+    {
+        if (lastSent >= 0 && std::abs(value - lastSent) < least)
+            return -1;
+
+        lastSent = value;
+        return value;
+    }
+};
+
+// Glides and a per-note controller envelope, sent alongside the notes: a slide bends in from
+// the last note (or turns portamento on for it), and every note restarts the envelope. With
+// per-note expression (MPE) each note also gets a pressure curve, the envelope is its timbre,
+// and every note's lanes start afresh on its own channel. Shared by the processor and the
+// exporter so a bounce and an exported file carry the same lanes. Messages go to
+// emit(const juce::MidiMessage&) at the caller's current position.
+class ControlLanes
+{
+public:
+    enum class Glide
+    {
+        pitchBend,
+        portamento // CC 5 time and CC 65 on/off; the synth does the slide
+    };
+
+    struct Settings
+    {
+        Glide glide = Glide::pitchBend;
+        int bendRange = 2;            // Semitones the synth's full bend is set to
+        int envelopeCc = 0;           // 0 = no envelope lane
+        int envelopeFloor = 32;       // Where the envelope settles
+        float envelopeAmount = 0.5f;  // Rise above the floor of a full-velocity note, 0-1
+        float envelopeDecay = 1.0f;   // Steps to settle
+        float resolutionMs = 5.0f;    // Time between curve points
+        int deadband = 1;             // Least change sent, in controller steps
+        bool perNote = false;         // MPE: bends are per note, plus pressure and timbre
+
+        bool operator==(const Settings&) const = default;
+    };
+
+    static constexpr int bendCentre = 8192;
+    static constexpr int bendPerControllerStep = 128; // Deadband scale: 14-bit bend against 7-bit CCs
+    static constexpr int timbreCc = 74;               // MPE timbre, when no envelope CC is set
+
+    // unitsPerSecond: the sample rate live, ticks per second in an export
+    void prepare(const Settings& newSettings, double unitsPerSecond) noexcept
+    {
+        if (newSettings.envelopeCc != settings.envelopeCc || newSettings.perNote != settings.perNote)
+            envelope.reset();
+
+        settings = newSettings;
+        auto interval = juce::roundToInt(settings.resolutionMs * 0.001 * unitsPerSecond);
+        bend.setResolution(interval, settings.deadband * bendPerControllerStep);
+        envelope.setResolution(interval, settings.deadband);
+        pressure.setResolution(interval, settings.deadband);
+    }
+
+    // Before each note-on. Only the first note of a step slides; ratchet repeats don't.
+    template <typename Emit>
+    void noteOn(int noteChannel, int pitch, int velocity, bool slide, float glideTime, double unitsPerStep, Emit&& emit)
+    {
+        bool sliding = slide && lastPitch >= 0 && lastPitch != pitch;
+
+        // A new channel starts from nothing sent; portamento left on on the old one is turned off
+        if (noteChannel != channel)
+        {
+            if (portamentoOn)
+                emit(juce::MidiMessage::controllerEvent(channel, 65, 0));
+
+            bend.reset();
+            envelope.reset();
+            pressure.reset();
+            portamentoOn = false;
+            channel = noteChannel;
+        }
+
+        if (settings.glide == Glide::pitchBend || settings.perNote)
+        {
+            if (sliding)
+            {
+                auto semitones = static_cast<float>(lastPitch - pitch);
+                float from = juce::jlimit(0.0f, 16383.0f, static_cast<float>(bendCentre) + semitones * bendCentre / static_cast<float>(settings.bendRange));
+                sendBend(bend.start(from, static_cast<float>(bendCentre), juce::roundToInt(glideTime * unitsPerStep), false), emit);
+                bendUsed = true;
+            }
+            else if (bendUsed || settings.perNote)
+            {
+                sendBend(bend.set(bendCentre), emit); // Back to centre if a slide was cut short
+            }
+        }
+        else if (sliding != portamentoOn)
+        {
+            if (sliding)
+                emit(juce::MidiMessage::controllerEvent(channel, 5, juce::jlimit(0, 127, juce::roundToInt(glideTime * 127.0f))));
+            emit(juce::MidiMessage::controllerEvent(channel, 65, sliding ? 127 : 0));
+            portamentoOn = sliding;
+        }
+
+        auto decay = juce::roundToInt(settings.envelopeDecay * unitsPerStep);
+        if (envelopeController() > 0)
+        {
+            auto floor = static_cast<float>(settings.envelopeFloor);
+            float peak = floor + settings.envelopeAmount * (127.0f - floor) * static_cast<float>(velocity) / 127.0f;
+            sendEnvelope(envelope.start(peak, floor, decay, true), emit);
+        }
+
+        // Pressure: struck at the note's velocity (so accents press harder), easing to half
+        if (settings.perNote)
+            sendPressure(pressure.start(static_cast<float>(velocity), static_cast<float>(velocity) * 0.5f, decay, true), emit);
+
+        lastPitch = pitch;
+    }
+
+    // Units until a curve point is due, CurveLane::idle if none
+    int untilNext() const noexcept { return juce::jmin(bend.untilNext, envelope.untilNext, pressure.untilNext); }
+
+    // Units passed with nothing due (fewer than untilNext())
+    void skip(int units) noexcept
+    {
+        for (auto* lane : { &bend, &envelope, &pressure })
+            if (lane->untilNext != CurveLane::idle)
+                lane->untilNext -= units;
+    }
+
+    // One unit on, sending any point that falls due
+    template <typename Emit>
+    void step(Emit&& emit)
+    {
+        if (bend.untilNext != CurveLane::idle && --bend.untilNext <= 0)
+            sendBend(bend.next(), emit);
+        if (envelope.untilNext != CurveLane::idle && --envelope.untilNext <= 0)
+            sendEnvelope(envelope.next(), emit);
+        if (pressure.untilNext != CurveLane::idle && --pressure.untilNext <= 0)
+            sendPressure(pressure.next(), emit);
+    }
+
+    // Playback stopped: the bend goes back to centre and portamento off, so the synth isn't
+    // left detuned or sliding
+    template <typename Emit>
+    void stop(Emit&& emit)
+    {
+        if (bend.getLastSent() >= 0 && bend.getLastSent() != bendCentre)
+            emit(juce::MidiMessage::pitchWheel(channel, bendCentre));
+        if (portamentoOn)
+            emit(juce::MidiMessage::controllerEvent(channel, 65, 0));
+
+        bend.reset();
+        envelope.reset();
+        pressure.reset();
+        portamentoOn = false;
+        bendUsed = false;
+        lastPitch = -1;
+    }
+
+private:
+    Settings settings;
+    CurveLane bend, envelope, pressure;
+    int channel = 1; // Of the latest note; the lanes follow it
+    int lastPitch = -1;
+    bool portamentoOn = false;
+    bool bendUsed = false; // Since the last stop, so a channel may be left bent
+
+    int envelopeController() const noexcept
+    {
+        return settings.envelopeCc > 0 || !settings.perNote ? settings.envelopeCc : timbreCc;
+    }
+
+    template <typename Emit>
+    void sendBend(int value, Emit& emit)
+    {
+        if (value >= 0)
+            emit(juce::MidiMessage::pitchWheel(channel, value));
+    }
+
+    template <typename Emit>
+    void sendEnvelope(int value, Emit& emit)
+    {
+        if (value >= 0)
+            emit(juce::MidiMessage::controllerEvent(channel, envelopeController(), value));
+    }
+
+    template <typename Emit>
+    void sendPressure(int value, Emit& emit)
+    {
+        if (value >= 0)
+            emit(juce::MidiMessage::channelPressureChange(channel, value));
+    }
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+
+// Stateless random numbers: the value is a pure function of its key, so any bar or step can be
+// drawn on its own, in any order, on any thread, and live playback matches an export.
+namespace CounterRng
+{
+    // Which decision a draw is for, so different uses of the same step are independent
+    enum Lane : uint32_t
+    {
+        pitch = 0,
+        mutationChance,
+        mutationPitch,
+        fillStart,
+        morphSwitch,
+        ratchet,
+        ratchetCount,
+        microTiming,
+        humanizeVelocity,
+        humanizeTiming,
+        probability,
+        slide
+    };
+
+    // splitmix64 finaliser over the packed key
+    constexpr uint32_t get(int seed, int bar, int step, uint32_t lane) noexcept
+    {
+        uint64_t x = (static_cast<uint64_t>(static_cast<uint32_t>(seed)) << 32)
+                     ^ (static_cast<uint64_t>(static_cast<uint32_t>(bar)) << 8)
+                     ^ static_cast<uint64_t>(static_cast<uint32_t>(step))
+                     ^ (static_cast<uint64_t>(lane + 1) * 0x9e3779b97f4a7c15ull);
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        x ^= x >> 31;
+        return static_cast<uint32_t>(x);
+    }
+
+    // Uniform in [0, 1)
+    constexpr float unit(uint32_t value) noexcept
+    {
+        return static_cast<float>(value >> 8) * (1.0f / 16777216.0f);
+    }
+}
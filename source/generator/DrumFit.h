@@ -0,0 +1,89 @@
+#pragma once
+#include <bit>
+#include <climits>
+#include <cstdint>
+#include "EuclideanRhythm.h"
+
+// Fits the bass rhythm around a kick drum. Candidates are the Euclidean patterns within a few
+// hits of the Hits setting, at every rotation; each is scored against the kick's onsets with a
+// handful of popcounts, so the best of well over a hundred is picked at the bar line without
+// any noticeable cost.
+namespace DrumFit
+{
+    enum class Mode
+    {
+        off,
+        lock,     // On the kicks
+        avoid,    // Anywhere but the kicks
+        interlock // Answering each kick on the step after it
+    };
+
+    constexpr int maxDensityChange = 4; // Hits either side of the setting a fit may use
+
+    // Sixteenth-grid onsets onto the pattern's steps, each to its nearest step
+    constexpr uint32_t toSteps(uint32_t sixteenths, int steps) noexcept
+    {
+        uint32_t mask = 0;
+        for (int slot = 0; slot < 16; ++slot)
+            if (((sixteenths >> slot) & 1u) != 0)
+                mask |= 1u << (((slot * steps + 8) / 16) % steps);
+        return mask;
+    }
+
+    // Higher fits better
+    constexpr int score(uint32_t candidate, uint32_t kick, int steps, Mode mode) noexcept
+    {
+        uint32_t full = (1u << steps) - 1u;
+        int together = std::popcount(candidate & kick);
+        int alone = std::popcount(candidate & ~kick & full);
+
+        switch (mode)
+        {
+            case Mode::lock: return 2 * together - alone;
+            case Mode::avoid: return -together;
+            case Mode::interlock:
+            {
+                uint32_t after = ((kick << 1) | (kick >> (steps - 1))) & full & ~kick;
+                return 2 * std::popcount(candidate & after) - 2 * together;
+            }
+            case Mode::off: break;
+        }
+        return 0;
+    }
+
+    // The best-scoring candidate; ties go to the one closest to the Hits and Rotation settings.
+    // Without a mode or any kicks, the pattern the settings give.
+    inline uint32_t bestMask(uint32_t kick, int steps, int hits, int rotation, Mode mode) noexcept
+    {
+        uint32_t settings = EuclideanRhythm::mask(steps, hits, rotation);
+        if (mode == Mode::off || kick == 0 || hits <= 0 || steps < 2)
+            return settings;
+
+        uint32_t best = settings;
+        int bestScore = INT_MIN;
+        int fewest = hits - maxDensityChange > 1 ? hits - maxDensityChange : 1;
+        int most = hits + maxDensityChange < steps ? hits + maxDensityChange : steps;
+
+        for (int candidateHits = fewest; candidateHits <= most; ++candidateHits)
+        {
+            for (int candidateRotation = 0; candidateRotation < steps; ++candidateRotation)
+            {
+                uint32_t candidate = EuclideanRhythm::mask(steps, candidateHits, candidateRotation);
+
+                int turn = ((candidateRotation - rotation) % steps + steps) % steps;
+                int distance = 2 * (candidateHits > hits ? candidateHits - hits : hits - candidateHits)
+                               + (turn < steps - turn ? turn : steps - turn);
+
+                // Distance only ever breaks ties (it stays below 64)
+                int total = 64 * score(candidate, kick, steps, mode) - distance;
+                if (total > bestScore)
+                {
+                    bestScore = total;
+                    best = candidate;
+                }
+            }
+        }
+
+        return best;
+    }
+}
@@ -1,9 +1,65 @@
 #pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
+// Trigger masks (bit n = step n) for every steps/hits/rotation the parameters allow, built at
+// compile time so every instance in the process shares one read-only copy
+namespace EuclideanTable
+{
+    constexpr int maxSteps = 16;
+    constexpr int maxRotation = 15;
+
+    // Same result as EuclideanRhythm::shouldTrigger(), step by step
+    constexpr uint32_t computeMask(int steps, int hits, int rotation) noexcept
+    {
+        if (hits <= 0 || steps <= 0)
+            return 0;
+
+        uint32_t result = 0;
+        for (int step = 0; step < steps && step < 32; ++step)
+        {
+            int rotatedStep = (step - rotation + steps) % steps;
+            if (hits >= steps || ((rotatedStep * hits) % steps) < hits)
+                result |= 1u << step;
+        }
+        return result;
+    }
+
+    constexpr size_t index(int steps, int hits, int rotation) noexcept
+    {
+        return static_cast<size_t>(((steps - 1) * (maxSteps + 1) + hits) * (maxRotation + 1) + rotation);
+    }
+
+    using Masks = std::array<uint32_t, maxSteps * (maxSteps + 1) * (maxRotation + 1)>;
+
+    constexpr Masks buildMasks() noexcept
+    {
+        Masks masks {};
+        for (int steps = 1; steps <= maxSteps; ++steps)
+            for (int hits = 0; hits <= maxSteps; ++hits)
+                for (int rotation = 0; rotation <= maxRotation; ++rotation)
+                    masks[index(steps, hits, rotation)] = computeMask(steps, hits, rotation);
+        return masks;
+    }
+
+    inline constexpr Masks masks = buildMasks();
+}
+
 class EuclideanRhythm
 {
 public:
+    // Whole pattern as a trigger mask; a table load for anything the parameters can produce
+    static uint32_t mask(int steps, int hits, int rotation) noexcept
+    {
+        if (steps >= 1 && steps <= EuclideanTable::maxSteps && hits >= 0 && hits <= EuclideanTable::maxSteps
+            && rotation >= 0 && rotation <= EuclideanTable::maxRotation)
+            return EuclideanTable::masks[EuclideanTable::index(steps, hits, rotation)];
+
+        return EuclideanTable::computeMask(steps, hits, rotation);
+    }
+
     // Bjorklund's algorithm - returns true if step should trigger
     bool shouldTrigger(int step, int steps, int hits, int rotation) const
     {
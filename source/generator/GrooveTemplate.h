@@ -0,0 +1,93 @@
+#pragma once
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <cmath>
+#include <memory>
+#include "CompiledPattern.h"
+
+// A groove lifted from a reference MIDI file (an MPC swing, a drummer's hats): how early or
+// late, and how hard, each sixteenth of the bar is played on average. It is copied into the
+// compiled pattern and laid over the steps with the rest of the timing, so playback and export
+// read it from the same burst table.
+struct GrooveTemplate
+{
+    static constexpr int numSlots = CompiledPattern::grooveSlots;
+
+    std::array<float, numSlots> offsets{};    // Fractions of a sixteenth, + is late
+    std::array<float, numSlots> velocities{}; // Change in velocity scale, 0 = unchanged
+
+    // nullptr plays straight
+    static void apply(const GrooveTemplate* groove, CompiledPattern& pattern) noexcept
+    {
+        pattern.grooveOffsets = groove != nullptr ? groove->offsets : std::array<float, numSlots>{};
+        pattern.grooveVelocities = groove != nullptr ? groove->velocities : std::array<float, numSlots>{};
+    }
+
+    // Every note-on of every track, snapped to the nearest sixteenth of its bar (bars follow the
+    // file's first time signature). Returns nullptr if the file holds no notes.
+    static std::shared_ptr<const GrooveTemplate> fromMidiFile(const juce::MidiFile& file)
+    {
+        auto ticksPerQuarter = static_cast<double>(file.getTimeFormat());
+        if (ticksPerQuarter <= 0.0)
+            return nullptr; // SMPTE timing isn't supported
+
+        juce::MidiMessageSequence merged;
+        for (int t = 0; t < file.getNumTracks(); ++t)
+            merged.addSequence(*file.getTrack(t), 0.0);
+        merged.sort();
+
+        double beatsPerBar = 4.0;
+        for (int i = 0; i < merged.getNumEvents(); ++i)
+        {
+            const auto& message = merged.getEventPointer(i)->message;
+            if (message.isTimeSignatureMetaEvent())
+            {
+                int numerator = 4, denominator = 4;
+                message.getTimeSignatureInfo(numerator, denominator);
+                if (numerator > 0 && denominator > 0)
+                    beatsPerBar = numerator * 4.0 / denominator;
+                break;
+            }
+        }
+
+        double slotPpq = beatsPerBar / numSlots;
+        std::array<double, numSlots> offsetSums{}, velocitySums{};
+        std::array<int, numSlots> counts{};
+        double totalVelocity = 0.0;
+        int totalNotes = 0;
+
+        for (int i = 0; i < merged.getNumEvents(); ++i)
+        {
+            const auto& message = merged.getEventPointer(i)->message;
+            if (!message.isNoteOn())
+                continue;
+
+            double position = message.getTimeStamp() / ticksPerQuarter / slotPpq;
+            double nearest = std::round(position);
+            auto slot = static_cast<size_t>(static_cast<int64_t>(nearest) % numSlots);
+
+            offsetSums[slot] += position - nearest;
+            velocitySums[slot] += message.getVelocity();
+            ++counts[slot];
+            totalVelocity += message.getVelocity();
+            ++totalNotes;
+        }
+
+        if (totalNotes == 0)
+            return nullptr;
+
+        // Velocities relative to the file's average, so a quiet groove doesn't turn the bass down
+        auto groove = std::make_shared<GrooveTemplate>();
+        double meanVelocity = totalVelocity / totalNotes;
+        for (size_t slot = 0; slot < numSlots; ++slot)
+        {
+            if (counts[slot] == 0)
+                continue;
+
+            groove->offsets[slot] = static_cast<float>(offsetSums[slot] / counts[slot]);
+            groove->velocities[slot] = static_cast<float>(velocitySums[slot] / counts[slot] / meanVelocity - 1.0);
+        }
+
+        return groove;
+    }
+};
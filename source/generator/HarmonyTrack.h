@@ -0,0 +1,234 @@
+#pragma once
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "ChordQuantiser.h"
+
+// A chord progression indexed by song position (in quarter notes).
+// Built once from a MIDI file into a sorted array of chord regions, each carrying its
+// precomputed snap row, so resolving the chord under a step is a cursor check (or a
+// binary search after a seek) and mapping a pitch onto it is one table load.
+class HarmonyTrack
+{
+public:
+    struct Region
+    {
+        double startPpq = 0.0;
+        double endPpq = 0.0;
+        uint16_t chordMask = 0;
+        int bassNote = 0;
+        const ChordQuantiser::OffsetRow* snap = nullptr;
+
+        // Moves a generated note to this chord, keeping the register of rootNote
+        int apply(int pitch, int rootNote) const noexcept
+        {
+            pitch += ChordQuantiser::nearestTranspose(rootNote, bassNote);
+            pitch = ChordQuantiser::quantise(pitch, *snap);
+            return pitch < 0 ? 0 : (pitch > 127 ? 127 : pitch);
+        }
+    };
+
+    // Audio-thread lookup state. Playback moves forward, so the last region (or the next one)
+    // almost always matches; anything else is a seek and falls back to a binary search.
+    class Cursor
+    {
+    public:
+        const Region* find(const HarmonyTrack& track, double ppq) noexcept
+        {
+            if (track.regions.empty())
+                return nullptr;
+
+            ppq = track.wrap(ppq);
+
+            if (&track != lastTrack || index >= track.regions.size())
+            {
+                lastTrack = &track;
+                index = 0;
+            }
+
+            auto contains = [ppq](const Region& r) { return ppq >= r.startPpq && ppq < r.endPpq; };
+
+            if (contains(track.regions[index]))
+                return &track.regions[index];
+
+            if (index + 1 < track.regions.size() && contains(track.regions[index + 1]))
+                return &track.regions[++index];
+
+            index = track.indexAt(ppq);
+            return contains(track.regions[index]) ? &track.regions[index] : nullptr;
+        }
+
+    private:
+        const HarmonyTrack* lastTrack = nullptr;
+        size_t index = 0;
+    };
+
+    // Regions must be sorted and non-overlapping
+    explicit HarmonyTrack(std::vector<Region> sortedRegions, double loopLength)
+        : regions(std::move(sortedRegions)), lengthPpq(loopLength)
+    {
+        for (auto& region : regions)
+            region.snap = &ChordQuantiser::rowFor(region.chordMask);
+    }
+
+    // Reads every note of every track; each change in the set of sounding notes starts a new region.
+    // Returns nullptr if the file holds no notes.
+    static std::shared_ptr<const HarmonyTrack> fromMidiFile(const juce::MidiFile& file)
+    {
+        auto ticksPerQuarter = static_cast<double>(file.getTimeFormat());
+        if (ticksPerQuarter <= 0.0)
+            return nullptr; // SMPTE timing isn't supported
+
+        juce::MidiMessageSequence merged;
+        for (int t = 0; t < file.getNumTracks(); ++t)
+            merged.addSequence(*file.getTrack(t), 0.0);
+        merged.sort();
+
+        // Merge changes closer than this so strummed or sloppy chords don't create slivers
+        constexpr double minRegionPpq = 0.125;
+
+        std::vector<Region> regions;
+        std::array<int, 128> noteCounts {};
+        int numSounding = 0;
+        double regionStart = 0.0;
+        double lastEventPpq = 0.0;
+
+        auto currentRegion = [&](double start, double end)
+        {
+            Region r;
+            r.startPpq = start;
+            r.endPpq = end;
+            r.bassNote = -1;
+            for (int note = 0; note < 128; ++note)
+            {
+                if (noteCounts[static_cast<size_t>(note)] > 0)
+                {
+                    r.chordMask |= static_cast<uint16_t>(1u << (note % 12));
+                    if (r.bassNote < 0)
+                        r.bassNote = note;
+                }
+            }
+            return r;
+        };
+
+        for (int i = 0; i < merged.getNumEvents(); ++i)
+        {
+            const auto& message = merged.getEventPointer(i)->message;
+            if (!message.isNoteOnOrOff())
+                continue;
+
+            auto ppq = message.getTimeStamp() / ticksPerQuarter;
+
+            // Close the region that was sounding up to this change. A change that comes too
+            // soon is part of the same chord (a strum), so that region just keeps going.
+            if (numSounding > 0 && ppq > regionStart)
+            {
+                if (ppq - regionStart >= minRegionPpq)
+                {
+                    regions.push_back(currentRegion(regionStart, ppq));
+                    regionStart = ppq;
+                }
+            }
+            else
+            {
+                regionStart = ppq;
+            }
+            lastEventPpq = ppq;
+
+            auto& count = noteCounts[static_cast<size_t>(message.getNoteNumber())];
+            if (message.isNoteOn())
+            {
+                ++count;
+                ++numSounding;
+            }
+            else if (count > 0)
+            {
+                --count;
+                --numSounding;
+            }
+        }
+
+        if (regions.empty())
+            return nullptr;
+
+        // Let each chord ring until the next one (rests between chords keep the previous harmony)
+        for (size_t r = 0; r + 1 < regions.size(); ++r)
+            regions[r].endPpq = regions[r + 1].startPpq;
+
+        regions.front().startPpq = 0.0;
+
+        // Loop on the bar line after the last event
+        auto loopLength = barLineAtOrAfter(merged, ticksPerQuarter, juce::jmax(lastEventPpq, regions.back().endPpq));
+        regions.back().endPpq = loopLength;
+
+        return std::make_shared<const HarmonyTrack>(std::move(regions), loopLength);
+    }
+
+    const std::vector<Region>& getRegions() const { return regions; }
+    double getLengthPpq() const { return lengthPpq; }
+
+    // Stateless lookup for one-off queries
+    const Region* find(double ppq) const noexcept
+    {
+        if (regions.empty())
+            return nullptr;
+
+        ppq = wrap(ppq);
+        const auto& r = regions[indexAt(ppq)];
+        return (ppq >= r.startPpq && ppq < r.endPpq) ? &r : nullptr;
+    }
+
+private:
+    // Walks the bars from the top, each as long as the file's time signature at its start
+    // says (4/4 until the first one)
+    static double barLineAtOrAfter(const juce::MidiMessageSequence& sequence, double ticksPerQuarter, double ppq)
+    {
+        std::vector<std::pair<double, double>> barLengths; // Position, quarters per bar
+        for (const auto* event : sequence)
+        {
+            if (!event->message.isTimeSignatureMetaEvent())
+                continue;
+
+            int numerator = 4, denominator = 4;
+            event->message.getTimeSignatureInfo(numerator, denominator);
+            if (numerator > 0 && denominator > 0)
+                barLengths.emplace_back(event->message.getTimeStamp() / ticksPerQuarter, numerator * 4.0 / denominator);
+        }
+
+        double barLine = 0.0;
+        double barLength = 4.0;
+        size_t next = 0;
+        while (barLine < ppq)
+        {
+            for (; next < barLengths.size() && barLengths[next].first <= barLine; ++next)
+                barLength = barLengths[next].second;
+            barLine += barLength;
+        }
+        return barLine;
+    }
+
+    // The progression repeats after its last bar
+    double wrap(double ppq) const noexcept
+    {
+        if (lengthPpq <= 0.0)
+            return ppq;
+
+        ppq = std::fmod(ppq, lengthPpq);
+        return ppq < 0.0 ? ppq + lengthPpq : ppq;
+    }
+
+    // Index of the last region starting at or before ppq
+    size_t indexAt(double ppq) const noexcept
+    {
+        auto it = std::upper_bound(regions.begin(), regions.end(), ppq,
+            [](double value, const Region& r) { return value < r.startPpq; });
+
+        return it == regions.begin() ? 0 : static_cast<size_t>(std::distance(regions.begin(), it) - 1);
+    }
+
+    std::vector<Region> regions;
+    double lengthPpq = 0.0;
+};
@@ -0,0 +1,84 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+// Notes currently held on the follow channel, as a 128-bit set.
+// Every update is O(1) and allocation-free, so it can run per incoming MIDI event.
+//
+// Alongside the raw held set we keep a "latched" group: every note pressed since the
+// last time all keys were released. That lets a player lift their hands between chords
+// without the bassline falling back to the parameter root.
+class HeldNotes
+{
+public:
+    void noteOn(int note) noexcept
+    {
+        if (note < 0 || note > 127 || isHeld(note))
+            return;
+
+        // First key of a new chord: forget the previous one
+        if (numHeld == 0)
+        {
+            latchedMask = 0;
+            latchedBass = note;
+        }
+
+        words[static_cast<size_t>(note >> 6)] |= bit(note);
+        ++numHeld;
+
+        latchedMask |= static_cast<uint16_t>(1u << (note % 12));
+        if (note < latchedBass)
+            latchedBass = note;
+    }
+
+    void noteOff(int note) noexcept
+    {
+        if (note < 0 || note > 127 || !isHeld(note))
+            return;
+
+        words[static_cast<size_t>(note >> 6)] &= ~bit(note);
+        --numHeld;
+    }
+
+    void clear() noexcept
+    {
+        words = {};
+        numHeld = 0;
+        latchedMask = 0;
+        latchedBass = -1;
+    }
+
+    bool isHeld(int note) const noexcept
+    {
+        return (words[static_cast<size_t>(note >> 6)] & bit(note)) != 0;
+    }
+
+    int getNumHeld() const noexcept { return numHeld; }
+
+    // Lowest key currently down, or -1
+    int lowestHeld() const noexcept
+    {
+        if (words[0] != 0)
+            return std::countr_zero(words[0]);
+        if (words[1] != 0)
+            return 64 + std::countr_zero(words[1]);
+        return -1;
+    }
+
+    // Pitch classes of the latched chord (bit n = pitch class n), 0 if nothing played yet
+    uint16_t getChordMask() const noexcept { return latchedMask; }
+
+    // Lowest note of the latched chord, or -1 if nothing played yet
+    int getBassNote() const noexcept { return latchedMask != 0 ? latchedBass : -1; }
+
+private:
+    static uint64_t bit(int note) noexcept { return uint64_t { 1 } << (note & 63); }
+
+    std::array<uint64_t, 2> words {};
+    int numHeld = 0;
+
+    uint16_t latchedMask = 0;
+    int latchedBass = -1;
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <cmath>
+#include <memory>
+#include "CompiledPattern.h"
+
+// A drum part reduced to its kick: one sixteenth-grid onset mask per bar, looping. Built from a
+// dropped MIDI file and copied into the compiled pattern, where the phrase generator fits each
+// bar's rhythm to it (see DrumFit).
+struct KickPattern
+{
+    static constexpr int maxBars = CompiledPattern::maxKickBars;
+    static constexpr int slots = 16; // Sixteenths of a bar
+
+    std::array<uint16_t, maxBars> bars{};
+    int numBars = 0;
+
+    // nullptr clears it
+    static void apply(const KickPattern* kick, CompiledPattern& pattern) noexcept
+    {
+        pattern.kickBars = kick != nullptr ? kick->bars : std::array<uint16_t, maxBars>{};
+        pattern.numKickBars = kick != nullptr ? kick->numBars : 0;
+    }
+
+    // Note-ons on the GM kick notes (35, 36), or every note-on if there are none, snapped to the
+    // nearest sixteenth. Bars follow the file's first time signature. Returns nullptr if the file
+    // holds no notes.
+    static std::shared_ptr<const KickPattern> fromMidiFile(const juce::MidiFile& file)
+    {
+        auto ticksPerQuarter = static_cast<double>(file.getTimeFormat());
+        if (ticksPerQuarter <= 0.0)
+            return nullptr; // SMPTE timing isn't supported
+
+        juce::MidiMessageSequence merged;
+        for (int t = 0; t < file.getNumTracks(); ++t)
+            merged.addSequence(*file.getTrack(t), 0.0);
+        merged.sort();
+
+        double beatsPerBar = 4.0;
+        for (int i = 0; i < merged.getNumEvents(); ++i)
+        {
+            const auto& message = merged.getEventPointer(i)->message;
+            if (message.isTimeSignatureMetaEvent())
+            {
+                int numerator = 4, denominator = 4;
+                message.getTimeSignatureInfo(numerator, denominator);
+                if (numerator > 0 && denominator > 0)
+                    beatsPerBar = numerator * 4.0 / denominator;
+                break;
+            }
+        }
+
+        bool hasKickNotes = false;
+        for (int i = 0; i < merged.getNumEvents(); ++i)
+        {
+            const auto& message = merged.getEventPointer(i)->message;
+            hasKickNotes = hasKickNotes || (message.isNoteOn() && isKickNote(message.getNoteNumber()));
+        }
+
+        auto kick = std::make_shared<KickPattern>();
+        double slotPpq = beatsPerBar / slots;
+        int notes = 0;
+
+        for (int i = 0; i < merged.getNumEvents(); ++i)
+        {
+            const auto& message = merged.getEventPointer(i)->message;
+            if (!message.isNoteOn() || (hasKickNotes && !isKickNote(message.getNoteNumber())))
+                continue;
+
+            auto slot = static_cast<int64_t>(std::llround(message.getTimeStamp() / ticksPerQuarter / slotPpq));
+            auto bar = static_cast<int>(slot / slots);
+            if (bar >= maxBars)
+                break;
+
+            kick->bars[static_cast<size_t>(bar)] |= static_cast<uint16_t>(1u << (slot % slots));
+            kick->numBars = std::max(kick->numBars, bar + 1);
+            ++notes;
+        }
+
+        if (notes == 0)
+            return nullptr;
+
+        // Whole bars of the file loop, trailing empty ones included
+        auto fileBars = static_cast<int>(std::ceil(merged.getEndTime() / ticksPerQuarter / beatsPerBar - 1.0e-6));
+        kick->numBars = juce::jlimit(kick->numBars, maxBars, fileBars);
+        return kick;
+    }
+
+    static bool isKickNote(int note) noexcept { return note == 35 || note == 36; }
+};
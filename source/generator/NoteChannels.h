@@ -0,0 +1,169 @@
+#pragma once
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <cstdint>
+
+// Which MIDI channel each note goes out on. Besides a single channel there's a round robin over
+// a block of channels, a channel per note role (plain, accent, slide, ratchet repeat) so each can
+// be voiced differently, and MPE: every note on a member channel of the lower zone, with its own
+// bend, pressure and timbre. Members are handed out from a fixed pool, least recently released
+// first so a synth's release tail isn't cut by the next note. Shared by the processor and the
+// exporter, so both assign the same channels.
+class NoteChannels
+{
+public:
+    enum class Mode
+    {
+        single,
+        roundRobin,
+        byRole,
+        mpe
+    };
+
+    enum class Role
+    {
+        plain,
+        accent,
+        slide,
+        ratchet
+    };
+
+    struct Settings
+    {
+        Mode mode = Mode::single;
+        int channel = 1; // Single channel, or the first of the round robin or roles
+        int count = 15;  // Channels in the round robin, or MPE member channels
+
+        bool operator==(const Settings&) const = default;
+    };
+
+    static constexpr int masterChannel = 1; // Lower zone
+
+    void prepare(const Settings& newSettings) noexcept
+    {
+        if (newSettings == settings)
+            return;
+
+        settings = newSettings;
+        reset();
+    }
+
+    bool isMpe() const noexcept { return settings.mode == Mode::mpe; }
+
+    static Role roleOf(int burstNote, bool slide, bool accented) noexcept
+    {
+        if (burstNote > 0)
+            return Role::ratchet;
+        if (slide)
+            return Role::slide;
+        return accented ? Role::accent : Role::plain;
+    }
+
+    // Forgets every held note; MPE is configured again before the next one
+    void reset() noexcept
+    {
+        slots = {};
+        clock = 0;
+        nextRoundRobin = 0;
+        configured = false;
+    }
+
+    // The channel for a new note. In MPE the first note of a run is preceded by the zone's
+    // configuration, sent to emit(const juce::MidiMessage&).
+    template <typename Emit>
+    int noteOn(int note, Role role, int bendRange, Emit&& emit)
+    {
+        switch (settings.mode)
+        {
+            case Mode::single:
+                return clampChannel(settings.channel);
+
+            case Mode::roundRobin:
+            {
+                int channel = clampChannel(settings.channel + nextRoundRobin);
+                nextRoundRobin = (nextRoundRobin + 1) % juce::jlimit(1, 16, juce::jmin(settings.count, 17 - settings.channel));
+                return channel;
+            }
+
+            case Mode::byRole:
+                return clampChannel(settings.channel + static_cast<int>(role));
+
+            case Mode::mpe:
+                break;
+        }
+
+        int members = juce::jlimit(1, 15, settings.count);
+        if (!configured)
+        {
+            configure(members, bendRange, emit);
+            configured = true;
+        }
+
+        // A free member released longest ago, or failing that the oldest note's
+        int best = -1;
+        for (int channel = masterChannel + 1; channel <= masterChannel + members; ++channel)
+        {
+            const auto& slot = slots[static_cast<size_t>(channel - 1)];
+            if (best < 0)
+            {
+                best = channel;
+                continue;
+            }
+
+            const auto& bestSlot = slots[static_cast<size_t>(best - 1)];
+            bool free = slot.note < 0, bestFree = bestSlot.note < 0;
+            if ((free && !bestFree) || (free == bestFree && slot.since < bestSlot.since))
+                best = channel;
+        }
+
+        auto& slot = slots[static_cast<size_t>(best - 1)];
+        slot.note = note;
+        slot.since = ++clock;
+        return best;
+    }
+
+    void noteOff(int channel, int note) noexcept
+    {
+        if (channel < 1 || channel > 16)
+            return;
+
+        auto& slot = slots[static_cast<size_t>(channel - 1)];
+        if (slot.note == note)
+        {
+            slot.note = -1;
+            slot.since = ++clock;
+        }
+    }
+
+private:
+    struct Slot
+    {
+        int note = -1;
+        uint32_t since = 0; // When it was last taken or released
+    };
+
+    Settings settings;
+    std::array<Slot, 16> slots{};
+    uint32_t clock = 0;
+    int nextRoundRobin = 0;
+    bool configured = false;
+
+    static int clampChannel(int channel) noexcept { return juce::jlimit(1, 16, channel); }
+
+    // MPE configuration message (RPN 6) on the master channel, then each member's bend range
+    // (RPN 0), since the zone's default of 48 semitones rarely matches the bend range set here
+    template <typename Emit>
+    static void configure(int members, int bendRange, Emit& emit)
+    {
+        auto rpn = [&](int channel, int number, int value)
+        {
+            emit(juce::MidiMessage::controllerEvent(channel, 101, 0));
+            emit(juce::MidiMessage::controllerEvent(channel, 100, number));
+            emit(juce::MidiMessage::controllerEvent(channel, 6, value));
+        };
+
+        rpn(masterChannel, 6, members);
+        for (int channel = masterChannel + 1; channel <= masterChannel + members; ++channel)
+            rpn(channel, 0, juce::jlimit(0, 127, bendRange));
+    }
+};
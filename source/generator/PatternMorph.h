@@ -0,0 +1,229 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include "CompiledPattern.h"
+#include "CounterRng.h"
+
+// Crossfade between two stored bars, A and B, along a morph position from 0 (A) to 1 (B).
+//   - Triggers: steps where A and B disagree switch over one by one, each at its own fixed
+//     random point, so halfway plays about half of B's differences
+//   - Pitches: scale degrees are blended, so a step walks through the notes between A's and B's
+//   - Velocities: blended linearly
+//
+// A step's output only changes at a few points along the morph, so each step remembers the
+// range of positions its current output holds for. Moving the morph recomputes only the steps
+// that left their range; a sweep under dense automation costs a compare per step per block.
+//
+// Only the bar's content is morphed. The step count and the pitch and accent cycle lengths
+// decide what the steps mean, so both slots have to share the pattern's (see fit()).
+class PatternMorph
+{
+public:
+    static constexpr int maxSteps = CompiledPattern::maxSteps;
+    static constexpr int resolution = 1024; // Positions along the morph
+
+    // One stored bar: what each step plays, and where its pitch sits in the scale
+    struct Slot
+    {
+        uint32_t triggerMask = 0;
+        std::array<int, maxSteps> pitches{};
+        std::array<int, maxSteps> velocities{};
+        std::array<int, maxSteps> degrees{}; // Index into notes
+        std::array<uint8_t, ScaleEngine::PitchTable::maxEntries> notes{};
+        int numNotes = 0;
+
+        // Not morphed
+        int steps = 0;
+        int pitchCycle = 0;
+        int accentCycle = 0;
+
+        bool fits(const CompiledPattern& pattern) const noexcept
+        {
+            return steps == pattern.steps && pitchCycle == pattern.pitchCycle() && accentCycle == pattern.accentCycle();
+        }
+
+        static Slot capture(const CompiledPattern& pattern) noexcept
+        {
+            Slot slot;
+            slot.steps = pattern.steps;
+            slot.pitchCycle = pattern.pitchCycle();
+            slot.accentCycle = pattern.accentCycle();
+            slot.triggerMask = pattern.triggerMask;
+            slot.pitches = pattern.pitches;
+            slot.velocities = pattern.velocities;
+
+            const auto& table = pattern.getPitchTable();
+            slot.notes = table.notes;
+            slot.numNotes = std::max(1, table.scaleSize * table.octaveRange);
+
+            // Nearest table entry, for pitches that voice leading or follow moved off the scale
+            for (int step = 0; step < maxSteps; ++step)
+            {
+                int best = 0;
+                for (int i = 1; i < slot.numNotes; ++i)
+                    if (std::abs(slot.notes[static_cast<size_t>(i)] - slot.pitches[static_cast<size_t>(step)])
+                        < std::abs(slot.notes[static_cast<size_t>(best)] - slot.pitches[static_cast<size_t>(step)]))
+                        best = i;
+                slot.degrees[static_cast<size_t>(step)] = best;
+            }
+
+            return slot;
+        }
+    };
+
+    struct Slots
+    {
+        Slot a, b;
+
+        // Whether the morph can play over the pattern: both slots stored with its step count
+        // and cycle lengths
+        bool fit(const CompiledPattern& pattern) const noexcept { return a.fits(pattern) && b.fits(pattern); }
+    };
+
+    // Audio thread. Moves to the morph position (0..1) and returns true if any step's output
+    // changed. New slots recompute every step.
+    bool update(const Slots& slots, float morph) noexcept
+    {
+        int position = static_cast<int>(std::lround(std::clamp(morph, 0.0f, 1.0f) * resolution));
+        if (&slots != source)
+        {
+            source = &slots;
+            for (auto& range : ranges)
+                range = {};
+        }
+        else if (position == lastPosition)
+        {
+            return false;
+        }
+
+        lastPosition = position;
+
+        bool changed = false;
+        for (int step = 0; step < maxSteps; ++step)
+        {
+            auto& range = ranges[static_cast<size_t>(step)];
+            if (position >= range.begin && position < range.end)
+                continue;
+
+            computeStep(slots, step, position);
+            changed = true;
+        }
+
+        return changed;
+    }
+
+    // Forget the slots, e.g. when they are cleared and published again at the same address
+    void reset() noexcept { source = nullptr; }
+
+    // The morphed bar
+    uint32_t triggerMask = 0;
+    std::array<int, maxSteps> pitches{};
+    std::array<int, maxSteps> velocities{};
+
+private:
+    // Positions [begin, end) over which a step's output stays the same
+    struct Range
+    {
+        int begin = 0;
+        int end = 0;
+    };
+
+    // Round-to-nearest of a + (b - a) * position / resolution, in integers
+    static int blend(int a, int b, int position) noexcept
+    {
+        int64_t numerator = 2 * static_cast<int64_t>(b - a) * position + resolution;
+        int64_t denominator = 2 * static_cast<int64_t>(resolution);
+        int64_t quotient = numerator / denominator;
+        if (numerator % denominator != 0 && numerator < 0)
+            --quotient;
+        return a + static_cast<int>(quotient);
+    }
+
+    // Where a step swaps A's trigger for B's: a fixed point in (0, resolution]
+    static int triggerSwitch(int step) noexcept
+    {
+        auto u = CounterRng::unit(CounterRng::get(0, 0, step, CounterRng::morphSwitch));
+        return 1 + static_cast<int>(u * resolution);
+    }
+
+    // Shrinks range to the positions around position where f keeps its value. f is monotonic
+    // in position, so that set is an interval and its ends are found by bisection.
+    template <typename F>
+    static void narrow(Range& range, int position, F&& f) noexcept
+    {
+        auto value = f(position);
+
+        int low = range.begin, high = position; // f(high) == value
+        while (low < high)
+        {
+            int mid = low + (high - low) / 2;
+            if (f(mid) == value)
+                high = mid;
+            else
+                low = mid + 1;
+        }
+        range.begin = low;
+
+        low = position;
+        high = range.end - 1; // Largest position with f == value
+        while (low < high)
+        {
+            int mid = low + (high - low + 1) / 2;
+            if (f(mid) == value)
+                low = mid;
+            else
+                high = mid - 1;
+        }
+        range.end = low + 1;
+    }
+
+    void computeStep(const Slots& slots, int step, int position) noexcept
+    {
+        auto index = static_cast<size_t>(step);
+        const auto& a = slots.a;
+        const auto& b = slots.b;
+
+        int switchAt = triggerSwitch(step);
+        auto trigger = [&](int p) { return p < switchAt ? (a.triggerMask >> step) & 1u : (b.triggerMask >> step) & 1u; };
+        auto useB = [](int p) { return 2 * p >= resolution; }; // Which slot's scale the degree is read from
+        auto degree = [&](int p) { return blend(a.degrees[index], b.degrees[index], p); };
+        auto velocity = [&](int p) { return blend(a.velocities[index], b.velocities[index], p); };
+
+        if (trigger(position) != 0)
+            triggerMask |= 1u << step;
+        else
+            triggerMask &= ~(1u << step);
+
+        const auto& scale = useB(position) ? b : a;
+        int blended = std::clamp(degree(position), 0, scale.numNotes - 1);
+        pitches[index] = scale.notes[static_cast<size_t>(blended)];
+        velocities[index] = std::clamp(velocity(position), 1, 127);
+
+        // Ends stay exact: a step plays A at 0 and B at 1 even when B's pitch isn't in A's scale
+        if (position == 0)
+            pitches[index] = a.pitches[index];
+        else if (position == resolution)
+            pitches[index] = b.pitches[index];
+
+        Range range { 0, resolution + 1 };
+        narrow(range, position, trigger);
+        narrow(range, position, useB);
+        narrow(range, position, degree);
+        narrow(range, position, velocity);
+        range.begin = std::max(range.begin, 1);
+        range.end = std::min(range.end, resolution);
+        if (position == 0)
+            range = { 0, 1 };
+        else if (position == resolution)
+            range = { resolution, resolution + 1 };
+
+        ranges[index] = range;
+    }
+
+    const Slots* source = nullptr;
+    int lastPosition = -1;
+    std::array<Range, maxSteps> ranges{};
+};
@@ -7,6 +7,10 @@ struct PatternState
     std::atomic<int> currentStep{0};
     std::atomic<bool> isPlaying{false};
 
+    // Position in the combined rhythm/pitch/accent cycle (polymeter)
+    std::atomic<int> cycleStep{0};
+    std::atomic<int> cycleLength{0};
+
     // For UI visualization - updated from audio thread via lock-free mechanism
     // In MVP, UI can poll currentStep for display
 };
@@ -0,0 +1,271 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <numeric>
+#include "CompiledPattern.h"
+#include "CounterRng.h"
+#include "DrumFit.h"
+
+// Multi-bar variation on top of the compiled bar: fills every N bars, per-step pitch mutation,
+// rotation drift, polymetric pitch/accent cycles, humanize, hit probability and fitting the
+// rhythm to a kick pattern. Bars are computed on demand from
+// (pattern, bar index) alone and memoised in a tiny cache, so playback only ever builds the bar
+// it is about to play and an export costs work proportional to its length.
+class PhraseGenerator
+{
+public:
+    static constexpr int maxSteps = CompiledPattern::maxSteps;
+    static constexpr int cacheSize = 4; // Power of two; current bar, next bar and a little slack
+
+    struct Bar
+    {
+        int index = -1;
+        int steps = 0;
+        bool isFill = false;
+        uint32_t triggerMask = 0;
+        uint32_t accentMask = 0; // Steps at the start of an accent cycle
+        std::array<int, maxSteps> pitches{};
+        std::array<int, maxSteps> velocities{};
+        std::array<float, maxSteps> shifts{}; // Humanized timing, fractions of a step (+ is late)
+
+        bool triggers(int step) const noexcept
+        {
+            return step >= 0 && step < steps && ((triggerMask >> step) & 1u) != 0;
+        }
+
+        bool accented(int step) const noexcept
+        {
+            return step >= 0 && step < steps && ((accentMask >> step) & 1u) != 0;
+        }
+    };
+
+    struct Event
+    {
+        int bar = 0;
+        int step = 0;
+        int pitch = 0;
+        int velocity = 0;
+        float shift = 0.0f;
+        bool accent = false;
+    };
+
+    explicit PhraseGenerator(const CompiledPattern& compiledPattern) noexcept
+        : pattern(compiledPattern)
+    {
+    }
+
+    // Call whenever the compiled pattern changes
+    void invalidate() noexcept
+    {
+        for (auto& entry : cache)
+            entry.index = -1;
+    }
+
+    // Allocation-free; negative indices (pre-roll) play bar 0
+    const Bar& bar(int index) noexcept
+    {
+        if (index < 0)
+            index = 0;
+
+        auto& entry = cache[static_cast<size_t>(index & (cacheSize - 1))];
+        if (entry.index != index)
+            computeBar(index, entry);
+
+        return entry;
+    }
+
+    // Pull-based stream of the notes in bars [firstBar, firstBar + numBars)
+    class EventIterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Event;
+        using difference_type = std::ptrdiff_t;
+
+        EventIterator() = default;
+        EventIterator(PhraseGenerator& owner, int firstBar, int endBar) noexcept
+            : generator(&owner), barIndex(firstBar), lastBar(endBar)
+        {
+            findNext();
+        }
+
+        Event operator*() const noexcept
+        {
+            const auto& current = generator->bar(barIndex);
+            return { barIndex, step, current.pitches[static_cast<size_t>(step)],
+                     current.velocities[static_cast<size_t>(step)], current.shifts[static_cast<size_t>(step)],
+                     current.accented(step) };
+        }
+
+        EventIterator& operator++() noexcept
+        {
+            ++step;
+            findNext();
+            return *this;
+        }
+
+        void operator++(int) noexcept { ++*this; }
+
+        bool operator==(std::default_sentinel_t) const noexcept { return barIndex >= lastBar; }
+
+    private:
+        void findNext() noexcept
+        {
+            while (barIndex < lastBar)
+            {
+                const auto& current = generator->bar(barIndex);
+                for (; step < current.steps; ++step)
+                {
+                    if (current.triggers(step))
+                        return;
+                }
+
+                ++barIndex;
+                step = 0;
+            }
+        }
+
+        PhraseGenerator* generator = nullptr;
+        int barIndex = 0;
+        int lastBar = 0;
+        int step = 0;
+    };
+
+    struct EventRange
+    {
+        PhraseGenerator& generator;
+        int firstBar;
+        int numBars;
+
+        EventIterator begin() const noexcept { return { generator, firstBar, firstBar + numBars }; }
+        std::default_sentinel_t end() const noexcept { return {}; }
+    };
+
+    EventRange events(int firstBar, int numBars) noexcept { return { *this, firstBar, numBars }; }
+
+    static bool isFillBar(int index, int fillEvery) noexcept
+    {
+        return fillEvery > 1 && index % fillEvery == fillEvery - 1;
+    }
+
+    // Bars until the phrase repeats exactly (ignoring mutation, and humanize and probability
+    // without a variation cycle, which never repeat)
+    int64_t cycleBars() const noexcept
+    {
+        int steps = pattern.steps < 1 ? 1 : (pattern.steps > maxSteps ? maxSteps : pattern.steps);
+        auto bars = pattern.cycleSteps() / steps;
+
+        if (pattern.fillEvery > 1)
+            bars = std::lcm(bars, static_cast<int64_t>(pattern.fillEvery));
+        if (pattern.rotationDrift % steps != 0)
+            bars = std::lcm(bars, static_cast<int64_t>(steps / std::gcd(steps, pattern.rotationDrift % steps)));
+        if (pattern.variationCycle > 0 && hasVariation())
+            bars = std::lcm(bars, static_cast<int64_t>(pattern.variationCycle));
+        if (pattern.kickMode != 0 && pattern.numKickBars > 0)
+            bars = std::lcm(bars, static_cast<int64_t>(pattern.numKickBars));
+
+        return bars;
+    }
+
+private:
+    bool hasVariation() const noexcept
+    {
+        return pattern.humanize > 0 || pattern.humanizeTiming > 0.0f || pattern.probability < 1.0f;
+    }
+
+    void computeBar(int index, Bar& out) const noexcept
+    {
+        int steps = pattern.steps < 1 ? 1 : (pattern.steps > maxSteps ? maxSteps : pattern.steps);
+        uint32_t fullMask = (1u << steps) - 1u;
+
+        out.index = index;
+        out.steps = steps;
+        out.isFill = isFillBar(index, pattern.fillEvery);
+
+        // Polymeter: pitch and accent sequences are addressed by the step count since bar 0
+        auto firstStep = static_cast<int64_t>(index) * steps;
+        out.accentMask = 0;
+        for (int step = 0; step < steps; ++step)
+        {
+            out.pitches[static_cast<size_t>(step)] = pattern.pitchAt(firstStep + step);
+            out.velocities[static_cast<size_t>(step)] = pattern.velocityAt(firstStep + step);
+            out.shifts[static_cast<size_t>(step)] = 0.0f;
+            if (pattern.isAccent(firstStep + step))
+                out.accentMask |= 1u << step;
+        }
+
+        // Rotation drift: the rhythm turns by a few steps each bar, pitches stay on their steps
+        uint32_t mask = pattern.triggerMask & fullMask;
+        int shift = static_cast<int>((static_cast<int64_t>(index) * pattern.rotationDrift) % steps);
+        if (shift > 0)
+            mask = ((mask << shift) | (mask >> (steps - shift))) & fullMask;
+
+        // Kick fit: the candidate that sits best against this bar's kick takes over
+        if (pattern.kickMode != 0 && pattern.numKickBars > 0)
+        {
+            auto kick = pattern.kickBars[static_cast<size_t>(index % pattern.numKickBars)];
+            if (kick != 0)
+                mask = DrumFit::bestMask(DrumFit::toSteps(kick, steps), steps, pattern.hits, pattern.rotation,
+                                         static_cast<DrumFit::Mode>(pattern.kickMode)) & fullMask;
+        }
+
+        // Humanize and probability are drawn per bar, so every repeat differs; with a variation
+        // cycle the draws repeat every few bars instead
+        int variationBar = pattern.variationCycle > 0 ? index % pattern.variationCycle : index;
+        if (hasVariation())
+        {
+            for (int step = 0; step < steps; ++step)
+            {
+                auto& velocity = out.velocities[static_cast<size_t>(step)];
+                if (pattern.humanize > 0)
+                {
+                    auto spread = static_cast<uint32_t>(2 * pattern.humanize + 1);
+                    velocity += static_cast<int>(CounterRng::get(pattern.seed, variationBar, step, CounterRng::humanizeVelocity) % spread) - pattern.humanize;
+                    velocity = velocity < 1 ? 1 : (velocity > 127 ? 127 : velocity);
+                }
+
+                float jitter = CounterRng::unit(CounterRng::get(pattern.seed, variationBar, step, CounterRng::humanizeTiming));
+                out.shifts[static_cast<size_t>(step)] = pattern.humanizeTiming * (2.0f * jitter - 1.0f);
+
+                if (CounterRng::unit(CounterRng::get(pattern.seed, variationBar, step, CounterRng::probability)) >= pattern.probability)
+                    mask &= ~(1u << step);
+            }
+        }
+
+        const auto& table = pattern.getPitchTable();
+
+        // Pitch mutation: each step independently swaps to another tone from the pitch model
+        if (index > 0 && pattern.mutation > 0.0f)
+        {
+            for (int step = 0; step < steps; ++step)
+            {
+                if (CounterRng::unit(CounterRng::get(pattern.seed, index, step, CounterRng::mutationChance)) >= pattern.mutation)
+                    continue;
+
+                int entry = pattern.pitchModel.sample(-1, CounterRng::get(pattern.seed, index, step, CounterRng::mutationPitch));
+                out.pitches[static_cast<size_t>(step)] = table.notes[static_cast<size_t>(entry)];
+            }
+        }
+
+        // Fill: the last quarter of the bar becomes a rising scale run
+        if (out.isFill)
+        {
+            int fillLength = steps / 4 > 0 ? steps / 4 : 1;
+            int degree = static_cast<int>(CounterRng::get(pattern.seed, index, 0, CounterRng::fillStart) % static_cast<uint32_t>(table.scaleSize));
+            int notesInTable = table.scaleSize * table.octaveRange;
+
+            for (int step = steps - fillLength; step < steps; ++step, ++degree)
+            {
+                mask |= 1u << step;
+                int wrapped = degree % notesInTable;
+                out.pitches[static_cast<size_t>(step)] = table.note(wrapped % table.scaleSize, wrapped / table.scaleSize);
+            }
+        }
+
+        out.triggerMask = mask;
+    }
+
+    const CompiledPattern& pattern;
+    std::array<Bar, cacheSize> cache{};
+};
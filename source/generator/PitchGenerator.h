@@ -1,25 +1,32 @@
 #pragma once
-#include <vector>
 #include <random>
+#include "ScaleEngine.h"
 
+// The uniform pitch model: the pitch draws the plugin shipped with. It stays on std::mt19937
+// rather than CounterRng because every saved session and preset on this model was written
+// against these draws, and a seed has to keep playing the line it played. It is only run
+// when the pitch parameters change, at most once per step, and it doesn't allocate.
 class PitchGenerator
 {
 public:
     int generatePitch(int rootNote, int scaleIndex, int octaveRange,
-                      int step, int seed)
+                      int step, int seed) const
     {
-        // Seed the generator deterministically based on step + seed
-        std::mt19937 rng(seed + step * 127);
+        return generatePitch(ScaleEngine::lookup(scaleIndex, rootNote, octaveRange), step, seed);
+    }
 
-        const auto& scale = scales[scaleIndex];
-        int scaleSize = static_cast<int>(scale.size());
+    // Picks a degree and octave, then resolves the note from the shared table
+    int generatePitch(const ScaleEngine::PitchTable& table, int step, int seed) const
+    {
+        // Seed the generator deterministically based on step + seed
+        std::mt19937 rng(static_cast<std::mt19937::result_type>(seed + step * 127));
 
         // Pick random scale degree
-        std::uniform_int_distribution<int> scaleDist(0, scaleSize - 1);
+        std::uniform_int_distribution<int> scaleDist(0, table.scaleSize - 1);
         int degree = scaleDist(rng);
 
         // Pick octave
-        std::uniform_int_distribution<int> octaveDist(0, octaveRange - 1);
+        std::uniform_int_distribution<int> octaveDist(0, table.octaveRange - 1);
         int octave = octaveDist(rng);
 
         // Weight toward root note on beat 1
@@ -33,16 +40,6 @@ public:
             }
         }
 
-        return rootNote + scale[degree] + (octave * 12);
+        return table.note(degree, octave);
     }
-
-private:
-    // Scale intervals from root
-    const std::vector<std::vector<int>> scales = {
-        {0, 3, 5, 7, 10},           // Minor Pentatonic
-        {0, 2, 4, 5, 7, 9, 11},     // Major
-        {0, 2, 3, 5, 7, 8, 10},     // Minor (Natural)
-        {0, 2, 3, 5, 7, 9, 10},     // Dorian
-        {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11} // Chromatic
-    };
 };
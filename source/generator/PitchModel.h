@@ -0,0 +1,204 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include "ScaleEngine.h"
+
+// Walker/Vose alias table: O(1) sampling from a discrete distribution with a single 32-bit draw.
+// The high half of random * size picks a column, the low half decides column vs alias.
+template <int MaxOutcomes>
+struct AliasTable
+{
+    std::array<uint32_t, MaxOutcomes> threshold {};
+    std::array<uint8_t, MaxOutcomes> alias {};
+    int size = 0;
+
+    // Weights need not be normalised; all-zero weights become uniform. No allocation.
+    void build(const float* weights, int count) noexcept
+    {
+        size = count < 1 ? 1 : (count > MaxOutcomes ? MaxOutcomes : count);
+
+        double total = 0.0;
+        for (int i = 0; i < size; ++i)
+            total += weights[i] > 0.0f ? weights[i] : 0.0f;
+
+        std::array<double, MaxOutcomes> scaled {};
+        std::array<uint8_t, MaxOutcomes> small {}, large {};
+        int numSmall = 0, numLarge = 0;
+
+        for (int i = 0; i < size; ++i)
+        {
+            double w = weights[i] > 0.0f ? weights[i] : 0.0f;
+            scaled[static_cast<size_t>(i)] = total > 0.0 ? w * size / total : 1.0;
+            alias[static_cast<size_t>(i)] = static_cast<uint8_t>(i);
+
+            if (scaled[static_cast<size_t>(i)] < 1.0)
+                small[static_cast<size_t>(numSmall++)] = static_cast<uint8_t>(i);
+            else
+                large[static_cast<size_t>(numLarge++)] = static_cast<uint8_t>(i);
+        }
+
+        while (numSmall > 0 && numLarge > 0)
+        {
+            auto s = small[static_cast<size_t>(--numSmall)];
+            auto l = large[static_cast<size_t>(numLarge - 1)];
+
+            threshold[s] = toThreshold(scaled[s]);
+            alias[s] = l;
+
+            scaled[l] -= 1.0 - scaled[s];
+            if (scaled[l] < 1.0)
+            {
+                --numLarge;
+                small[static_cast<size_t>(numSmall++)] = l;
+            }
+        }
+
+        // Leftovers are 1.0 up to rounding
+        while (numLarge > 0)
+            threshold[large[static_cast<size_t>(--numLarge)]] = UINT32_MAX;
+        while (numSmall > 0)
+            threshold[small[static_cast<size_t>(--numSmall)]] = UINT32_MAX;
+    }
+
+    int sample(uint32_t random) const noexcept
+    {
+        uint64_t product = static_cast<uint64_t>(random) * static_cast<uint64_t>(size);
+        auto column = static_cast<size_t>(product >> 32);
+        return static_cast<uint32_t>(product) < threshold[column] ? static_cast<int>(column) : alias[column];
+    }
+
+private:
+    static uint32_t toThreshold(double probability) noexcept
+    {
+        return probability >= 1.0 ? UINT32_MAX : static_cast<uint32_t>(probability * 4294967296.0);
+    }
+};
+
+// How the next pitch is chosen. Outcomes are pitch table entries (octave * scaleSize + degree),
+// so every model works for any scale, including imported ones.
+class PitchModel
+{
+public:
+    enum class Type
+    {
+        uniform,  // Original behaviour: any degree, root bias on step 0 (see PitchGenerator)
+        weighted, // Per-degree weights favouring root, fifth and third
+        markov,   // First-order transitions between degrees: tonal pull plus stepwise motion
+        walk      // Interval-weighted walk: small leaps are likelier than large ones
+    };
+
+    static constexpr int maxEntries = ScaleEngine::PitchTable::maxEntries;
+
+    // Spread is used in steps of 1/spreadLevels (the parameter snaps to them), so a sweep
+    // rebuilds the tables at most that many times, from weights worked out once per level
+    static constexpr int spreadLevels = 32;
+
+    Type getType() const noexcept { return type; }
+    bool dependsOnPrevious() const noexcept { return type == Type::markov || type == Type::walk; }
+
+    // Rebuilds the alias tables; spread 0 = focused, 1 = close to uniform
+    void compile(Type modelType, const ScaleEngine::PitchTable& table, float spread) noexcept
+    {
+        type = modelType;
+        numEntries = table.scaleSize * table.octaveRange;
+        if (numEntries < 1)
+            numEntries = 1;
+
+        std::array<float, maxEntries> weights {};
+        const auto& level = weightsAt(spread);
+
+        // Stationary distribution, used for the first note and by phrase mutation
+        for (int to = 0; to < numEntries; ++to)
+            weights[static_cast<size_t>(to)] = type == Type::uniform ? 1.0f : tonalWeight(table, to, level);
+        stationary.build(weights.data(), numEntries);
+
+        if (!dependsOnPrevious())
+            return;
+
+        for (int from = 0; from < numEntries; ++from)
+        {
+            for (int to = 0; to < numEntries; ++to)
+            {
+                weights[static_cast<size_t>(to)] = type == Type::markov ? markovWeight(table, from, to, level)
+                                                                        : walkWeight(table, from, to, level);
+            }
+            transitions[static_cast<size_t>(from)].build(weights.data(), numEntries);
+        }
+    }
+
+    // One draw; previousEntry < 0 samples the stationary distribution
+    int sample(int previousEntry, uint32_t random) const noexcept
+    {
+        if (dependsOnPrevious() && previousEntry >= 0 && previousEntry < numEntries)
+            return transitions[static_cast<size_t>(previousEntry)].sample(random);
+
+        return stationary.sample(random);
+    }
+
+private:
+    static int semitonesAboveRoot(const ScaleEngine::PitchTable& table, int entry) noexcept
+    {
+        return table.notes[static_cast<size_t>(entry)] - table.notes[0];
+    }
+
+    // The weights below for one spread level
+    struct LevelWeights
+    {
+        std::array<float, 5> tonal {};  // By tonal weight, 1 to 4
+        std::array<float, 3> motion {}; // Repeat, step, leap
+        std::array<float, 128> walk {}; // By leap in semitones
+    };
+
+    // Built the first time a pattern is compiled, which is on the message thread
+    static const LevelWeights& weightsAt(float spread) noexcept
+    {
+        static const auto levels = []
+        {
+            std::array<LevelWeights, spreadLevels + 1> built {};
+            for (int level = 0; level <= spreadLevels; ++level)
+            {
+                auto& weights = built[static_cast<size_t>(level)];
+                float levelSpread = static_cast<float>(level) / spreadLevels;
+                for (int weight = 1; weight <= 4; ++weight)
+                    weights.tonal[static_cast<size_t>(weight)] = std::pow(static_cast<float>(weight), 1.0f - levelSpread);
+
+                weights.motion = { std::pow(0.5f, 1.0f - levelSpread), std::pow(2.0f, 1.0f - levelSpread), 1.0f };
+                for (int leap = 0; leap < 128; ++leap)
+                    weights.walk[static_cast<size_t>(leap)] = std::exp(-static_cast<float>(leap) / (1.0f + levelSpread * 11.0f));
+            }
+            return built;
+        }();
+
+        auto level = std::clamp(static_cast<int>(std::lround(spread * spreadLevels)), 0, spreadLevels);
+        return levels[static_cast<size_t>(level)];
+    }
+
+    // Root, fifth and thirds carry the harmony, so they weigh more
+    static float tonalWeight(const ScaleEngine::PitchTable& table, int entry, const LevelWeights& level) noexcept
+    {
+        int interval = semitonesAboveRoot(table, entry) % 12;
+        int weight = interval == 0 ? 4 : (interval == 7 ? 3 : (interval == 3 || interval == 4 ? 2 : 1));
+        return level.tonal[static_cast<size_t>(weight)];
+    }
+
+    static float markovWeight(const ScaleEngine::PitchTable& table, int from, int to, const LevelWeights& level) noexcept
+    {
+        int degreeDistance = std::abs(to % table.scaleSize - from % table.scaleSize);
+        int motion = to == from ? 0 : (degreeDistance == 1 ? 1 : 2);
+        return tonalWeight(table, to, level) * level.motion[static_cast<size_t>(motion)];
+    }
+
+    static float walkWeight(const ScaleEngine::PitchTable& table, int from, int to, const LevelWeights& level) noexcept
+    {
+        int leap = std::abs(semitonesAboveRoot(table, to) - semitonesAboveRoot(table, from));
+        return level.walk[static_cast<size_t>(std::min(leap, 127))];
+    }
+
+    Type type = Type::uniform;
+    int numEntries = 1;
+    AliasTable<maxEntries> stationary;
+    std::array<AliasTable<maxEntries>, maxEntries> transitions {};
+};
@@ -0,0 +1,165 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+// Scales and the pitch lookup tables built from them.
+//
+// Built-in scales are constexpr interval arrays. For every (scale, root, octave range) the
+// parameters allow, a flat degree-to-note table is generated at compile time, so every
+// PitchGenerator, visualizer, exporter and processor in the process shares the same
+// read-only data and resolving a pitch is a single indexed load.
+namespace ScaleEngine
+{
+    constexpr int maxDegrees = 24; // Imported scales with a wide period can have more than 12
+    constexpr int minRoot = 24;    // Range of the rootNote parameter
+    constexpr int maxRoot = 48;
+    constexpr int maxOctaves = 2;  // Range of the octaveRange parameter
+    constexpr int numRoots = maxRoot - minRoot + 1;
+
+    struct ScaleDefinition
+    {
+        const char* name = "";
+        int size = 0;
+        std::array<int8_t, maxDegrees> intervals {}; // Semitones above the root, ascending
+        int period = 12;                              // Semitones per repeat (12 = octave)
+    };
+
+    constexpr ScaleDefinition makeScale(const char* name, std::initializer_list<int> intervals)
+    {
+        ScaleDefinition scale;
+        scale.name = name;
+        for (auto interval : intervals)
+            scale.intervals[static_cast<size_t>(scale.size++)] = static_cast<int8_t>(interval);
+        return scale;
+    }
+
+    // The first five keep their original order so saved sessions load the same scale
+    inline constexpr std::array builtInScales {
+        makeScale("Minor Pentatonic", { 0, 3, 5, 7, 10 }),
+        makeScale("Major", { 0, 2, 4, 5, 7, 9, 11 }),
+        makeScale("Minor", { 0, 2, 3, 5, 7, 8, 10 }),
+        makeScale("Dorian", { 0, 2, 3, 5, 7, 9, 10 }),
+        makeScale("Chromatic", { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 }),
+        makeScale("Major Pentatonic", { 0, 2, 4, 7, 9 }),
+        makeScale("Blues", { 0, 3, 5, 6, 7, 10 }),
+        makeScale("Phrygian", { 0, 1, 3, 5, 7, 8, 10 }),
+        makeScale("Lydian", { 0, 2, 4, 6, 7, 9, 11 }),
+        makeScale("Mixolydian", { 0, 2, 4, 5, 7, 9, 10 }),
+        makeScale("Locrian", { 0, 1, 3, 5, 6, 8, 10 }),
+        makeScale("Harmonic Minor", { 0, 2, 3, 5, 7, 8, 11 }),
+        makeScale("Melodic Minor", { 0, 2, 3, 5, 7, 9, 11 }),
+        makeScale("Phrygian Dominant", { 0, 1, 4, 5, 7, 8, 10 }),
+        makeScale("Hungarian Minor", { 0, 2, 3, 6, 7, 8, 11 }),
+        makeScale("Whole Tone", { 0, 2, 4, 6, 8, 10 }),
+        makeScale("Diminished", { 0, 2, 3, 5, 6, 8, 9, 11 }),
+        makeScale("Hirajoshi", { 0, 2, 3, 7, 8 }),
+        makeScale("In Sen", { 0, 1, 5, 7, 10 })
+    };
+
+    constexpr int numBuiltInScales = static_cast<int>(builtInScales.size());
+
+    // Choice index of the imported (Scala) scale, after the built-ins
+    constexpr int userScaleIndex = numBuiltInScales;
+
+    // Degree-to-note table for one (scale, root, octave range): entry octave * scaleSize + degree
+    struct PitchTable
+    {
+        static constexpr int maxEntries = maxDegrees * maxOctaves;
+
+        std::array<uint8_t, maxEntries> notes {};
+        int scaleSize = 0;
+        int octaveRange = 1;
+        int rootNote = 0;
+
+        int note(int degree, int octave) const noexcept
+        {
+            return notes[static_cast<size_t>(octave * scaleSize + degree)];
+        }
+    };
+
+    constexpr PitchTable buildPitchTable(const ScaleDefinition& scale, int rootNote, int octaveRange)
+    {
+        PitchTable table;
+        table.scaleSize = scale.size;
+        table.octaveRange = octaveRange;
+        table.rootNote = rootNote;
+
+        for (int octave = 0; octave < octaveRange; ++octave)
+        {
+            for (int degree = 0; degree < scale.size; ++degree)
+            {
+                int note = rootNote + scale.intervals[static_cast<size_t>(degree)] + octave * scale.period;
+                table.notes[static_cast<size_t>(octave * scale.size + degree)] = static_cast<uint8_t>(std::clamp(note, 0, 127));
+            }
+        }
+        return table;
+    }
+
+    constexpr size_t tableIndex(int scaleIndex, int rootNote, int octaveRange)
+    {
+        return static_cast<size_t>((scaleIndex * numRoots + (rootNote - minRoot)) * maxOctaves + (octaveRange - 1));
+    }
+
+    // Every table a scale needs across the parameter ranges
+    template <size_t NumScales>
+    struct TableSet
+    {
+        std::array<PitchTable, NumScales * numRoots * maxOctaves> tables {};
+    };
+
+    constexpr TableSet<builtInScales.size()> buildBuiltInTables()
+    {
+        TableSet<builtInScales.size()> set;
+        for (int s = 0; s < numBuiltInScales; ++s)
+            for (int root = minRoot; root <= maxRoot; ++root)
+                for (int octaves = 1; octaves <= maxOctaves; ++octaves)
+                    set.tables[tableIndex(s, root, octaves)] = buildPitchTable(builtInScales[static_cast<size_t>(s)], root, octaves);
+        return set;
+    }
+
+    inline constexpr auto builtInTables = buildBuiltInTables();
+
+    // An imported scale, with its tables built once when it is loaded
+    class UserScale
+    {
+    public:
+        explicit UserScale(const ScaleDefinition& scaleDefinition)
+            : definition(scaleDefinition)
+        {
+            for (int root = minRoot; root <= maxRoot; ++root)
+                for (int octaves = 1; octaves <= maxOctaves; ++octaves)
+                    tables.tables[tableIndex(0, root, octaves)] = buildPitchTable(definition, root, octaves);
+        }
+
+        const ScaleDefinition& getDefinition() const { return definition; }
+
+        const PitchTable& table(int rootNote, int octaveRange) const noexcept
+        {
+            return tables.tables[tableIndex(0, rootNote, octaveRange)];
+        }
+
+    private:
+        ScaleDefinition definition;
+        TableSet<1> tables;
+    };
+
+    // Resolves the table for the current parameters. Out-of-range values are clamped and a
+    // missing imported scale falls back to the first built-in one.
+    inline const PitchTable& lookup(int scaleIndex, int rootNote, int octaveRange, const UserScale* userScale = nullptr) noexcept
+    {
+        rootNote = std::clamp(rootNote, minRoot, maxRoot);
+        octaveRange = std::clamp(octaveRange, 1, maxOctaves);
+
+        if (scaleIndex == userScaleIndex && userScale != nullptr)
+            return userScale->table(rootNote, octaveRange);
+
+        if (scaleIndex < 0 || scaleIndex >= numBuiltInScales)
+            scaleIndex = 0;
+
+        return builtInTables.tables[tableIndex(scaleIndex, rootNote, octaveRange)];
+    }
+}
@@ -0,0 +1,226 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include "CompiledPattern.h"
+
+// A bar's pitches chosen as a whole: one pitch per hit, in hit order from the unrotated rhythm.
+// Rotation only moves hits to other steps, so a rotated pattern reuses the same line. With its
+// own pitch length the pitch sequence drifts against the bar and every entry is played by some
+// hit sooner or later, so the line runs through the whole pitch cycle instead.
+struct VoiceLine
+{
+    // Everything the line was computed from
+    struct Key
+    {
+        int steps = 0;
+        int hits = 0;
+        int rootNote = 0;
+        int scaleIndex = 0;
+        int octaveRange = 0;
+        int seed = 0;
+        PitchModel::Type pitchModelType = PitchModel::Type::uniform;
+        float pitchSpread = 0.0f;
+        const void* userScale = nullptr; // Identity only, and only when it is selected
+        int pitchCycle = 0;
+
+        bool operator==(const Key&) const = default;
+
+        static Key of(const CompiledPattern& pattern, const ScaleEngine::UserScale* userScale) noexcept
+        {
+            return { pattern.steps, pattern.hits, pattern.rootNote, pattern.scaleIndex, pattern.octaveRange,
+                     pattern.seed, pattern.pitchModelType, pattern.pitchSpread,
+                     pattern.scaleIndex == ScaleEngine::userScaleIndex ? userScale : nullptr,
+                     pattern.pitchCycle() };
+        }
+    };
+
+    Key key;
+    int numHits = 0;
+    std::array<int, CompiledPattern::maxSteps> hitSteps{};   // Step of each hit at rotation 0
+    std::array<int, CompiledPattern::maxSteps> hitPitches{};
+    bool wholeCycle = false; // Every pitch cycle entry in order, which rotation doesn't move
+
+    // Writes the line over the compiled pitches at the pattern's current rotation
+    void applyTo(CompiledPattern& pattern) const noexcept
+    {
+        for (int hit = 0; hit < numHits; ++hit)
+        {
+            int step = wholeCycle ? hitSteps[static_cast<size_t>(hit)]
+                                  : (hitSteps[static_cast<size_t>(hit)] + pattern.rotation) % pattern.steps;
+            pattern.pitches[static_cast<size_t>(step)] = hitPitches[static_cast<size_t>(hit)];
+        }
+    }
+};
+
+// Viterbi over pitch-table entries: picks the line through the bar's hits with the lowest
+// total of leap, repetition, contour and drift-from-the-drawn-pitch costs.
+//
+// The DP runs backwards (cost-to-go per hit), so when only hit k's input changes just rows
+// 0..k are recomputed; the forward pass that reads the line out is O(hits * entries).
+class VoiceLeadingOptimiser
+{
+public:
+    static constexpr int maxHits = CompiledPattern::maxSteps;
+    static constexpr int maxEntries = ScaleEngine::PitchTable::maxEntries;
+
+    struct Costs
+    {
+        float drift = 0.5f;      // Per semitone away from the pitch the model drew
+        float leap = 1.0f;       // Per semitone beyond a whole tone
+        float wideLeap = 4.0f;   // Extra for anything wider than a fifth
+        float repetition = 2.0f; // Same note twice in a row
+        float contour = 0.25f;   // Per semitone away from an arch over the bar
+        float archHeight = 5.0f; // Semitones the arch rises above the root
+
+        bool operator==(const Costs&) const = default;
+    };
+
+    // Pattern must be compiled; its rotation is ignored
+    VoiceLine optimise(const CompiledPattern& pattern, const ScaleEngine::UserScale* userScale) noexcept
+    {
+        VoiceLine line;
+        line.key = VoiceLine::Key::of(pattern, userScale);
+
+        // Hits of the unrotated rhythm (or the whole pitch cycle), and the pitch the model drew
+        // for each
+        EuclideanRhythm euclidean;
+        std::array<int, maxHits> targets{};
+        line.wholeCycle = pattern.pitchCycle() != pattern.steps;
+        for (int step = 0; step < pattern.pitchCycle() && step < maxHits; ++step)
+        {
+            if (line.wholeCycle || euclidean.shouldTrigger(step, pattern.steps, pattern.hits, 0))
+            {
+                line.hitSteps[static_cast<size_t>(line.numHits)] = step;
+                targets[static_cast<size_t>(line.numHits++)] = pattern.pitches[static_cast<size_t>(step)];
+            }
+        }
+
+        const auto& table = pattern.getPitchTable();
+        solve(table, targets, line.numHits);
+
+        for (int hit = 0; hit < line.numHits; ++hit)
+            line.hitPitches[static_cast<size_t>(hit)] = table.notes[static_cast<size_t>(path[static_cast<size_t>(hit)])];
+
+        return line;
+    }
+
+    // Rows recomputed by the last optimise(), for profiling
+    int getLastRecomputedRows() const noexcept { return lastRecomputedRows; }
+
+    Costs costs;
+
+private:
+    void solve(const ScaleEngine::PitchTable& table, const std::array<int, maxHits>& targets, int numHits) noexcept
+    {
+        int numEntries = table.scaleSize * table.octaveRange;
+
+        // Lowest row whose inputs changed; everything below it is still valid
+        int firstStale = -1;
+        bool sameShape = numHits == solvedHits && numEntries == solvedEntries && costs == solvedCosts
+                         && std::equal(table.notes.begin(), table.notes.begin() + numEntries, solvedNotes.begin());
+        if (!sameShape)
+            firstStale = numHits - 1;
+        else
+        {
+            for (int hit = numHits - 1; hit >= 0; --hit)
+            {
+                if (targets[static_cast<size_t>(hit)] != solvedTargets[static_cast<size_t>(hit)])
+                {
+                    firstStale = hit;
+                    break;
+                }
+            }
+        }
+
+        lastRecomputedRows = firstStale + 1;
+
+        for (int hit = firstStale; hit >= 0; --hit)
+        {
+            for (int from = 0; from < numEntries; ++from)
+            {
+                int note = table.notes[static_cast<size_t>(from)];
+                float best = 0.0f;
+
+                if (hit + 1 < numHits)
+                {
+                    best = std::numeric_limits<float>::max();
+                    for (int to = 0; to < numEntries; ++to)
+                    {
+                        float cost = transitionCost(note, table.notes[static_cast<size_t>(to)])
+                                     + costToGo[static_cast<size_t>(hit + 1)][static_cast<size_t>(to)];
+                        best = cost < best ? cost : best;
+                    }
+                }
+
+                costToGo[static_cast<size_t>(hit)][static_cast<size_t>(from)]
+                    = best + hitCost(note, targets[static_cast<size_t>(hit)], hit, numHits, table.rootNote);
+            }
+        }
+
+        solvedHits = numHits;
+        solvedEntries = numEntries;
+        std::copy(table.notes.begin(), table.notes.begin() + numEntries, solvedNotes.begin());
+        solvedTargets = targets;
+        solvedCosts = costs;
+
+        readPath(table, numHits, numEntries);
+    }
+
+    // Forward pass: best start, then the best successor under the cost-to-go
+    void readPath(const ScaleEngine::PitchTable& table, int numHits, int numEntries) noexcept
+    {
+        for (int hit = 0; hit < numHits; ++hit)
+        {
+            int previousNote = hit > 0 ? table.notes[static_cast<size_t>(path[static_cast<size_t>(hit - 1)])] : -1;
+            float best = std::numeric_limits<float>::max();
+
+            for (int entry = 0; entry < numEntries; ++entry)
+            {
+                float cost = costToGo[static_cast<size_t>(hit)][static_cast<size_t>(entry)];
+                if (previousNote >= 0)
+                    cost += transitionCost(previousNote, table.notes[static_cast<size_t>(entry)]);
+
+                if (cost < best)
+                {
+                    best = cost;
+                    path[static_cast<size_t>(hit)] = entry;
+                }
+            }
+        }
+    }
+
+    float transitionCost(int from, int to) const noexcept
+    {
+        int interval = std::abs(to - from);
+        float cost = interval > 2 ? costs.leap * static_cast<float>(interval - 2) : 0.0f;
+        if (interval > 7)
+            cost += costs.wideLeap;
+        if (interval == 0)
+            cost += costs.repetition;
+        return cost;
+    }
+
+    float hitCost(int note, int target, int hit, int numHits, int rootNote) const noexcept
+    {
+        float position = (static_cast<float>(hit) + 0.5f) / static_cast<float>(numHits);
+        float arch = static_cast<float>(rootNote) + costs.archHeight * std::sin(3.14159265f * position);
+
+        return costs.drift * static_cast<float>(std::abs(note - target))
+               + costs.contour * std::abs(static_cast<float>(note) - arch);
+    }
+
+    std::array<std::array<float, maxEntries>, maxHits> costToGo{};
+    std::array<int, maxHits> path{};
+
+    // Inputs of the last solve, to find what changed
+    int solvedHits = -1;
+    int solvedEntries = -1;
+    std::array<uint8_t, maxEntries> solvedNotes{};
+    std::array<int, maxHits> solvedTargets{};
+    Costs solvedCosts;
+    int lastRecomputedRows = 0;
+};
@@ -0,0 +1,139 @@
+#pragma once
+#include <juce_events/juce_events.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include "VoiceLeadingOptimiser.h"
+#include "../utils/JobSystem.h"
+#include "../utils/RealtimePublisher.h"
+
+// Re-optimises the voice line on the shared job pool whenever the pitch inputs change, and
+// publishes it for the audio thread. Nothing runs while the inputs stay put or voice leading
+// is off; a change while a job is still running cancels it in favour of a new one.
+class VoiceLeadingWorker : private juce::Timer
+{
+public:
+    // Fills the rhythm and pitch fields of the pattern and the user scale to use; returns
+    // false while voice leading is switched off
+    using InputReader = std::function<bool(CompiledPattern&, std::shared_ptr<const ScaleEngine::UserScale>&)>;
+
+    VoiceLeadingWorker(JobSystem& jobSystem, InputReader reader, RealtimePublisher<VoiceLine>& destination)
+        : jobs(jobSystem), readInputs(std::move(reader)), output(destination)
+    {
+        startTimer(pollMs);
+    }
+
+    ~VoiceLeadingWorker() override { stopTimer(); }
+
+    // Any thread, the audio thread included (a parameter the host automates): the inputs may
+    // have changed. Only a flag is set; the message thread polls it, so changes between two
+    // polls are read once and nothing is posted from the audio thread.
+    void inputsChanged() noexcept { changed.store(true, std::memory_order_release); }
+
+    // Message thread, before a bounce: submits the current inputs now rather than at the next
+    // poll, unless the latest line is already theirs. waitForPending() then holds the first
+    // offline block until the line is out.
+    void submitForOffline()
+    {
+        changed.store(false, std::memory_order_relaxed);
+
+        auto inputs = std::make_shared<CompiledPattern>();
+        std::shared_ptr<const ScaleEngine::UserScale> userScale;
+        if (!readInputs(*inputs, userScale))
+            return;
+
+        auto key = VoiceLine::Key::of(*inputs, userScale.get());
+        if (auto latest = output.getLatest(); latest != nullptr && latest->key == key)
+            return;
+
+        shared->published.reset();
+        pending.store(true, std::memory_order_release);
+        lastKey = key;
+        submit(std::move(inputs), std::move(userScale));
+    }
+
+    // Audio thread, offline only: waits for a line submitForOffline() asked for. The wait is
+    // bounded, as a newer job may have cancelled that one before it ran; the drawn pitches
+    // play if it runs out.
+    void waitForPending() noexcept
+    {
+        if (pending.exchange(false, std::memory_order_acquire))
+            shared->published.wait(offlineWaitMs);
+    }
+
+private:
+    static constexpr const char* jobKey = "voiceLeading";
+    static constexpr int pollMs = 30;
+    static constexpr int offlineWaitMs = 2000;
+
+    // The optimiser keeps the last solve, so a change to one hit only recomputes the rows up
+    // to it. Held by the jobs as well, as a cancelled one may still be finishing.
+    struct Shared
+    {
+        std::mutex mutex;
+        VoiceLeadingOptimiser optimiser;
+        juce::WaitableEvent published; // Signalled as each job that wasn't replaced publishes
+    };
+
+    static std::shared_ptr<const VoiceLine> optimise(Shared& state, CompiledPattern& inputs,
+                                                     const std::shared_ptr<const ScaleEngine::UserScale>& userScale)
+    {
+        inputs.compileRhythm();
+        inputs.compilePitches(userScale.get());
+
+        const std::lock_guard<std::mutex> lock(state.mutex);
+        return std::make_shared<const VoiceLine>(state.optimiser.optimise(inputs, userScale.get()));
+    }
+
+    void timerCallback() override
+    {
+        if (!changed.exchange(false, std::memory_order_acquire))
+            return;
+
+        auto inputs = std::make_shared<CompiledPattern>();
+        std::shared_ptr<const ScaleEngine::UserScale> userScale;
+        if (!readInputs(*inputs, userScale))
+        {
+            jobs.cancel(jobKey);
+            lastKey = {};
+            return;
+        }
+
+        auto key = VoiceLine::Key::of(*inputs, userScale.get());
+        if (key == lastKey)
+            return;
+        lastKey = key;
+        submit(std::move(inputs), std::move(userScale));
+    }
+
+    // The job publishes the line itself rather than from the message thread, which a bounce
+    // may be holding. A line published late is harmless: the audio thread only applies one
+    // whose key matches its pattern.
+    void submit(std::shared_ptr<CompiledPattern> inputs, std::shared_ptr<const ScaleEngine::UserScale> userScale)
+    {
+        jobs.submit<bool>(
+            JobSystem::Priority::interactive, jobKey,
+            [state = shared, &destination = output, inputs, userScale](const CancellationToken& token)
+            {
+                auto line = optimise(*state, *inputs, userScale);
+                if (!token.isCancelled())
+                {
+                    destination.publish(std::move(line));
+                    state->published.signal();
+                }
+                return true;
+            },
+            [](bool) {});
+    }
+
+    JobSystem& jobs;
+    InputReader readInputs;
+    RealtimePublisher<VoiceLine>& output;
+
+    std::shared_ptr<Shared> shared = std::make_shared<Shared>();
+    std::atomic<bool> changed { false };
+    std::atomic<bool> pending { false };
+    VoiceLine::Key lastKey; // Message thread only
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(VoiceLeadingWorker)
+};
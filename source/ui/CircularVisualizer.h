@@ -1,6 +1,7 @@
 #pragma once
 #include <juce_gui_basics/juce_gui_basics.h>
 #include "../generator/EuclideanRhythm.h"
+#include "../utils/TraceRecorder.h"
 
 class CircularVisualizer : public juce::Component,
                             private juce::Timer
@@ -13,6 +14,8 @@ public:
 
     void paint(juce::Graphics& g) override
     {
+        MB_TRACE_SCOPE("ui", "CircularVisualizer::paint");
+
         auto bounds = getLocalBounds().toFloat().reduced(4);
         auto centre = bounds.getCentre();
         float radius = juce::jmin(bounds.getWidth(), bounds.getHeight()) * 0.5f;
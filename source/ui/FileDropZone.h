@@ -0,0 +1,120 @@
+#pragma once
+#include <juce_gui_basics/juce_gui_basics.h>
+
+// Small drop target for loading a file (chord track, scale, groove...).
+// Shows what is loaded; right-click clears it.
+class FileDropZone : public juce::Component,
+                     public juce::FileDragAndDropTarget
+{
+public:
+    FileDropZone(const juce::String& zoneTitle, const juce::StringArray& fileExtensions)
+        : title(zoneTitle), extensions(fileExtensions)
+    {
+        setMouseCursor(juce::MouseCursor::PointingHandCursor);
+    }
+
+    // Return false if the file couldn't be loaded
+    std::function<bool(const juce::File&)> onFileDropped;
+    std::function<void()> onCleared;
+
+    void setLoadedName(const juce::String& name)
+    {
+        if (loadedName != name)
+        {
+            loadedName = name;
+            repaint();
+        }
+    }
+
+    void paint(juce::Graphics& g) override
+    {
+        auto bounds = getLocalBounds().toFloat().reduced(2);
+
+        // Black outline, yellow when a file is hovering or loaded
+        g.setColour(juce::Colours::black);
+        g.fillRoundedRectangle(bounds, 4.0f);
+
+        auto fill = isHovering ? juce::Colour(0xffffdd00)
+                               : (loadedName.isNotEmpty() ? juce::Colour(0xffffee88) : juce::Colour(0xffe0e0e0));
+        g.setColour(failed ? juce::Colour(0xffff3333) : fill);
+        g.fillRoundedRectangle(bounds.reduced(3), 4.0f);
+
+        g.setColour(juce::Colours::black);
+        auto textArea = bounds.reduced(8, 4);
+        g.setFont(juce::Font(12.0f, juce::Font::bold));
+        g.drawText(title, textArea.removeFromTop(textArea.getHeight() * 0.5f), juce::Justification::centred);
+
+        g.setFont(juce::Font(11.0f));
+        g.drawText(loadedName.isNotEmpty() ? loadedName : "Drop " + extensions.joinIntoString("/"),
+            textArea, juce::Justification::centred, true);
+    }
+
+    bool isInterestedInFileDrag(const juce::StringArray& files) override
+    {
+        for (const auto& path : files)
+        {
+            if (accepts(juce::File(path)))
+                return true;
+        }
+        return false;
+    }
+
+    void fileDragEnter(const juce::StringArray&, int, int) override
+    {
+        isHovering = true;
+        repaint();
+    }
+
+    void fileDragExit(const juce::StringArray&) override
+    {
+        isHovering = false;
+        repaint();
+    }
+
+    void filesDropped(const juce::StringArray& files, int, int) override
+    {
+        isHovering = false;
+        failed = false;
+
+        for (const auto& path : files)
+        {
+            juce::File file(path);
+            if (accepts(file) && onFileDropped)
+            {
+                failed = !onFileDropped(file);
+                break;
+            }
+        }
+
+        repaint();
+    }
+
+    void mouseUp(const juce::MouseEvent& e) override
+    {
+        if (e.mods.isPopupMenu() && loadedName.isNotEmpty() && onCleared)
+        {
+            onCleared();
+            failed = false;
+            setLoadedName({});
+        }
+    }
+
+private:
+    bool accepts(const juce::File& file) const
+    {
+        for (const auto& extension : extensions)
+        {
+            if (file.hasFileExtension(extension))
+                return true;
+        }
+        return false;
+    }
+
+    juce::String title;
+    juce::StringArray extensions;
+    juce::String loadedName;
+    bool isHovering = false;
+    bool failed = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FileDropZone)
+};
@@ -34,6 +34,13 @@ public:
         g.drawText("Drag to export", textArea, juce::Justification::centred);
     }
 
+    // The drag only starts once the mouse has moved, a head start for rendering the pattern
+    void mouseDown(const juce::MouseEvent&) override
+    {
+        if (onPress)
+            onPress();
+    }
+
     void mouseDrag(const juce::MouseEvent& event) override
     {
         if (event.getDistanceFromDragStart() < 5 || isDragging)
@@ -85,6 +92,7 @@ public:
     }
 
     std::function<juce::MemoryBlock()> onCreatePattern;
+    std::function<void()> onPress;
 
 private:
     int numBars = 1;
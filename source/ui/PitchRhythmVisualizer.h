@@ -1,6 +1,7 @@
 #pragma once
 #include <juce_gui_basics/juce_gui_basics.h>
 #include "../generator/EuclideanRhythm.h"
+#include "../utils/TraceRecorder.h"
 #include "../generator/PitchGenerator.h"
 
 class PitchRhythmVisualizer : public juce::Component
@@ -12,6 +13,8 @@ public:
 
     void paint(juce::Graphics& g) override
     {
+        MB_TRACE_SCOPE("ui", "PitchRhythmVisualizer::paint");
+
         auto bounds = getLocalBounds().toFloat();
 
         // Black background with dark red tint
@@ -141,7 +144,7 @@ public:
         {
             if (euclidean.shouldTrigger(i, steps, hits, rot))
             {
-                int pitch = pitchGen.generatePitch(i, root, scale, octaves, randomSeed);
+                int pitch = pitchGen.generatePitch(root, scale, octaves, i, randomSeed);
                 pitch = juce::jlimit(0, 127, pitch);
                 cachedPitches.push_back(pitch);
                 minPitch = std::min(minPitch, pitch);
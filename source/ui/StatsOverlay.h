@@ -0,0 +1,168 @@
+#pragma once
+#include <juce_gui_basics/juce_gui_basics.h>
+#include "../utils/BlockStats.h"
+#include "../utils/TraceRecorder.h"
+
+// Debug overlay showing the processor's rolling block statistics and trace capture control
+class StatsOverlay : public juce::Component,
+                     private juce::Timer
+{
+public:
+    explicit StatsOverlay(BlockStats& statsToShow)
+        : stats(statsToShow)
+    {
+        exportButton.setButtonText("Export CSV");
+        exportButton.onClick = [this]() { exportCsv(); };
+        addAndMakeVisible(exportButton);
+
+        resetButton.setButtonText("Reset");
+        resetButton.onClick = [this]() { stats.reset(); };
+        addAndMakeVisible(resetButton);
+
+        traceButton.onClick = [this]() { toggleTrace(); };
+        traceButton.setEnabled(TraceRecorder::enabled);
+        addAndMakeVisible(traceButton);
+        updateTraceButton();
+
+        setInterceptsMouseClicks(false, true);
+    }
+
+    void visibilityChanged() override
+    {
+        // Only poll while someone is looking
+        if (isVisible())
+            startTimerHz(4);
+        else
+            stopTimer();
+    }
+
+    void paint(juce::Graphics& g) override
+    {
+        auto bounds = getLocalBounds().toFloat();
+
+        g.setColour(juce::Colours::black.withAlpha(0.85f));
+        g.fillRoundedRectangle(bounds, 6.0f);
+        g.setColour(juce::Colour(0xffffdd00));
+        g.drawRoundedRectangle(bounds.reduced(1.0f), 6.0f, 2.0f);
+
+        auto textArea = getLocalBounds().reduced(10, 8);
+        textArea.removeFromBottom(28);
+
+        g.setFont(juce::Font(juce::Font::getDefaultMonospacedFontName(), 12.0f, juce::Font::plain));
+
+        if (!BlockStats::enabled)
+        {
+            g.drawText("Block stats compiled out (MAKEBASSLINE_BLOCK_STATS=0)", textArea, juce::Justification::centred);
+            return;
+        }
+
+        auto lineHeight = 16;
+        auto drawLine = [&](const juce::String& text)
+        {
+            g.drawText(text, textArea.removeFromTop(lineHeight), juce::Justification::centredLeft);
+        };
+
+        g.setColour(juce::Colour(0xffffdd00));
+        drawLine(juce::String("metric").paddedRight(' ', 14) + "    min   mean    p99    max");
+
+        g.setColour(juce::Colours::white);
+        for (const auto& row : rows)
+        {
+            drawLine(row.name.paddedRight(' ', 14)
+                     + format(row.summary.min) + format(row.summary.mean)
+                     + format(row.summary.p99) + format(row.summary.max));
+        }
+
+        g.setColour(juce::Colours::white.withAlpha(0.6f));
+        drawLine(juce::String(rows[0].summary.count) + " blocks in window");
+    }
+
+    void resized() override
+    {
+        auto buttons = getLocalBounds().reduced(10, 8).removeFromBottom(24);
+        exportButton.setBounds(buttons.removeFromRight(100));
+        buttons.removeFromRight(6);
+        resetButton.setBounds(buttons.removeFromRight(70));
+        buttons.removeFromRight(6);
+        traceButton.setBounds(buttons.removeFromRight(100));
+    }
+
+private:
+    struct Row
+    {
+        juce::String name;
+        StatSummary summary;
+    };
+
+    void timerCallback() override
+    {
+        rows[0] = { "block (us)", stats.summarise(BlockStats::blockMicros) };
+        rows[1] = { "load (%)", scaled(stats.summarise(BlockStats::blockLoad), 100.0f) };
+        rows[2] = { "events/block", stats.summarise(BlockStats::eventsPerBlock) };
+        rows[3] = { "step lat (us)", stats.summarise(BlockStats::stepLatencyMicros) };
+        updateTraceButton(); // Another instance may have started or stopped the capture
+        repaint();
+    }
+
+    static StatSummary scaled(StatSummary s, float factor)
+    {
+        s.min *= factor;
+        s.mean *= factor;
+        s.p99 *= factor;
+        s.max *= factor;
+        return s;
+    }
+
+    static juce::String format(float value)
+    {
+        return juce::String(value, 1).paddedLeft(' ', 7);
+    }
+
+    void toggleTrace()
+    {
+        auto& recorder = TraceRecorder::getInstance();
+
+        if (TraceRecorder::isRecording())
+        {
+            recorder.stop();
+            recorder.getCaptureFile().revealToUser();
+        }
+        else
+        {
+            auto name = "MakeBasslineTrace-" + juce::Time::getCurrentTime().formatted("%Y%m%d-%H%M%S") + ".json";
+            recorder.start(juce::File::getSpecialLocation(juce::File::userDesktopDirectory).getChildFile(name));
+        }
+
+        updateTraceButton();
+    }
+
+    void updateTraceButton()
+    {
+        traceButton.setButtonText(TraceRecorder::isRecording() ? "Stop trace" : "Start trace");
+    }
+
+    void exportCsv()
+    {
+        fileChooser = std::make_unique<juce::FileChooser>(
+            "Export block statistics",
+            juce::File::getSpecialLocation(juce::File::userDesktopDirectory).getChildFile("MakeBasslineStats.csv"),
+            "*.csv");
+
+        fileChooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles
+                                     | juce::FileBrowserComponent::warnAboutOverwriting,
+            [this](const juce::FileChooser& chooser)
+            {
+                auto file = chooser.getResult();
+                if (file != juce::File())
+                    file.replaceWithText(stats.toCsv());
+            });
+    }
+
+    BlockStats& stats;
+    std::array<Row, 4> rows;
+
+    juce::TextButton exportButton, resetButton, traceButton;
+    std::unique_ptr<juce::FileChooser> fileChooser;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StatsOverlay)
+};
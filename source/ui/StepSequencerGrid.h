@@ -1,6 +1,7 @@
 #pragma once
 #include <juce_gui_basics/juce_gui_basics.h>
 #include "../generator/EuclideanRhythm.h"
+#include "../utils/TraceRecorder.h"
 
 class StepSequencerGrid : public juce::Component,
                            private juce::Timer
@@ -20,6 +21,8 @@ public:
 
     void paint(juce::Graphics& g) override
     {
+        MB_TRACE_SCOPE("ui", "StepSequencerGrid::paint");
+
         auto bounds = getLocalBounds().reduced(2);
 
         // White background for pop-art look
@@ -91,6 +94,29 @@ public:
             }
         }
 
+        // Polymeter: progress through the combined cycle when it spans more than one bar
+        if (cycleLength > numSteps)
+        {
+            auto strip = bounds.toFloat().removeFromBottom(6.0f).reduced(10.0f, 1.0f);
+            g.setColour(juce::Colour(0xffe0e0e0));
+            g.fillRoundedRectangle(strip, 2.0f);
+
+            g.setColour(juce::Colour(0xffdd0000));
+            g.fillRoundedRectangle(strip.withWidth(strip.getWidth() * (cycleStep + 1) / static_cast<float>(cycleLength)), 2.0f);
+
+            // Bar lines only while they stay readable; a cycle can be thousands of steps
+            int numBars = cycleLength / numSteps;
+            if (numBars <= strip.getWidth() / 6.0f)
+            {
+                g.setColour(juce::Colours::black.withAlpha(0.4f));
+                for (int bar = 1; bar < numBars; ++bar)
+                {
+                    float x = strip.getX() + strip.getWidth() * bar / static_cast<float>(numBars);
+                    g.drawVerticalLine(juce::roundToInt(x), strip.getY(), strip.getBottom());
+                }
+            }
+        }
+
         // Bold black border - comic book style
         g.setColour(juce::Colours::black);
         g.drawRoundedRectangle(bounds.toFloat(), 8.0f, 3.0f);
@@ -117,6 +143,17 @@ public:
         }
     }
 
+    // Position within the combined rhythm/pitch/accent cycle
+    void setCycle(int step, int length)
+    {
+        if (cycleStep != step || cycleLength != length)
+        {
+            cycleStep = step;
+            cycleLength = length;
+            repaint();
+        }
+    }
+
     void mouseMove(const juce::MouseEvent& event) override
     {
         if (numSteps <= 0)
@@ -189,6 +226,8 @@ private:
     int numHits = 3;
     int rotation = 0;
     int currentStep = 0;
+    int cycleStep = 0;
+    int cycleLength = 0;
     bool isPlaying = false;
     int hoveredStep = -1;  // Track which step is hovered (-1 = none)
 
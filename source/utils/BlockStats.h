@@ -0,0 +1,234 @@
+#pragma once
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <vector>
+
+// Set to 0 from CMake (MAKEBASSLINE_RELEASE_STATS=OFF) to compile recording out of Release builds
+#ifndef MAKEBASSLINE_BLOCK_STATS
+    #define MAKEBASSLINE_BLOCK_STATS 1
+#endif
+
+// min/mean/p99/max of one metric over a window
+struct StatSummary
+{
+    float min = 0.0f;
+    float mean = 0.0f;
+    float p99 = 0.0f;
+    float max = 0.0f;
+    int count = 0;
+
+    static StatSummary of(std::vector<float> values)
+    {
+        StatSummary summary;
+        summary.count = static_cast<int>(values.size());
+        if (values.empty())
+            return summary;
+
+        double total = 0.0;
+        summary.min = values.front();
+        summary.max = values.front();
+        for (auto v : values)
+        {
+            total += v;
+            summary.min = std::min(summary.min, v);
+            summary.max = std::max(summary.max, v);
+        }
+        summary.mean = static_cast<float>(total / static_cast<double>(values.size()));
+
+        auto p99Index = (values.size() * 99) / 100;
+        std::nth_element(values.begin(), values.begin() + static_cast<long>(p99Index), values.end());
+        summary.p99 = values[p99Index];
+
+        return summary;
+    }
+};
+
+// Fixed-size window of the most recent records, each NumFields metrics of one block.
+// Written by the audio thread only, read from any other thread. A record's fields share
+// one write index, so every field of a snapshot comes from the same blocks.
+template <size_t NumFields, size_t WindowSize>
+class RollingRecords
+{
+public:
+    using Record = std::array<float, NumFields>;
+
+    void push(const Record& record) noexcept
+    {
+        auto index = writeIndex.load(std::memory_order_relaxed);
+        for (size_t field = 0; field < NumFields; ++field)
+            samples[index % WindowSize][field].store(record[field], std::memory_order_relaxed);
+        writeIndex.store(index + 1, std::memory_order_release);
+    }
+
+    void clear() noexcept
+    {
+        writeIndex.store(0, std::memory_order_release);
+    }
+
+    // Copies the window oldest-first (allocates, so never call from the audio thread)
+    std::vector<Record> snapshot() const
+    {
+        auto end = writeIndex.load(std::memory_order_acquire);
+        auto count = static_cast<size_t>(std::min<uint64_t>(end, WindowSize));
+
+        std::vector<Record> records(count);
+        for (size_t i = 0; i < count; ++i)
+            for (size_t field = 0; field < NumFields; ++field)
+                records[i][field] = samples[(end - count + i) % WindowSize][field].load(std::memory_order_relaxed);
+
+        return records;
+    }
+
+    static StatSummary summarise(const std::vector<Record>& records, size_t field)
+    {
+        std::vector<float> values;
+        values.reserve(records.size());
+        for (const auto& record : records)
+            values.push_back(record[field]);
+        return StatSummary::of(std::move(values));
+    }
+
+    StatSummary summarise(size_t field) const { return summarise(snapshot(), field); }
+
+private:
+    std::array<std::array<std::atomic<float>, NumFields>, WindowSize> samples{};
+    std::atomic<uint64_t> writeIndex{0};
+};
+
+// Per-block performance counters for the processor.
+// Recording costs two high-resolution timestamps per block, plus one per step change.
+class BlockStats
+{
+public:
+    static constexpr bool enabled = MAKEBASSLINE_BLOCK_STATS != 0;
+    static constexpr size_t windowSize = 2048; // ~20 s of 512-sample blocks at 48 kHz
+
+    // The fields of a block's record
+    enum Field : size_t
+    {
+        blockMicros,
+        blockLoad,
+        eventsPerBlock,
+        stepLatencyMicros,
+        numFields
+    };
+
+    using Window = RollingRecords<numFields, windowSize>;
+
+    void prepare(double sampleRate) noexcept
+    {
+        currentSampleRate = sampleRate;
+        resetRequested.store(true);
+    }
+
+    // Ask the audio thread to start a fresh window on its next block
+    void reset() noexcept { resetRequested.store(true); }
+
+    void beginBlock() noexcept
+    {
+        if constexpr (enabled)
+        {
+            if (resetRequested.exchange(false))
+                window.clear();
+
+            blockStartTicks = juce::Time::getHighResolutionTicks();
+            worstStepTicks = 0;
+        }
+    }
+
+    // Time from the start of the block until a step change has been handled
+    void markStepChange() noexcept
+    {
+        if constexpr (enabled)
+            worstStepTicks = std::max(worstStepTicks, juce::Time::getHighResolutionTicks() - blockStartTicks);
+    }
+
+    void endBlock(int numSamples, int numEvents) noexcept
+    {
+        if constexpr (enabled)
+        {
+            // An empty block has no budget to measure against, so it leaves no record
+            if (numSamples <= 0 || currentSampleRate <= 0.0)
+                return;
+
+            auto elapsed = juce::Time::getHighResolutionTicks() - blockStartTicks;
+            auto micros = static_cast<float>(ticksToMicros(elapsed));
+
+            Window::Record record;
+            record[blockMicros] = micros;
+            record[blockLoad] = micros / static_cast<float>(1.0e6 * numSamples / currentSampleRate); // Of the real-time budget
+            record[eventsPerBlock] = static_cast<float>(numEvents);
+            record[stepLatencyMicros] = static_cast<float>(ticksToMicros(worstStepTicks));
+            window.push(record);
+        }
+    }
+
+    // Calls beginBlock/endBlock around processBlock, whichever way it returns
+    class BlockScope
+    {
+    public:
+        BlockScope(BlockStats& s, const juce::MidiBuffer& midi, int samples) noexcept
+            : stats(s), midiOut(midi), numSamples(samples)
+        {
+            stats.beginBlock();
+        }
+
+        ~BlockScope() { stats.endBlock(numSamples, midiOut.getNumEvents()); }
+
+    private:
+        BlockStats& stats;
+        const juce::MidiBuffer& midiOut;
+        int numSamples;
+
+        JUCE_DECLARE_NON_COPYABLE(BlockScope)
+    };
+
+    StatSummary summarise(Field field) const { return window.summarise(field); }
+
+    // Summary table followed by the raw per-block window, both from one snapshot
+    juce::String toCsv() const
+    {
+        auto records = window.snapshot();
+
+        juce::String csv;
+        csv << "metric,min,mean,p99,max,count\n";
+
+        auto addSummary = [&](const char* name, Field field)
+        {
+            auto s = Window::summarise(records, field);
+            csv << name << "," << s.min << "," << s.mean << "," << s.p99 << "," << s.max << "," << s.count << "\n";
+        };
+
+        addSummary("block_us", blockMicros);
+        addSummary("block_load", blockLoad);
+        addSummary("events_per_block", eventsPerBlock);
+        addSummary("step_latency_us", stepLatencyMicros);
+
+        csv << "\nblock,block_us,block_load,events,step_latency_us\n";
+        for (size_t i = 0; i < records.size(); ++i)
+        {
+            const auto& r = records[i];
+            csv << static_cast<int>(i) << "," << r[blockMicros] << "," << r[blockLoad] << "," << r[eventsPerBlock] << ","
+                << r[stepLatencyMicros] << "\n";
+        }
+
+        return csv;
+    }
+
+private:
+    static double ticksToMicros(juce::int64 ticks) noexcept
+    {
+        return juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e6;
+    }
+
+    Window window;
+
+    std::atomic<bool> resetRequested{false};
+    double currentSampleRate = 44100.0;
+
+    // Audio thread only
+    juce::int64 blockStartTicks = 0;
+    juce::int64 worstStepTicks = 0;
+};
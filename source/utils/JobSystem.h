@@ -0,0 +1,283 @@
+#pragma once
+#include <juce_events/juce_events.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Background work that shouldn't run on the message or audio thread: MIDI export, preview
+// regeneration, scans and index building.
+//
+// Every processor owns a JobSystem, and they all feed one JobPool per process (held by
+// SharedResources). Its size is bounded by the core count, so a session full of instances
+// doesn't oversubscribe the machine. Interactive jobs always run before bulk ones, and bulk
+// jobs never take the last idle worker, so an export starts straight away even during a long
+// scan. Jobs are coarse (milliseconds and up), so one shared queue serves better than
+// per-worker deques with stealing.
+
+// Shared between a job and the code that submitted it. Long jobs should check it now and then.
+class CancellationToken
+{
+public:
+    bool isCancelled() const noexcept { return cancelled->load() || !ownerAlive->load(); }
+    void cancel() const noexcept { cancelled->store(true); }
+
+private:
+    friend class JobSystem;
+    explicit CancellationToken(std::shared_ptr<const std::atomic<bool>> alive) : ownerAlive(std::move(alive)) {}
+
+    std::shared_ptr<std::atomic<bool>> cancelled = std::make_shared<std::atomic<bool>>(false);
+    std::shared_ptr<const std::atomic<bool>> ownerAlive;
+};
+
+class JobPool
+{
+public:
+    enum class Priority
+    {
+        interactive,
+        bulk
+    };
+
+    // A submitted job; everything the pool needs to run it and account for it
+    struct Task
+    {
+        Priority priority = Priority::bulk;
+        const void* owner = nullptr;
+        std::function<void()> run;
+        std::function<void()> finished; // Called once run() returns, or when it never will
+    };
+
+    static constexpr int maxThreads = 8;
+
+    JobPool()
+    {
+        auto numThreads = juce::jlimit(1, maxThreads, juce::SystemStats::getNumCpus() - 1);
+        for (int i = 0; i < numThreads; ++i)
+        {
+            workers.push_back(std::make_unique<Worker>(*this, i));
+            workers.back()->startThread(juce::Thread::Priority::low);
+        }
+    }
+
+    ~JobPool()
+    {
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+
+        for (auto& worker : workers)
+            worker->stopThread(2000);
+    }
+
+    void enqueue(std::shared_ptr<Task> task)
+    {
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            (task->priority == Priority::interactive ? interactive : bulk).push_back(std::move(task));
+        }
+        wake.notify_all();
+    }
+
+    // Drops everything the owner queued that hasn't started; each still gets its finished()
+    void removePending(const void* owner)
+    {
+        std::vector<std::shared_ptr<Task>> removed;
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            for (auto* queue : { &interactive, &bulk })
+            {
+                for (auto& task : *queue)
+                    if (task->owner == owner)
+                        removed.push_back(task);
+
+                std::erase_if(*queue, [owner](const auto& task) { return task->owner == owner; });
+            }
+        }
+
+        for (auto& task : removed)
+            task->finished();
+    }
+
+    int getNumThreads() const noexcept { return static_cast<int>(workers.size()); }
+
+private:
+    class Worker : public juce::Thread
+    {
+    public:
+        Worker(JobPool& owner, int index) : juce::Thread("Job worker " + juce::String(index + 1)), pool(owner) {}
+
+        void run() override
+        {
+            while (auto task = pool.take())
+            {
+                task->run();
+                task->finished();
+                pool.release(*task);
+            }
+        }
+
+    private:
+        JobPool& pool;
+    };
+
+    // Blocks until there's something this worker may run; nullptr once the pool is stopping
+    std::shared_ptr<Task> take()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        std::shared_ptr<Task> task;
+
+        wake.wait(lock, [&]
+        {
+            if (stopping)
+                return true;
+
+            if (!interactive.empty())
+            {
+                task = std::move(interactive.front());
+                interactive.pop_front();
+                return true;
+            }
+
+            // Keep a worker free for interactive jobs (unless there is only one)
+            if (!bulk.empty() && (runningBulk < getNumThreads() - 1 || getNumThreads() == 1))
+            {
+                task = std::move(bulk.front());
+                bulk.pop_front();
+                ++runningBulk;
+                return true;
+            }
+
+            return false;
+        });
+
+        return stopping ? nullptr : task;
+    }
+
+    void release(const Task& task)
+    {
+        if (task.priority == Priority::bulk)
+        {
+            {
+                const std::lock_guard<std::mutex> lock(mutex);
+                --runningBulk;
+            }
+            wake.notify_all();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::shared_ptr<Task>> interactive, bulk;
+    int runningBulk = 0;
+    bool stopping = false;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+};
+
+// One processor's view of the pool. Submit from the message thread; results come back there.
+class JobSystem
+{
+public:
+    using Priority = JobPool::Priority;
+
+    explicit JobSystem(JobPool& jobPool) : pool(jobPool) {}
+
+    // Cancels everything, drops pending jobs and waits for running ones, so no job outlives
+    // the processor it reads from
+    ~JobSystem()
+    {
+        alive->store(false);
+        pool.removePending(this);
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->idle.wait(lock, [this] { return state->running == 0; });
+    }
+
+    // Runs work on a worker and hands its result to onComplete on the message thread, unless
+    // the job was cancelled first. A job with the same non-empty key, pending or running, is
+    // cancelled: the newest request for the same thing wins.
+    template <typename Result>
+    CancellationToken submit(Priority priority, const std::string& key,
+                             std::function<Result(const CancellationToken&)> work,
+                             std::function<void(Result)> onComplete)
+    {
+        CancellationToken token(alive);
+
+        if (!key.empty())
+        {
+            if (auto previous = byKey.find(key); previous != byKey.end())
+                previous->second.cancel();
+            byKey.insert_or_assign(key, token);
+        }
+
+        auto task = std::make_shared<JobPool::Task>();
+        task->priority = priority;
+        task->owner = this;
+        task->run = [token, work = std::move(work), onComplete = std::move(onComplete)]
+        {
+            if (token.isCancelled())
+                return;
+
+            auto result = std::make_shared<Result>(work(token));
+            if (token.isCancelled())
+                return;
+
+            juce::MessageManager::callAsync([token, result, onComplete]
+            {
+                if (!token.isCancelled())
+                    onComplete(std::move(*result));
+            });
+        };
+
+        // The state outlives this object, so the last job to finish can still report in
+        task->finished = [state = state]
+        {
+            {
+                const std::lock_guard<std::mutex> lock(state->mutex);
+                --state->running;
+            }
+            state->idle.notify_all();
+        };
+
+        {
+            const std::lock_guard<std::mutex> lock(state->mutex);
+            ++state->running;
+        }
+
+        pool.enqueue(task);
+        return token;
+    }
+
+    // Cancels the job last submitted under this key, if any
+    void cancel(const std::string& key)
+    {
+        if (auto job = byKey.find(key); job != byKey.end())
+        {
+            job->second.cancel();
+            byKey.erase(job);
+        }
+    }
+
+private:
+    struct RunningState
+    {
+        std::mutex mutex;
+        std::condition_variable idle;
+        int running = 0;
+    };
+
+    JobPool& pool;
+    std::shared_ptr<std::atomic<bool>> alive = std::make_shared<std::atomic<bool>>(true);
+    std::shared_ptr<RunningState> state = std::make_shared<RunningState>();
+    std::map<std::string, CancellationToken> byKey; // Message thread only
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(JobSystem)
+};
@@ -0,0 +1,146 @@
+#pragma once
+#include <juce_audio_devices/juce_audio_devices.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// Sends MIDI to an output device from its own high-priority thread, each message at its own
+// time rather than in a burst per audio block.
+//
+// The audio thread stamps every event with the time it should leave (the callback time plus a
+// block of latency plus its offset in the block) and pushes it into a lock-free FIFO. The
+// scheduler thread sleeps until shortly before the next event is due, then yields until it is.
+// The result is a constant one-block delay with sub-millisecond jitter instead of up to a
+// whole block of it.
+class MidiOutputScheduler : private juce::Thread
+{
+public:
+    // Where messages go: a device in the app, a loopback stand-in in tests
+    struct Sink
+    {
+        virtual ~Sink() = default;
+        virtual void send(const juce::MidiMessage& message) = 0;
+    };
+
+    struct DeviceSink : Sink
+    {
+        explicit DeviceSink(std::unique_ptr<juce::MidiOutput> output) : device(std::move(output)) {}
+        void send(const juce::MidiMessage& message) override { device->sendMessageNow(message); }
+
+        std::unique_ptr<juce::MidiOutput> device;
+    };
+
+    // Milliseconds on a steady clock, the one send times are stamped against: the real one, or
+    // a stand-in that tests move by hand
+    using Clock = std::function<double()>;
+
+    static constexpr int capacity = 4096;
+
+    explicit MidiOutputScheduler(Clock clockToUse = &juce::Time::getMillisecondCounterHiRes)
+        : juce::Thread("MIDI output"), clock(std::move(clockToUse))
+    {
+    }
+
+    ~MidiOutputScheduler() override { setSink(nullptr); }
+
+    // Message thread. Pending events are dropped when the sink changes.
+    void setSink(std::unique_ptr<Sink> newSink)
+    {
+        active.store(false);
+        stopThread(1000);
+
+        // With the thread stopped this thread is the reader, so it can discard what's left
+        sink = std::move(newSink);
+        fifo.finishedRead(fifo.getNumReady());
+
+        if (sink != nullptr)
+        {
+            active.store(true);
+            startThread(juce::Thread::Priority::highest);
+        }
+    }
+
+    bool isActive() const noexcept { return active.load(std::memory_order_relaxed); }
+
+    // Audio thread. Messages longer than three bytes (sysex) aren't scheduled.
+    bool push(const juce::MidiMessage& message, double sendTimeMs) noexcept
+    {
+        if (!isActive() || message.getRawDataSize() > 3)
+            return false;
+
+        const auto scope = fifo.write(1);
+        if (scope.blockSize1 + scope.blockSize2 == 0)
+            return false; // Full; the device has fallen badly behind
+
+        auto& event = events[static_cast<size_t>(scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2)];
+        event.timeMs = sendTimeMs;
+        event.size = message.getRawDataSize();
+        std::copy_n(message.getRawData(), event.size, event.bytes.begin());
+        return true;
+    }
+
+    // Audio thread: everything in the block, one block after the callback started
+    void scheduleBlock(const juce::MidiBuffer& midi, double callbackTimeMs, double sampleRate, int numSamples) noexcept
+    {
+        double msPerSample = 1000.0 / sampleRate;
+        double blockStartMs = callbackTimeMs + numSamples * msPerSample;
+
+        for (const auto metadata : midi)
+            push(metadata.getMessage(), blockStartMs + metadata.samplePosition * msPerSample);
+    }
+
+private:
+    struct Event
+    {
+        double timeMs = 0.0;
+        int size = 0;
+        std::array<juce::uint8, 3> bytes {};
+    };
+
+    // Sleep until this close to the deadline, then yield
+    static constexpr double spinWindowMs = 1.5;
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            if (fifo.getNumReady() == 0)
+            {
+                wait(1);
+                continue;
+            }
+
+            const auto& event = events[static_cast<size_t>(readIndex())];
+            double untilDue = event.timeMs - clock();
+
+            if (untilDue > spinWindowMs)
+            {
+                wait(juce::jmax(1, static_cast<int>(untilDue - spinWindowMs)));
+                continue;
+            }
+
+            while (event.timeMs > clock() && !threadShouldExit())
+                juce::Thread::yield();
+
+            sink->send(juce::MidiMessage(event.bytes.data(), event.size));
+            fifo.finishedRead(1);
+        }
+    }
+
+    int readIndex() const noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(1, start1, size1, start2, size2);
+        return size1 > 0 ? start1 : start2;
+    }
+
+    const Clock clock;
+    std::atomic<bool> active { false };
+    std::unique_ptr<Sink> sink; // Only touched while the thread is stopped, and by the thread
+    juce::AbstractFifo fifo { capacity };
+    std::array<Event, capacity> events;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiOutputScheduler)
+};
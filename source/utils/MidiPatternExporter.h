@@ -1,8 +1,16 @@
 #pragma once
 #include <juce_audio_basics/juce_audio_basics.h>
-#include "../generator/EuclideanRhythm.h"
-#include "../generator/PitchGenerator.h"
-#include <random>
+#include "../generator/PhraseGenerator.h"
+#include "../generator/VoiceLeadingOptimiser.h"
+#include "../generator/HarmonyTrack.h"
+#include "../generator/Arrangement.h"
+#include "../generator/GrooveTemplate.h"
+#include "../generator/KickPattern.h"
+#include "../generator/ControlLanes.h"
+#include "../generator/NoteChannels.h"
+#include "../generator/PatternMorph.h"
+#include "PreviewSynth.h"
+#include "JobSystem.h"
 
 class MidiPatternExporter
 {
@@ -15,89 +23,99 @@ public:
         int rootNote = 36;
         int scaleIndex = 0;
         int octaveRange = 1;
+        int pitchModel = 0; // PitchModel::Type
+        float pitchSpread = 0.5f;
+        bool voiceLeading = false;
         int velocity = 100;
         float noteLength = 0.5f;
         float swing = 0.0f;
         int humanize = 0;
+        float ratchetChance = 0.0f;
+        int ratchetCount = 4;
+        float rollRamp = 0.0f;
+        float microTiming = 0.0f;
+        float grooveAmount = 1.0f;
+        float glideChance = 0.0f;
+        float glideTime = 0.5f;
         int seed = 42;
-        int numBars = 1;
+        int numBars = 1; // 0 = the whole polymeter/phrase cycle, up to maxCycleBars
+        int firstBar = 0; // Bars are the ones the processor plays at the same bar index
+
+        // Phrase variation across bars (see PhraseGenerator)
+        int fillEvery = 0;
+        float mutation = 0.0f;
+        int rotationDrift = 0;
+        int pitchLength = 0;
+        int accentLength = 0;
+        float humanizeTiming = 0.0f;
+        float probability = 1.0f;
+        int variationCycle = 0;
+        int kickMode = 0; // DrumFit::Mode, fitting to the kick below
+
         double bpm = 120.0;
         int timeSignatureNumerator = 4;
+
+        // When set, each note follows the chord active at its position
+        std::shared_ptr<const HarmonyTrack> harmony;
+
+        // Used when scaleIndex selects the imported scale
+        std::shared_ptr<const ScaleEngine::UserScale> userScale;
+
+        // Imported groove template, if any
+        std::shared_ptr<const GrooveTemplate> groove;
+
+        // Kick pattern the rhythm fits to, if any (a live kick isn't known ahead of time)
+        std::shared_ptr<const KickPattern> kick;
+
+        // Glide output and the envelope lane, written alongside the notes
+        ControlLanes::Settings controlLanes;
+
+        // Channel assignment (single, round robin, by role or MPE)
+        NoteChannels::Settings noteChannels;
+
+        // A/B morph: the stored bars and the position between them (0 = A, 1 = B), laid over
+        // the pattern (or each section) when both slots fit it, as in playback
+        std::shared_ptr<const PatternMorph::Slots> morphSlots;
+        float morph = 0.0f;
+
+        // Song mode: when set, the arrangement is exported instead of the pattern above, and
+        // numBars = 0 means the whole song
+        std::shared_ptr<const Arrangement> arrangement;
+
+        bool operator==(const PatternParams&) const = default;
     };
 
-    static juce::MidiFile generatePattern(const PatternParams& params)
+    static constexpr int maxCycleBars = 4096;
+    static constexpr double ticksPerQuarter = 960.0;
+
+    // A cancelled export stops at the next note and returns what it has so far
+    static juce::MidiFile generatePattern(const PatternParams& params, const CancellationToken* cancel = nullptr)
     {
         juce::MidiFile midiFile;
-        midiFile.setTicksPerQuarterNote(960); // Standard MIDI resolution
+        midiFile.setTicksPerQuarterNote(static_cast<int>(ticksPerQuarter)); // Standard MIDI resolution
 
         juce::MidiMessageSequence sequence;
+        HarmonyTrack::Cursor harmonyCursor;
+        OutputCursor output;
+        output.lanes.prepare(params.controlLanes, ticksPerQuarter * params.bpm / 60.0);
+        output.channels.prepare(params.noteChannels);
 
-        EuclideanRhythm euclidean;
-        PitchGenerator pitchGen;
-
-        // Calculate timing
-        double beatsPerBar = params.timeSignatureNumerator;
-        double totalBeats = beatsPerBar * params.numBars;
-        double beatsPerStep = beatsPerBar / params.steps;
-        double ticksPerBeat = 960.0;
-        double ticksPerStep = ticksPerBeat * beatsPerStep;
-
-        // Generate pattern for all bars
-        for (int bar = 0; bar < params.numBars; ++bar)
+        int endTick = 0;
+        if (params.arrangement != nullptr && params.arrangement->numBars() > 0)
         {
-            for (int step = 0; step < params.steps; ++step)
-            {
-                // Check if this step should trigger
-                bool shouldTrigger = euclidean.shouldTrigger(
-                    step, params.steps, params.hits, params.rotation);
-
-                if (shouldTrigger)
-                {
-                    // Calculate base timestamp
-                    double baseTimestamp = (bar * params.steps + step) * ticksPerStep;
-
-                    // Apply swing to odd steps
-                    double timestamp = baseTimestamp;
-                    if (params.swing > 0.0f && step % 2 == 1)
-                    {
-                        timestamp += ticksPerStep * params.swing;
-                    }
-
-                    // Generate pitch
-                    int pitch = pitchGen.generatePitch(
-                        params.rootNote,
-                        params.scaleIndex,
-                        params.octaveRange,
-                        step,
-                        params.seed
-                    );
-
-                    // Apply humanization to velocity
-                    int velocity = params.velocity;
-                    if (params.humanize > 0)
-                    {
-                        std::mt19937 rng(params.seed + step * 251);
-                        std::uniform_int_distribution<int> velDist(-params.humanize, params.humanize);
-                        velocity = juce::jlimit(1, 127, params.velocity + velDist(rng));
-                    }
-
-                    // Calculate note duration
-                    double noteDuration = ticksPerStep * params.noteLength;
-
-                    // Add note on
-                    sequence.addEvent(
-                        juce::MidiMessage::noteOn(1, pitch, (juce::uint8)velocity),
-                        timestamp
-                    );
-
-                    // Add note off
-                    sequence.addEvent(
-                        juce::MidiMessage::noteOff(1, pitch),
-                        timestamp + noteDuration
-                    );
-                }
-            }
+            endTick = addArrangement(sequence, params, harmonyCursor, output, cancel);
         }
+        else
+        {
+            endTick = addPattern(sequence, params, harmonyCursor, output, cancel);
+        }
+
+        // The last note was waiting for a slide that won't come
+        releaseHeldNote(sequence, output);
+
+        // Curves run to the end of the file, which leaves the synth unbent, as a stop does
+        advanceLanes(sequence, output, endTick);
+        output.lanes.stop([&](const juce::MidiMessage& message) { sequence.addEvent(message, endTick); });
 
         // Update sequence end time
         sequence.updateMatchedPairs();
@@ -116,9 +134,9 @@ public:
         return midiFile;
     }
 
-    static juce::MemoryBlock exportToMemory(const PatternParams& params)
+    static juce::MemoryBlock exportToMemory(const PatternParams& params, const CancellationToken* cancel = nullptr)
     {
-        auto midiFile = generatePattern(params);
+        auto midiFile = generatePattern(params, cancel);
 
         juce::MemoryOutputStream outStream;
         midiFile.writeTo(outStream);
@@ -126,6 +144,278 @@ public:
         return outStream.getMemoryBlock();
     }
 
+    // The pattern played on the preview synth, for auditioning without a host or a synth
+    static juce::AudioBuffer<float> renderPreview(const PatternParams& params, double sampleRate)
+    {
+        auto midiFile = generatePattern(params);
+        return PreviewSynth::renderSequence(*midiFile.getTrack(0), ticksPerQuarter * params.bpm / 60.0,
+                                            sampleRate, params.controlLanes.bendRange);
+    }
+
 private:
+    // Curve points are written in whole ticks, counted from the note that started them. The
+    // last note's channel is held until it ends, so an overlapping note gets another. A step's
+    // last note-off waits for the next note: if that's a slide on the following step, the note
+    // is held into it, as the processor holds it.
+    struct OutputCursor
+    {
+        ControlLanes lanes;
+        int tick = 0;
+
+        NoteChannels channels;
+        int heldChannel = 0;
+        int heldPitch = -1;
+        double heldUntil = 0.0;
+
+        bool offPending = false;
+        int heldBar = 0, heldStep = 0, heldSteps = 0;
+
+        bool isStepAfterHeld(int bar, int step) const noexcept
+        {
+            return (bar == heldBar && step == heldStep + 1)
+                || (bar == heldBar + 1 && step == 0 && heldStep == heldSteps - 1);
+        }
+    };
+
+    static void releaseHeldNote(juce::MidiMessageSequence& sequence, OutputCursor& output)
+    {
+        if (output.offPending)
+            sequence.addEvent(juce::MidiMessage::noteOff(output.heldChannel, output.heldPitch), output.heldUntil);
+        output.offPending = false;
+    }
+
+    static void advanceLanes(juce::MidiMessageSequence& sequence, OutputCursor& cursor, int untilTick)
+    {
+        while (cursor.lanes.untilNext() != CurveLane::idle && cursor.lanes.untilNext() <= untilTick - cursor.tick)
+        {
+            auto due = cursor.lanes.untilNext();
+            cursor.lanes.skip(due - 1);
+            cursor.tick += due;
+            cursor.lanes.step([&](const juce::MidiMessage& message) { sequence.addEvent(message, cursor.tick); });
+        }
+
+        if (untilTick > cursor.tick)
+        {
+            cursor.lanes.skip(untilTick - cursor.tick);
+            cursor.tick = untilTick;
+        }
+    }
+
+    // One compiled pattern for as many bars as asked; returns the tick it ends on
+    static int addPattern(juce::MidiMessageSequence& sequence, const PatternParams& params,
+                          HarmonyTrack::Cursor& harmonyCursor, OutputCursor& output, const CancellationToken* cancel)
+    {
+        // Same compiled bar the processor plays, varied per bar by the phrase generator
+        CompiledPattern pattern;
+        pattern.steps = params.steps;
+        pattern.hits = params.hits;
+        pattern.rotation = params.rotation;
+        pattern.rootNote = params.rootNote;
+        pattern.scaleIndex = params.scaleIndex;
+        pattern.octaveRange = params.octaveRange;
+        pattern.seed = params.seed;
+        pattern.pitchModelType = static_cast<PitchModel::Type>(juce::jlimit(0, 3, params.pitchModel));
+        pattern.pitchSpread = params.pitchSpread;
+        pattern.velocity = params.velocity;
+        pattern.humanize = params.humanize;
+        pattern.fillEvery = params.fillEvery;
+        pattern.mutation = params.mutation;
+        pattern.rotationDrift = params.rotationDrift;
+        pattern.pitchLength = params.pitchLength;
+        pattern.accentLength = params.accentLength;
+        pattern.humanizeTiming = params.humanizeTiming;
+        pattern.probability = params.probability;
+        pattern.variationCycle = params.variationCycle;
+        pattern.kickMode = params.kickMode;
+        pattern.swing = params.swing;
+        pattern.noteLength = params.noteLength;
+        pattern.ratchetChance = params.ratchetChance;
+        pattern.ratchetCount = params.ratchetCount;
+        pattern.rollRamp = params.rollRamp;
+        pattern.microTiming = params.microTiming;
+        pattern.grooveAmount = params.grooveAmount;
+        pattern.glideChance = params.glideChance;
+        pattern.glideTime = params.glideTime;
+        GrooveTemplate::apply(params.groove.get(), pattern);
+        KickPattern::apply(params.kick.get(), pattern);
+        pattern.compileAll(params.userScale.get());
+
+        // Exports are off the audio thread, so optimise in place rather than via the worker
+        if (params.voiceLeading)
+        {
+            VoiceLeadingOptimiser optimiser;
+            optimiser.optimise(pattern, params.userScale.get()).applyTo(pattern);
+        }
+
+        applyMorph(params, pattern);
+        PhraseGenerator phrase(pattern);
+
+        // Calculate timing
+        double beatsPerBar = params.timeSignatureNumerator;
+        double beatsPerStep = beatsPerBar / params.steps;
+        double ticksPerBeat = 960.0;
+        double ticksPerStep = ticksPerBeat * beatsPerStep;
+
+        // Bars are computed as the stream reaches them, so cost grows with numBars only
+        int numBars = params.numBars > 0 ? params.numBars
+                                         : static_cast<int>(std::min<int64_t>(phrase.cycleBars(), maxCycleBars));
+
+        for (const auto event : phrase.events(params.firstBar, numBars))
+        {
+            if (cancel != nullptr && cancel->isCancelled())
+                break;
+
+            // Calculate base timestamp
+            double baseTimestamp = (static_cast<double>(event.bar - params.firstBar) * params.steps + event.step) * ticksPerStep;
+
+            addNote(sequence, pattern, baseTimestamp, ticksPerStep, event.bar, event.step, event.pitch,
+                    event.velocity, event.accent, event.shift, params, harmonyCursor, output);
+        }
+
+        return juce::roundToInt(numBars * beatsPerBar * ticksPerBeat);
+    }
+
+    // Each bar from its section's pattern, as the processor plays it in song mode
+    static int addArrangement(juce::MidiMessageSequence& sequence, const PatternParams& params,
+                              HarmonyTrack::Cursor& harmonyCursor, OutputCursor& output, const CancellationToken* cancel)
+    {
+        const auto& arrangement = *params.arrangement;
+
+        // The phrases hold on to their patterns, so the morphed copies are all made first
+        std::vector<CompiledPattern> patterns(arrangement.patterns.begin(), arrangement.patterns.end());
+        for (auto& pattern : patterns)
+            applyMorph(params, pattern);
+
+        std::vector<std::unique_ptr<PhraseGenerator>> phrases;
+        for (const auto& pattern : patterns)
+            phrases.push_back(std::make_unique<PhraseGenerator>(pattern));
+
+        double beatsPerBar = params.timeSignatureNumerator;
+        double ticksPerBeat = 960.0;
+        int numBars = params.numBars > 0 ? params.numBars : arrangement.numBars();
+
+        for (int barIndex = params.firstBar; barIndex < params.firstBar + numBars; ++barIndex)
+        {
+            if (cancel != nullptr && cancel->isCancelled())
+                break;
+
+            auto section = static_cast<size_t>(arrangement.sectionAt(barIndex));
+            const auto& pattern = patterns[section];
+            const auto& bar = phrases[section]->bar(barIndex);
+
+            double ticksPerStep = ticksPerBeat * beatsPerBar / pattern.steps;
+            double barStart = (barIndex - params.firstBar) * beatsPerBar * ticksPerBeat;
+
+            for (int step = 0; step < bar.steps; ++step)
+                if (bar.triggers(step))
+                    addNote(sequence, pattern, barStart + step * ticksPerStep, ticksPerStep, barIndex, step,
+                            bar.pitches[static_cast<size_t>(step)], bar.velocities[static_cast<size_t>(step)],
+                            bar.accented(step), bar.shifts[static_cast<size_t>(step)], params, harmonyCursor, output);
+        }
+
+        return juce::roundToInt(numBars * beatsPerBar * ticksPerBeat);
+    }
+
+    // The processor's syncMorph(): the morphed bar replaces the pattern's triggers, pitches and
+    // velocities, after voice leading
+    static void applyMorph(const PatternParams& params, CompiledPattern& pattern)
+    {
+        if (params.morphSlots == nullptr || !params.morphSlots->fit(pattern))
+            return;
+
+        PatternMorph morph;
+        morph.update(*params.morphSlots, params.morph);
+        pattern.triggerMask = morph.triggerMask;
+        pattern.pitches = morph.pitches;
+        pattern.velocities = morph.velocities;
+    }
+
+    static void addNote(juce::MidiMessageSequence& sequence, const CompiledPattern& pattern, double baseTimestamp,
+                        double ticksPerStep, int bar, int step, int pitch, int velocity, bool accent, float shift,
+                        const PatternParams& params, HarmonyTrack::Cursor& harmonyCursor, OutputCursor& output)
+    {
+        double ticksPerBeat = 960.0;
+
+        // Follow the harmony track at the step's grid position in the song, as the processor
+        // does; the file's ticks count from firstBar
+        if (params.harmony != nullptr)
+        {
+            double songPpq = params.firstBar * static_cast<double>(params.timeSignatureNumerator) + baseTimestamp / ticksPerBeat;
+            if (auto* region = harmonyCursor.find(*params.harmony, songPpq))
+                pitch = region->apply(pitch, pattern.rootNote);
+        }
+
+        // The step's burst: one note, or a ratchet, at the offsets the processor plays. Swing
+        // and groove are in the offsets, measured from a step start timingLead ahead of the grid;
+        // this bar's humanize shifts the lot.
+        const auto& burst = pattern.bursts[static_cast<size_t>(step)];
+        double timestamp = baseTimestamp + ticksPerStep * (shift - pattern.timingLead);
+        double noteDuration = ticksPerStep * pattern.noteLength * burst.length;
+
+        for (int note = 0; note < burst.count; ++note)
+        {
+            // A note pulled ahead of the first bar starts the file instead
+            double noteStart = juce::jmax(0.0, timestamp + ticksPerStep * burst.offsets[static_cast<size_t>(note)]);
+            int noteVelocity = juce::jlimit(1, 127, juce::roundToInt(static_cast<float>(velocity) * burst.gains[static_cast<size_t>(note)]));
+
+            auto emitAtNote = [&](const juce::MidiMessage& message) { sequence.addEvent(message, noteStart); };
+
+            // A slide from the step before is played legato: that step's last note was held, and
+            // ends once this one has started. Onto the same pitch it ends just before instead.
+            bool slide = note == 0 && burst.slide;
+            bool heldIntoSlide = slide && output.offPending && output.isStepAfterHeld(bar, step);
+            bool legato = heldIntoSlide && output.heldPitch != pitch;
+            int legatoChannel = output.heldChannel, legatoPitch = output.heldPitch;
+            if (heldIntoSlide)
+                output.heldUntil = noteStart;
+            if (!legato)
+                releaseHeldNote(sequence, output);
+            output.offPending = false;
+
+            // The note's channel, as the processor assigns it
+            bool released = !legato && output.heldUntil <= noteStart;
+            if (released)
+                output.channels.noteOff(output.heldChannel, output.heldPitch);
+
+            auto role = NoteChannels::roleOf(note, slide, accent);
+            int channel = output.channels.noteOn(pitch, role, params.controlLanes.bendRange, emitAtNote);
+
+            if (!released)
+                output.channels.noteOff(output.heldChannel, output.heldPitch);
+            output.heldChannel = channel;
+            output.heldPitch = pitch;
+            output.heldUntil = noteStart + noteDuration;
+
+            // The lanes' points up to the note, then its start values, ahead of it
+            advanceLanes(sequence, output, juce::roundToInt(noteStart));
+            output.lanes.noteOn(channel, pitch, noteVelocity, slide, pattern.glideTime, ticksPerStep, emitAtNote);
+
+            // Add note on
+            sequence.addEvent(
+                juce::MidiMessage::noteOn(channel, pitch, (juce::uint8)noteVelocity),
+                noteStart
+            );
+
+            if (legato)
+                sequence.addEvent(juce::MidiMessage::noteOff(legatoChannel, legatoPitch), noteStart);
+
+            // Add note off, or for the step's last note, wait to see whether the next one slides
+            if (note == burst.count - 1)
+            {
+                output.offPending = true;
+                output.heldBar = bar;
+                output.heldStep = step;
+                output.heldSteps = pattern.steps;
+            }
+            else
+            {
+                sequence.addEvent(
+                    juce::MidiMessage::noteOff(channel, pitch),
+                    noteStart + noteDuration
+                );
+            }
+        }
+    }
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiPatternExporter)
 };
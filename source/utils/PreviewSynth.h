@@ -0,0 +1,292 @@
+#pragma once
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+#include <array>
+#include <cmath>
+
+// A monophonic bass voice for auditioning without an external synth: a stack of band-limited
+// saws (a fundamental, two detuned copies and a sub an octave down) through a 24 dB ladder
+// low-pass with its own decay envelope. The saws share one SIMD register, a lane each, so the
+// whole stack costs about what one scalar oscillator would. Pitch, cutoff and glide are worked
+// out once per control block of 32 samples; between events the voice runs in whole blocks.
+// Plays the MIDI the processor generates (any channel; the last note wins), including the
+// glide bends, portamento and the CC 74 lane.
+class PreviewSynth
+{
+public:
+    static constexpr int controlBlock = 32;
+
+    void prepare(double newSampleRate, int maximumBlockSize)
+    {
+        sampleRate = newSampleRate;
+        scratch.setSize(1, juce::jmax(maximumBlockSize, controlBlock), false, false, true);
+
+        filter.prepare({ sampleRate, static_cast<juce::uint32>(scratch.getNumSamples()), 1 });
+        filter.setMode(juce::dsp::LadderFilterMode::LPF24);
+        filter.setResonance(0.45f);
+        filter.setDrive(1.4f);
+
+        attackStep = static_cast<float>(1.0 / (0.002 * sampleRate));
+        decayCoeff = onePole(0.25);
+        releaseCoeff = onePole(0.04);
+        filterDecayCoeff = onePole(0.18);
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        phases = Vec::expand(0.0f);
+        note = -1;
+        gate = false;
+        attacking = false;
+        level = 0.0f;
+        filterEnvelope = 0.0f;
+        bend = 0.0f;
+        brightness = -1;
+        portamento = false;
+        filter.reset();
+    }
+
+    void setBendRange(int semitones) noexcept { bendRange = static_cast<float>(semitones); }
+
+    // Adds the voice to every channel of buffer from startSample, playing the messages of midi
+    // that fall in the range (their positions are buffer samples)
+    void render(juce::AudioBuffer<float>& buffer, const juce::MidiBuffer& midi, int startSample, int numSamples) noexcept
+    {
+        int position = startSample;
+        int end = startSample + numSamples;
+
+        for (const auto metadata : midi)
+        {
+            if (metadata.samplePosition < startSample)
+                continue;
+            if (metadata.samplePosition >= end)
+                break;
+
+            renderVoice(buffer, position, metadata.samplePosition);
+            position = metadata.samplePosition;
+            handleMessage(metadata.getMessage());
+        }
+
+        renderVoice(buffer, position, end);
+    }
+
+    // Headless: a whole sequence, timestamps in ticks, rendered to a new mono buffer with a
+    // tail for the last release
+    static juce::AudioBuffer<float> renderSequence(const juce::MidiMessageSequence& sequence, double ticksPerSecond,
+                                                   double sampleRate, int bendRange, double tailSeconds = 0.5)
+    {
+        constexpr int blockSize = 512;
+        auto toSample = [&](double ticks) { return static_cast<int>(std::llround(ticks / ticksPerSecond * sampleRate)); };
+
+        int length = toSample(sequence.getEndTime()) + static_cast<int>(tailSeconds * sampleRate);
+        juce::AudioBuffer<float> output(1, juce::jmax(length, 1));
+        output.clear();
+
+        auto synth = std::make_unique<PreviewSynth>();
+        synth->prepare(sampleRate, blockSize);
+        synth->setBendRange(bendRange);
+
+        juce::MidiBuffer block;
+        int event = 0;
+        for (int start = 0; start < output.getNumSamples(); start += blockSize)
+        {
+            int numSamples = juce::jmin(blockSize, output.getNumSamples() - start);
+
+            block.clear();
+            for (; event < sequence.getNumEvents(); ++event)
+            {
+                const auto& message = sequence.getEventPointer(event)->message;
+                int sample = toSample(message.getTimeStamp());
+                if (sample >= start + numSamples)
+                    break;
+                block.addEvent(message, sample);
+            }
+
+            synth->render(output, block, start, numSamples);
+        }
+
+        return output;
+    }
+
+private:
+    using Vec = juce::dsp::SIMDRegister<float>;
+    static constexpr size_t lanes = Vec::SIMDNumElements;
+
+    double sampleRate = 44100.0;
+    juce::AudioBuffer<float> scratch;
+    juce::dsp::LadderFilter<float> filter;
+
+    // Oscillator stack, a saw per lane
+    Vec phases = Vec::expand(0.0f);
+    Vec increments = Vec::expand(0.0f);
+    Vec inverseIncrements = Vec::expand(0.0f);
+    Vec gains = Vec::expand(0.0f);
+
+    // Voice
+    int note = -1;
+    int velocity = 0;
+    bool gate = false;
+    bool attacking = false;
+    float level = 0.0f;
+    float filterEnvelope = 0.0f;
+    float pitch = 0.0f;  // Semitones, gliding towards note under portamento
+    float bend = 0.0f;   // -1 to 1
+    float bendRange = 2.0f;
+    int brightness = -1; // CC 74, -1 until one arrives
+    bool portamento = false;
+    float portamentoCoeff = 0.0f;
+
+    float attackStep = 0.0f;
+    float decayCoeff = 0.0f;
+    float releaseCoeff = 0.0f;
+    float filterDecayCoeff = 0.0f;
+
+    static constexpr float sustain = 0.6f;
+
+    // Per-sample coefficient reaching 1/e in the given time
+    float onePole(double seconds) const noexcept
+    {
+        return static_cast<float>(1.0 - std::exp(-1.0 / (seconds * sampleRate)));
+    }
+
+    void handleMessage(const juce::MidiMessage& message) noexcept
+    {
+        if (message.isNoteOn())
+        {
+            bool legato = gate;
+            note = message.getNoteNumber();
+            velocity = message.getVelocity();
+            gate = true;
+            attacking = attacking || !legato;
+            filterEnvelope = static_cast<float>(velocity) / 127.0f;
+
+            // A slide under portamento glides; anything else jumps
+            if (!(portamento && legato))
+                pitch = static_cast<float>(note);
+        }
+        else if (message.isNoteOff())
+        {
+            if (message.getNoteNumber() == note)
+                gate = attacking = false;
+        }
+        else if (message.isPitchWheel())
+        {
+            bend = static_cast<float>(message.getPitchWheelValue() - 8192) / 8192.0f;
+        }
+        else if (message.isController())
+        {
+            if (message.getControllerNumber() == 74)
+                brightness = message.getControllerValue();
+            else if (message.getControllerNumber() == 65)
+                portamento = message.getControllerValue() >= 64;
+            else if (message.getControllerNumber() == 5)
+                portamentoCoeff = onePole(0.002 + 0.25 * message.getControllerValue() / 127.0);
+        }
+        else if (message.isAllNotesOff() || message.isAllSoundOff())
+        {
+            gate = attacking = false;
+        }
+    }
+
+    void renderVoice(juce::AudioBuffer<float>& buffer, int start, int end) noexcept
+    {
+        while (start < end)
+        {
+            int numSamples = juce::jmin(end - start, scratch.getNumSamples());
+            renderChunk(buffer, start, numSamples);
+            start += numSamples;
+        }
+    }
+
+    void renderChunk(juce::AudioBuffer<float>& buffer, int start, int numSamples) noexcept
+    {
+        // Silent and released: nothing to add
+        if (!gate && level < 1.0e-5f)
+        {
+            level = 0.0f;
+            return;
+        }
+
+        // Each control block is filtered at its own cutoff, so the envelope moves smoothly
+        auto* samples = scratch.getWritePointer(0);
+        juce::dsp::AudioBlock<float> block(scratch);
+        for (int offset = 0; offset < numSamples; offset += controlBlock)
+        {
+            int count = juce::jmin(controlBlock, numSamples - offset);
+            updateControls(count);
+            renderOscillators(samples + offset, count);
+
+            auto controlSubBlock = block.getSubBlock(static_cast<size_t>(offset), static_cast<size_t>(count));
+            filter.process(juce::dsp::ProcessContextReplacing<float>(controlSubBlock));
+        }
+
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            buffer.addFrom(channel, start, scratch, 0, 0, numSamples);
+    }
+
+    // Pitch, glide and cutoff for the next control block
+    void updateControls(int count) noexcept
+    {
+        if (portamento)
+            pitch += (static_cast<float>(note) - pitch) * (1.0f - std::pow(1.0f - portamentoCoeff, static_cast<float>(count)));
+
+        static constexpr std::array<float, 4> detunes { 0.0f, 0.08f, -0.08f, -12.0f };
+        static constexpr std::array<float, 4> stack { 0.32f, 0.22f, 0.22f, 0.34f };
+
+        auto frequency = 440.0 * std::pow(2.0, (pitch + bend * bendRange - 69.0) / 12.0);
+        for (size_t lane = 0; lane < lanes; ++lane)
+        {
+            auto increment = static_cast<float>(frequency * std::pow(2.0, detunes[lane % 4] / 12.0) / sampleRate);
+            increments.set(lane, increment);
+            inverseIncrements.set(lane, 1.0f / increment);
+            gains.set(lane, stack[lane % 4] * 4.0f / static_cast<float>(lanes));
+        }
+
+        // Cutoff opens with each note's velocity and closes over its decay; CC 74 moves the base
+        float base = brightness < 0 ? 220.0f : 60.0f * std::pow(2.0f, 6.0f * static_cast<float>(brightness) / 127.0f);
+        filter.setCutoffFrequencyHz(juce::jmin(base * std::pow(2.0f, 5.0f * filterEnvelope), 0.45f * static_cast<float>(sampleRate)));
+        filterEnvelope *= std::pow(1.0f - filterDecayCoeff, static_cast<float>(count));
+    }
+
+    // The saw stack with PolyBLEP edges, all lanes at once, times the amp envelope
+    void renderOscillators(float* samples, int count) noexcept
+    {
+        const auto one = Vec::expand(1.0f), two = Vec::expand(2.0f);
+        auto velocityGain = 0.2f + 0.4f * static_cast<float>(velocity) / 127.0f;
+
+        for (int i = 0; i < count; ++i)
+        {
+            phases += increments;
+            phases = phases - (one & Vec::greaterThanOrEqual(phases, one));
+
+            // Just after a wrap, and just before the next
+            auto early = phases * inverseIncrements;
+            auto late = (phases - one) * inverseIncrements;
+            auto blep = ((early + early - early * early - one) & Vec::lessThan(phases, increments))
+                        + ((late * late + late + late + one) & Vec::greaterThan(phases, one - increments));
+
+            auto saws = phases * two - one - blep;
+            samples[i] = (saws * gains).sum() * nextLevel() * velocityGain;
+        }
+    }
+
+    float nextLevel() noexcept
+    {
+        if (attacking)
+        {
+            level += attackStep;
+            if (level >= 1.0f)
+            {
+                level = 1.0f;
+                attacking = false;
+            }
+        }
+        else
+        {
+            level += ((gate ? sustain : 0.0f) - level) * (gate ? decayCoeff : releaseCoeff);
+        }
+
+        return level;
+    }
+};
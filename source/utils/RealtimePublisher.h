@@ -0,0 +1,69 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Hands immutable objects built off the audio thread to the audio thread.
+//
+// Writers publish shared_ptrs; the audio thread acquires a raw pointer that stays valid
+// until its next acquire(). The audio thread advertises what it is reading, so writers
+// only release objects that are neither the latest nor in use. acquire() never locks,
+// allocates or frees.
+template <typename T>
+class RealtimePublisher
+{
+public:
+    // Any non-realtime thread
+    void publish(std::shared_ptr<const T> object)
+    {
+        const juce::ScopedLock sl(writerLock);
+
+        latest.store(object.get());
+        current = object;
+
+        if (object != nullptr)
+            owned.push_back(std::move(object));
+
+        collectGarbage();
+    }
+
+    // Any non-realtime thread: the most recently published object
+    std::shared_ptr<const T> getLatest() const
+    {
+        const juce::ScopedLock sl(writerLock);
+        return current;
+    }
+
+    // Audio thread only. The result is valid until the next call.
+    const T* acquire() noexcept
+    {
+        const T* object = nullptr;
+        do
+        {
+            object = latest.load();
+            inUse.store(object);
+        } while (object != latest.load());
+
+        return object;
+    }
+
+private:
+    void collectGarbage()
+    {
+        auto* newest = latest.load();
+        auto* reading = inUse.load();
+
+        owned.erase(std::remove_if(owned.begin(), owned.end(), [&](const auto& o)
+                        { return o.get() != newest && o.get() != reading; }),
+            owned.end());
+    }
+
+    std::atomic<const T*> latest { nullptr };
+    std::atomic<const T*> inUse { nullptr };
+
+    juce::CriticalSection writerLock;
+    std::shared_ptr<const T> current;
+    std::vector<std::shared_ptr<const T>> owned;
+};
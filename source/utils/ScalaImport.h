@@ -0,0 +1,139 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include "../generator/ScaleEngine.h"
+
+// Reads Scala scale (.scl) and keyboard mapping (.kbm) files.
+// The plugin emits standard MIDI notes, so every pitch is rounded to the nearest
+// 12-TET semitone; microtonal detail is lost, the interval shape is kept.
+class ScalaImport
+{
+public:
+    // Returns the scale, or nothing if the file is malformed
+    static std::optional<ScaleEngine::ScaleDefinition> parseScl(const juce::String& text)
+    {
+        auto lines = dataLines(text, true);
+        if (lines.size() < 2)
+            return std::nullopt;
+
+        // Line 0 is the description, line 1 the note count, then one pitch per line
+        int count = lines[1].trim().getIntValue();
+        if (count <= 0 || lines.size() < count + 2)
+            return std::nullopt;
+
+        std::vector<int> semitones { 0 };
+        for (int i = 0; i < count; ++i)
+        {
+            auto cents = parsePitch(lines[i + 2]);
+            if (!cents.has_value())
+                return std::nullopt;
+            semitones.push_back(juce::roundToInt(*cents / 100.0));
+        }
+
+        // The last pitch is the period the scale repeats at
+        int period = semitones.back();
+        semitones.pop_back();
+        if (period <= 0)
+            return std::nullopt;
+
+        return makeDefinition(semitones, period);
+    }
+
+    // Applies a keyboard mapping: the scale degrees the mapping uses become the scale, and the
+    // formal octave degree sets the period. Reference pitch/frequency are ignored
+    // (the root comes from the Root Note parameter).
+    static std::optional<ScaleEngine::ScaleDefinition> applyKbm(const ScaleEngine::ScaleDefinition& scale,
+                                                               const juce::String& text)
+    {
+        auto lines = dataLines(text, false);
+        if (lines.size() < 7)
+            return std::nullopt;
+
+        int mapSize = lines[0].trim().getIntValue();
+        int octaveDegree = lines[6].trim().getIntValue();
+
+        // A linear mapping (size 0) keeps the scale as it is
+        if (mapSize <= 0)
+            return scale;
+
+        std::vector<int> semitones;
+        for (int i = 0; i < mapSize && 7 + i < lines.size(); ++i)
+        {
+            auto entry = lines[7 + i].trim();
+            if (entry.startsWithIgnoreCase("x"))
+                continue; // Unmapped key
+
+            int degree = entry.getIntValue();
+            if (degree >= 0 && degree < scale.size)
+                semitones.push_back(scale.intervals[static_cast<size_t>(degree)]);
+        }
+
+        if (semitones.empty())
+            return std::nullopt;
+
+        std::sort(semitones.begin(), semitones.end());
+        int period = (octaveDegree > 0 && octaveDegree < scale.size)
+                         ? scale.intervals[static_cast<size_t>(octaveDegree)]
+                         : scale.period;
+
+        return makeDefinition(semitones, period);
+    }
+
+private:
+    // Non-comment lines; .scl allows a blank description so keep empty lines there
+    static juce::StringArray dataLines(const juce::String& text, bool keepEmpty)
+    {
+        juce::StringArray lines;
+        for (auto line : juce::StringArray::fromLines(text))
+        {
+            if (line.startsWith("!"))
+                continue;
+            if (!keepEmpty && line.trim().isEmpty())
+                continue;
+            lines.add(line);
+        }
+        return lines;
+    }
+
+    // "701.955" is cents, "3/2" or "2" is a ratio. Anything after the value is a comment.
+    static std::optional<double> parsePitch(const juce::String& line)
+    {
+        auto token = line.trim().upToFirstOccurrenceOf(" ", false, false).upToFirstOccurrenceOf("\t", false, false);
+        if (token.isEmpty())
+            return std::nullopt;
+
+        if (token.containsChar('.'))
+            return token.getDoubleValue();
+
+        auto numerator = token.upToFirstOccurrenceOf("/", false, false).getDoubleValue();
+        auto denominator = token.containsChar('/') ? token.fromFirstOccurrenceOf("/", false, false).getDoubleValue() : 1.0;
+        if (numerator <= 0.0 || denominator <= 0.0)
+            return std::nullopt;
+
+        return 1200.0 * std::log2(numerator / denominator);
+    }
+
+    // Rounds, de-duplicates and clamps to what a pitch table can hold
+    static std::optional<ScaleEngine::ScaleDefinition> makeDefinition(std::vector<int> semitones, int period)
+    {
+        std::sort(semitones.begin(), semitones.end());
+        semitones.erase(std::unique(semitones.begin(), semitones.end()), semitones.end());
+        semitones.erase(std::remove_if(semitones.begin(), semitones.end(),
+                            [period](int s) { return s < 0 || s >= period; }),
+            semitones.end());
+
+        if (semitones.empty() || semitones.front() != 0)
+            semitones.insert(semitones.begin(), 0);
+
+        ScaleEngine::ScaleDefinition definition;
+        definition.name = "User (Scala)";
+        definition.period = juce::jlimit(1, 48, period);
+        definition.size = juce::jmin(static_cast<int>(semitones.size()), ScaleEngine::maxDegrees);
+        for (int i = 0; i < definition.size; ++i)
+            definition.intervals[static_cast<size_t>(i)] = static_cast<int8_t>(semitones[static_cast<size_t>(i)]);
+
+        return definition;
+    }
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include <juce_graphics/juce_graphics.h>
+#include <map>
+#include <memory>
+#include <string>
+#include "BinaryData.h"
+#include "JobSystem.h"
+#include "../generator/GrooveTemplate.h"
+#include "../generator/HarmonyTrack.h"
+#include "../generator/KickPattern.h"
+#include "../generator/ScaleEngine.h"
+
+// One copy of an immutable object per key, for as long as any instance holds it.
+// A session that restores the same tuning or progression into every instance builds it once.
+template <typename T>
+class SharedObjectCache
+{
+public:
+    // Message thread (or any non-realtime thread). create() returns nullptr on failure;
+    // failures aren't cached.
+    template <typename Factory>
+    std::shared_ptr<const T> getOrCreate(const std::string& key, Factory&& create)
+    {
+        // Held while building too, so instances loading the same thing at once wait for the first
+        const juce::ScopedLock sl(lock);
+
+        for (auto it = objects.begin(); it != objects.end();)
+            it = it->second.expired() ? objects.erase(it) : std::next(it);
+
+        if (auto found = objects.find(key); found != objects.end())
+            if (auto existing = found->second.lock())
+                return existing;
+
+        std::shared_ptr<const T> created = create();
+        if (created != nullptr)
+            objects[key] = created;
+
+        return created;
+    }
+
+private:
+    juce::CriticalSection lock;
+    std::map<std::string, std::weak_ptr<const T>> objects;
+};
+
+// Immutable data shared by every instance in the host process. Hold it through a
+// juce::SharedResourcePointer<SharedResources>: the first holder creates it, the last frees it.
+// Built-in scale and Euclidean tables are constexpr, so they are shared already.
+class SharedResources
+{
+public:
+    // Decoded the first time an editor asks, so headless instances never pay for it
+    juce::Image getLogo()
+    {
+        const juce::ScopedLock sl(logoLock);
+        if (!logo.isValid())
+            logo = juce::ImageFileFormat::loadFrom(BinaryData::makebasslogo_png, BinaryData::makebasslogo_pngSize);
+        return logo;
+    }
+
+    SharedObjectCache<ScaleEngine::UserScale> userScales;  // Keyed by .scl and .kbm text
+    SharedObjectCache<HarmonyTrack> harmonyTracks;         // Keyed by MIDI file bytes
+    SharedObjectCache<GrooveTemplate> grooves;             // Keyed by MIDI file bytes
+    SharedObjectCache<KickPattern> kickPatterns;           // Keyed by MIDI file bytes
+
+    // Worker threads for every instance's JobSystem
+    JobPool jobPool;
+
+private:
+    juce::CriticalSection logoLock;
+    juce::Image logo;
+};
@@ -0,0 +1,327 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+
+// Set to 0 from CMake (MAKEBASSLINE_RELEASE_TRACING=OFF) to compile trace points out of Release builds
+#ifndef MAKEBASSLINE_TRACING
+    #define MAKEBASSLINE_TRACING 1
+#endif
+
+// Process-wide timeline capture written as Chrome trace JSON (loads in Perfetto and chrome://tracing).
+// Each thread records into its own preallocated single-producer ring, handed back to the pool when
+// the thread exits; a background thread drains them to disk while a capture is running. Names,
+// categories and thread names must be string literals.
+class TraceRecorder : private juce::Thread
+{
+public:
+    struct Event
+    {
+        const char* category = nullptr;
+        const char* name = nullptr;
+        juce::int64 ticks = 0;
+        juce::int64 value = 0;
+        char phase = 'i'; // 'B' begin, 'E' end, 'i' instant
+        bool hasValue = false;
+    };
+
+    static constexpr bool enabled = MAKEBASSLINE_TRACING != 0;
+    static constexpr int maxThreads = 16; // Recording at once; threads that exit free theirs
+    static constexpr uint32_t eventsPerThread = 1 << 12; // ~80k events/s per thread at the 50 ms drain rate
+
+    static TraceRecorder& getInstance()
+    {
+        static TraceRecorder instance;
+        return instance;
+    }
+
+    ~TraceRecorder() override { stop(); }
+
+    static bool isRecording() noexcept { return recording.load(std::memory_order_relaxed); }
+
+    // Message thread: begins a capture into the given file
+    bool start(const juce::File& file)
+    {
+        stop();
+
+        file.deleteFile();
+        output = std::make_unique<juce::FileOutputStream>(file);
+        if (!output->openedOk())
+        {
+            output.reset();
+            return false;
+        }
+
+        *output << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        firstEvent = true;
+        captureFile = file;
+
+        // Discard anything left over from a previous capture, and free the buffers of threads
+        // that have exited since
+        for (auto& buffer : buffers)
+        {
+            buffer.readIndex.store(buffer.writeIndex.load());
+            buffer.dropped.store(0);
+            auto released = static_cast<int>(Slot::released);
+            buffer.state.compare_exchange_strong(released, static_cast<int>(Slot::free));
+        }
+
+        recording.store(true);
+        startThread(juce::Thread::Priority::low);
+        return true;
+    }
+
+    // Message thread: ends the capture and closes the file
+    void stop()
+    {
+        if (!recording.exchange(false))
+            return;
+
+        stopThread(1000);
+        drain();
+        writeThreadNames();
+
+        *output << "\n]}\n";
+        output->flush();
+        output.reset();
+    }
+
+    juce::File getCaptureFile() const { return captureFile; }
+
+    // Any thread, real-time safe. The first record on a thread claims its buffer, which also
+    // registers the buffer's release for when the thread exits (a one-off allocation in the C
+    // runtime); every record after that is lock-free and allocation-free.
+    static void record(const char* category, const char* name, char phase, juce::int64 value = 0, bool hasValue = false) noexcept
+    {
+        if (auto* buffer = getThreadBuffer())
+            buffer->push({ category, name, juce::Time::getHighResolutionTicks(), value, phase, hasValue });
+    }
+
+    // Any thread, real-time safe: what the calling thread is called in captures. Threads that
+    // aren't named are listed by number.
+    static void nameThread(const char* name) noexcept
+    {
+        auto& thread = threadState();
+        if (thread.name == name)
+            return;
+
+        thread.name = name;
+        if (thread.buffer != nullptr)
+            thread.buffer->label.store(name, std::memory_order_relaxed);
+    }
+
+    class Scope
+    {
+    public:
+        Scope(const char* cat, const char* eventName) noexcept
+            : category(cat), name(eventName), active(isRecording())
+        {
+            if (active)
+                record(category, name, 'B');
+        }
+
+        ~Scope()
+        {
+            if (active)
+                record(category, name, 'E');
+        }
+
+    private:
+        const char* category;
+        const char* name;
+        bool active;
+
+        JUCE_DECLARE_NON_COPYABLE(Scope)
+    };
+
+private:
+    TraceRecorder() : juce::Thread("Trace writer") {}
+
+    // A buffer is claimed by one thread at a time. Once that thread exits the writer drains
+    // what it left and frees the buffer for the next.
+    enum class Slot
+    {
+        free,
+        claiming,
+        claimed,
+        released
+    };
+
+    struct ThreadBuffer
+    {
+        std::array<Event, eventsPerThread> events;
+        std::atomic<uint32_t> writeIndex{0};
+        std::atomic<uint32_t> readIndex{0};
+        std::atomic<uint32_t> dropped{0};
+        std::atomic<int> state{static_cast<int>(Slot::free)};
+        std::atomic<const char*> label{nullptr};
+        int threadId = 0; // Never reused, so a thread that follows another in a buffer is told apart
+
+        void push(const Event& e) noexcept
+        {
+            auto write = writeIndex.load(std::memory_order_relaxed);
+            if (write - readIndex.load(std::memory_order_acquire) >= eventsPerThread)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            events[write % eventsPerThread] = e;
+            writeIndex.store(write + 1, std::memory_order_release);
+        }
+    };
+
+    // Trivially destructible, so naming a thread registers nothing for its exit
+    struct ThreadState
+    {
+        ThreadBuffer* buffer = nullptr;
+        const char* name = nullptr;
+    };
+
+    static ThreadState& threadState() noexcept
+    {
+        thread_local ThreadState state;
+        return state;
+    }
+
+    struct ReleaseOnExit
+    {
+        ThreadBuffer* buffer;
+        ~ReleaseOnExit() { buffer->state.store(static_cast<int>(Slot::released), std::memory_order_release); }
+    };
+
+    // Claims a free buffer the first time a thread records. While the pool is exhausted the
+    // thread goes untraced, trying again at its next record.
+    static ThreadBuffer* getThreadBuffer() noexcept
+    {
+        auto& thread = threadState();
+        if (thread.buffer != nullptr)
+            return thread.buffer;
+
+        auto& instance = getInstance();
+        for (auto& buffer : instance.buffers)
+        {
+            auto expected = static_cast<int>(Slot::free);
+            if (!buffer.state.compare_exchange_strong(expected, static_cast<int>(Slot::claiming)))
+                continue;
+
+            buffer.label.store(thread.name, std::memory_order_relaxed);
+            buffer.threadId = instance.nextThreadId.fetch_add(1) + 1;
+            buffer.readIndex.store(buffer.writeIndex.load());
+            buffer.state.store(static_cast<int>(Slot::claimed), std::memory_order_release);
+            thread.buffer = &buffer;
+
+            thread_local const ReleaseOnExit release { &buffer };
+            return &buffer;
+        }
+
+        return nullptr;
+    }
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            drain();
+            wait(50);
+        }
+    }
+
+    void drain()
+    {
+        for (auto& buffer : buffers)
+        {
+            // Read before the events: once released, nothing more can be pushed
+            auto state = static_cast<Slot>(buffer.state.load(std::memory_order_acquire));
+            if (state != Slot::claimed && state != Slot::released)
+                continue;
+
+            auto read = buffer.readIndex.load(std::memory_order_relaxed);
+            auto write = buffer.writeIndex.load(std::memory_order_acquire);
+
+            for (; read != write; ++read)
+                writeEvent(buffer, buffer.events[read % eventsPerThread]);
+
+            buffer.readIndex.store(read, std::memory_order_release);
+
+            if (state == Slot::released)
+            {
+                writeThreadName(buffer);
+                buffer.dropped.store(0);
+                buffer.state.store(static_cast<int>(Slot::free), std::memory_order_release);
+            }
+        }
+
+        output->flush();
+    }
+
+    void writeEvent(const ThreadBuffer& buffer, const Event& e)
+    {
+        auto micros = juce::Time::highResolutionTicksToSeconds(e.ticks) * 1.0e6;
+
+        if (!firstEvent)
+            *output << ",\n";
+        firstEvent = false;
+
+        *output << "{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category
+                << "\",\"ph\":\"" << juce::String::charToString(e.phase)
+                << "\",\"ts\":" << juce::String(micros, 3)
+                << ",\"pid\":1,\"tid\":" << buffer.threadId;
+
+        if (e.phase == 'i')
+            *output << ",\"s\":\"t\"";
+
+        if (e.hasValue)
+            *output << ",\"args\":{\"value\":" << juce::String(e.value) << "}";
+
+        *output << "}";
+    }
+
+    // Threads still running; those that exited were named as their buffers were freed
+    void writeThreadNames()
+    {
+        for (const auto& buffer : buffers)
+            if (static_cast<Slot>(buffer.state.load(std::memory_order_acquire)) == Slot::claimed)
+                writeThreadName(buffer);
+    }
+
+    void writeThreadName(const ThreadBuffer& buffer)
+    {
+        const auto* label = buffer.label.load(std::memory_order_relaxed);
+
+        if (!firstEvent)
+            *output << ",\n";
+        firstEvent = false;
+
+        *output << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.threadId
+                << ",\"args\":{\"name\":\"" << (label != nullptr ? label : "Thread") << " " << buffer.threadId
+                << " (" << juce::String(buffer.dropped.load()) << " dropped)\"}}";
+    }
+
+    inline static std::atomic<bool> recording{false};
+
+    std::array<ThreadBuffer, maxThreads> buffers;
+    std::atomic<int> nextThreadId{0};
+
+    // Writer side (message thread while idle, writer thread while recording)
+    std::unique_ptr<juce::FileOutputStream> output;
+    juce::File captureFile;
+    bool firstEvent = true;
+
+    JUCE_DECLARE_NON_COPYABLE(TraceRecorder)
+};
+
+#if MAKEBASSLINE_TRACING
+    #define MB_TRACE_SCOPE(category, name) TraceRecorder::Scope JUCE_JOIN_MACRO(traceScope_, __LINE__)(category, name)
+    #define MB_TRACE_THREAD(name) TraceRecorder::nameThread(name)
+    #define MB_TRACE_INSTANT(category, name, value)                          \
+        do                                                                   \
+        {                                                                    \
+            if (TraceRecorder::isRecording())                                \
+                TraceRecorder::record(category, name, 'i', (value), true);   \
+        } while (false)
+#else
+    #define MB_TRACE_SCOPE(category, name)
+    #define MB_TRACE_THREAD(name)
+    #define MB_TRACE_INSTANT(category, name, value)
+#endif
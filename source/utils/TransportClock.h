@@ -0,0 +1,120 @@
+#pragma once
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <cmath>
+#include <cstdint>
+
+// Timelines to play against when the host doesn't provide one (the Standalone app, or a rig
+// slaved to hardware). Both run on the audio thread and never allocate.
+
+// Free-running clock driven by the clock tempo/time signature/run parameters
+class InternalClock
+{
+public:
+    struct Position
+    {
+        bool isPlaying = false;
+        double bpm = 120.0;
+        double ppqPosition = 0.0;
+    };
+
+    // Position at the start of this block, then moves on by its length.
+    // Starting again after a stop plays from the top.
+    Position advance(bool running, double bpm, int numSamples, double sampleRate) noexcept
+    {
+        if (running && !wasRunning)
+            ppq = 0.0;
+        wasRunning = running;
+
+        Position position { running, bpm, ppq };
+        if (running)
+            ppq += numSamples * bpm / (60.0 * sampleRate);
+
+        return position;
+    }
+
+private:
+    double ppq = 0.0;
+    bool wasRunning = false;
+};
+
+// Follows incoming MIDI clock (24 ticks per quarter note) with start/stop/continue and song
+// position. Tempo is estimated from tick spacing and smoothed, since tick arrival times carry
+// the sender's and the driver's jitter.
+class MidiClockInput
+{
+public:
+    static constexpr int ticksPerQuarter = 24;
+
+    void prepare(double newSampleRate) noexcept
+    {
+        sampleRate = newSampleRate;
+        lastTickTime = -1;
+    }
+
+    // sampleTime: samples since prepare, including the message's offset within the block
+    // Returns true if the message was a clock/transport message
+    bool handleMessage(const juce::MidiMessage& message, int64_t sampleTime) noexcept
+    {
+        if (message.isMidiStart())
+        {
+            running = true;
+            ticks = 0;
+            lastTickTime = -1;
+        }
+        else if (message.isMidiContinue())
+        {
+            running = true;
+        }
+        else if (message.isMidiStop())
+        {
+            running = false;
+        }
+        else if (message.isSongPositionPointer())
+        {
+            // Song position counts sixteenth notes
+            ticks = static_cast<int64_t>(message.getSongPositionPointerMidiBeat()) * (ticksPerQuarter / 4);
+            lastTickTime = -1;
+        }
+        else if (message.isMidiClock())
+        {
+            if (lastTickTime >= 0 && sampleTime > lastTickTime)
+            {
+                auto measured = 60.0 * sampleRate / (static_cast<double>(sampleTime - lastTickTime) * ticksPerQuarter);
+                bpm += smoothing * (measured - bpm);
+            }
+
+            lastTickTime = sampleTime;
+            if (running)
+                ++ticks;
+        }
+        else
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    bool isPlaying() const noexcept { return running; }
+    double getBpm() const noexcept { return bpm; }
+
+    // Extrapolates from the last tick, never past the next one
+    double getPpqAt(int64_t sampleTime) const noexcept
+    {
+        double ppq = static_cast<double>(ticks) / ticksPerQuarter;
+        if (lastTickTime < 0)
+            return ppq;
+
+        double sinceTick = static_cast<double>(sampleTime - lastTickTime) * bpm / (60.0 * sampleRate);
+        return ppq + std::min(sinceTick, 1.0 / ticksPerQuarter);
+    }
+
+private:
+    static constexpr double smoothing = 0.1;
+
+    double sampleRate = 44100.0;
+    double bpm = 120.0;
+    int64_t ticks = 0;
+    int64_t lastTickTime = -1;
+    bool running = false;
+};
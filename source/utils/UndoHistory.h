@@ -0,0 +1,193 @@
+#pragma once
+#include <juce_data_structures/juce_data_structures.h>
+#include <array>
+#include <bit>
+#include <map>
+#include <memory>
+#include <vector>
+
+// Undo/redo over whole generator states. A state is a few immutable chunks of parameter values
+// (one per compiled field) plus the manual step edits. Recording a state shares every chunk it
+// didn't change with the entry before, so a knob turn costs a handful of pointers and the one
+// chunk that moved: thousands of entries fit in a few hundred kilobytes.
+//
+// Compiled patterns aren't kept. They are derived data and twelve kilobytes each, nearly all of
+// it pitch tables; jumping to an entry compiles it once and hands it to the audio thread as a
+// transaction, which is a pointer swap there.
+//
+// Message thread only.
+class UndoHistory
+{
+public:
+    static constexpr int numChunks = 5; // One per CompiledPattern::Field
+    static constexpr size_t maxEntries = 4096;
+
+    using Chunk = std::vector<float>;
+
+    struct State
+    {
+        std::array<std::shared_ptr<const Chunk>, numChunks> chunks;
+        uint32_t edits = 0; // Bit per manually toggled step
+
+        bool operator==(const State& other) const
+        {
+            for (size_t i = 0; i < chunks.size(); ++i)
+                if (!sameChunk(chunks[i], other.chunks[i]))
+                    return false;
+            return edits == other.edits;
+        }
+    };
+
+    // Forgets everything; state becomes the only entry
+    void reset(State state)
+    {
+        entries.assign(1, std::move(state));
+        position = 0;
+    }
+
+    // Adds state after the current entry, dropping anything that could have been redone.
+    // Returns false when nothing changed.
+    bool record(State state)
+    {
+        if (entries.empty())
+        {
+            reset(std::move(state));
+            return true;
+        }
+
+        const auto& current = entries[position];
+        if (state == current)
+            return false;
+
+        for (size_t i = 0; i < state.chunks.size(); ++i)
+            if (sameChunk(state.chunks[i], current.chunks[i]))
+                state.chunks[i] = current.chunks[i];
+
+        entries.resize(position + 1);
+        entries.push_back(std::move(state));
+
+        if (entries.size() > maxEntries)
+            entries.erase(entries.begin());
+
+        position = entries.size() - 1;
+        return true;
+    }
+
+    bool canUndo() const noexcept { return position > 0; }
+    bool canRedo() const noexcept { return position + 1 < entries.size(); }
+
+    // The entry moved to, or nullptr when there's nowhere to go
+    const State* undo() { return canUndo() ? &entries[--position] : nullptr; }
+    const State* redo() { return canRedo() ? &entries[++position] : nullptr; }
+
+    const State* current() const { return entries.empty() ? nullptr : &entries[position]; }
+    size_t size() const noexcept { return entries.size(); }
+
+    // Chunks are written once however many entries share them
+    juce::ValueTree toValueTree() const
+    {
+        juce::ValueTree tree(historyType);
+        tree.setProperty("position", static_cast<int>(position), nullptr);
+
+        std::map<const Chunk*, int> chunkIds;
+        for (const auto& entry : entries)
+        {
+            juce::String ids;
+            for (const auto& chunk : entry.chunks)
+            {
+                auto [found, added] = chunkIds.try_emplace(chunk.get(), static_cast<int>(chunkIds.size()));
+                if (added)
+                {
+                    juce::ValueTree chunkTree("Chunk");
+                    chunkTree.setProperty("values", encode(*chunk), nullptr);
+                    tree.appendChild(chunkTree, nullptr);
+                }
+                ids << found->second << ' ';
+            }
+
+            juce::ValueTree entryTree("Entry");
+            entryTree.setProperty("chunks", ids.trimEnd(), nullptr);
+            entryTree.setProperty("edits", static_cast<int>(entry.edits), nullptr);
+            tree.appendChild(entryTree, nullptr);
+        }
+
+        return tree;
+    }
+
+    // chunkSizes: how many values each chunk must hold, so a history saved with a different
+    // parameter set is rejected rather than misread. Returns false (and changes nothing) then.
+    bool fromValueTree(const juce::ValueTree& tree, const std::array<size_t, numChunks>& chunkSizes)
+    {
+        if (!tree.hasType(historyType))
+            return false;
+
+        std::vector<std::shared_ptr<const Chunk>> chunks;
+        std::vector<State> loaded;
+
+        for (const auto& child : tree)
+        {
+            if (child.hasType("Chunk"))
+            {
+                chunks.push_back(std::make_shared<const Chunk>(decode(child.getProperty("values").toString())));
+            }
+            else if (child.hasType("Entry"))
+            {
+                auto ids = juce::StringArray::fromTokens(child.getProperty("chunks").toString(), false);
+                if (ids.size() != numChunks)
+                    return false;
+
+                State state;
+                for (int i = 0; i < numChunks; ++i)
+                {
+                    auto id = ids[i].getIntValue();
+                    if (!juce::isPositiveAndBelow(id, static_cast<int>(chunks.size()))
+                        || chunks[static_cast<size_t>(id)]->size() != chunkSizes[static_cast<size_t>(i)])
+                        return false;
+
+                    state.chunks[static_cast<size_t>(i)] = chunks[static_cast<size_t>(id)];
+                }
+
+                state.edits = static_cast<uint32_t>(static_cast<int>(child.getProperty("edits")));
+                loaded.push_back(std::move(state));
+            }
+        }
+
+        auto loadedPosition = static_cast<int>(tree.getProperty("position"));
+        if (loaded.empty() || !juce::isPositiveAndBelow(loadedPosition, static_cast<int>(loaded.size())))
+            return false;
+
+        entries = std::move(loaded);
+        position = static_cast<size_t>(loadedPosition);
+        return true;
+    }
+
+    static inline const juce::Identifier historyType { "UndoHistory" };
+
+private:
+    static bool sameChunk(const std::shared_ptr<const Chunk>& a, const std::shared_ptr<const Chunk>& b)
+    {
+        return a == b || (a != nullptr && b != nullptr && *a == *b);
+    }
+
+    // Bit patterns rather than decimal text, so values come back exactly and compare equal
+    static juce::String encode(const Chunk& chunk)
+    {
+        juce::String text;
+        for (auto value : chunk)
+            text << juce::String::toHexString(static_cast<int>(std::bit_cast<uint32_t>(value))) << ' ';
+        return text.trimEnd();
+    }
+
+    static Chunk decode(const juce::String& text)
+    {
+        Chunk chunk;
+        for (const auto& token : juce::StringArray::fromTokens(text, false))
+            chunk.push_back(std::bit_cast<float>(static_cast<uint32_t>(token.getHexValue32())));
+        return chunk;
+    }
+
+    std::vector<State> entries;
+    size_t position = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(UndoHistory)
+};
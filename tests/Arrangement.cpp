@@ -0,0 +1,154 @@
+#include "helpers/test_helpers.h"
+#include "generator/Arrangement.h"
+#include "utils/MidiPatternExporter.h"
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    CompiledPattern makePattern (int hits)
+    {
+        CompiledPattern pattern;
+        pattern.steps = 16;
+        pattern.hits = hits;
+        pattern.compileAll();
+        return pattern;
+    }
+
+    std::vector<int> everyStep (int every)
+    {
+        std::vector<int> steps;
+        for (int step = 0; step < 16; step += every)
+            steps.push_back (step);
+        return steps;
+    }
+}
+
+TEST_CASE ("Arrangement", "[song]")
+{
+    Arrangement arrangement;
+
+    SECTION ("an empty arrangement has no sections")
+    {
+        CHECK (arrangement.numBars() == 0);
+        CHECK (arrangement.sectionAt (0) == -1);
+    }
+
+    SECTION ("bars map to their sections, looping, with the pre-roll on the first")
+    {
+        REQUIRE (arrangement.addSection (makePattern (4), 1));
+        REQUIRE (arrangement.addSection (makePattern (16), 2));
+
+        CHECK (arrangement.numBars() == 3);
+        CHECK (arrangement.sectionAt (-1) == 0);
+        CHECK (arrangement.sectionAt (0) == 0);
+        CHECK (arrangement.sectionAt (1) == 1);
+        CHECK (arrangement.sectionAt (2) == 1);
+        CHECK (arrangement.sectionAt (3) == 0);
+    }
+
+    SECTION ("sections without bars, or past the longest song, aren't added")
+    {
+        CHECK_FALSE (arrangement.addSection (makePattern (4), 0));
+        REQUIRE (arrangement.addSection (makePattern (4), Arrangement::maxBars));
+        CHECK_FALSE (arrangement.addSection (makePattern (4), 1));
+        CHECK (arrangement.patterns.size() == 1);
+    }
+}
+
+TEST_CASE ("Song mode", "[song]")
+{
+    SECTION ("the export plays each bar from its section, the whole song by default")
+    {
+        auto arrangement = std::make_shared<Arrangement>();
+        arrangement->addSection (makePattern (4), 1);
+        arrangement->addSection (makePattern (16), 2);
+
+        MidiPatternExporter::PatternParams params;
+        params.arrangement = arrangement;
+        params.numBars = 0;
+        auto file = MidiPatternExporter::generatePattern (params);
+        const auto& track = *file.getTrack (0);
+
+        // 960 ticks a quarter, four to the bar
+        constexpr double ticksPerBar = 3840.0;
+        CHECK (stepsPlayed (track, 0.0, ticksPerBar, 16) == everyStep (4));
+        CHECK (stepsPlayed (track, ticksPerBar, ticksPerBar, 16) == everyStep (1));
+        CHECK (stepsPlayed (track, 2.0 * ticksPerBar, ticksPerBar, 16) == everyStep (1));
+        CHECK (stepsPlayed (track, 3.0 * ticksPerBar, ticksPerBar, 16).empty());
+
+        // A set number of bars loops the song
+        params.numBars = 4;
+        file = MidiPatternExporter::generatePattern (params);
+        CHECK (stepsPlayed (*file.getTrack (0), 3.0 * ticksPerBar, ticksPerBar, 16) == everyStep (4));
+    }
+
+    // At 120 bpm and 48 kHz
+    constexpr int samplesPerBar = 96000;
+
+    auto chainTwoSections = [] (BasslineGeneratorProcessor& plugin)
+    {
+        setParameter (plugin, "steps", 16.0f);
+        setParameter (plugin, "hits", 4.0f);
+        plugin.appendChainSection (1);
+        setParameter (plugin, "hits", 16.0f);
+        setParameter (plugin, "rootNote", 48.0f);
+        plugin.appendChainSection (1);
+
+        // What plays once song mode is off again
+        setParameter (plugin, "hits", 8.0f);
+        setParameter (plugin, "rootNote", 40.0f);
+    };
+
+    SECTION ("the processor plays what the song exports")
+    {
+        BasslineGeneratorProcessor plugin;
+        chainTwoSections (plugin);
+        setParameter (plugin, "songMode", 1.0f);
+        auto played = renderProcessor (plugin, 2 * samplesPerBar);
+
+        MidiPatternExporter::PatternParams params;
+        params.arrangement = plugin.getArrangement();
+        params.numBars = 2;
+        auto file = MidiPatternExporter::generatePattern (params);
+        auto exported = noteOns (file);
+
+        std::vector<std::pair<int, int>> playedNotes, exportedNotes;
+        for (auto* event : played)
+            if (event->message.isNoteOn())
+                playedNotes.emplace_back (juce::roundToInt (event->message.getTimeStamp() / 25.0), event->message.getNoteNumber());
+        for (auto* message : exported)
+            exportedNotes.emplace_back (juce::roundToInt (message->getTimeStamp()), message->getNoteNumber());
+
+        CHECK (playedNotes.size() == 20);
+        CHECK (playedNotes == exportedNotes);
+    }
+
+    SECTION ("turning song mode off recompiles the whole pattern from the parameters")
+    {
+        BasslineGeneratorProcessor plugin;
+        chainTwoSections (plugin);
+        setParameter (plugin, "songMode", 1.0f);
+
+        ProcessorPlayer player (plugin, 48000.0, 500);
+        player.playTo (2 * samplesPerBar - 3000);
+        setParameter (plugin, "songMode", 0.0f);
+        player.playTo (3 * samplesPerBar);
+
+        // Against the same parameters never having been in song mode
+        BasslineGeneratorProcessor reference;
+        chainTwoSections (reference);
+        auto expected = renderProcessor (reference, 3 * samplesPerBar, 48000.0, 500);
+
+        auto thirdBar = [&] (const juce::MidiMessageSequence& sent)
+        {
+            std::vector<std::pair<int, int>> notes;
+            for (auto* event : sent)
+                if (event->message.isNoteOn() && event->message.getTimeStamp() >= 2 * samplesPerBar)
+                    notes.emplace_back (juce::roundToInt (event->message.getTimeStamp()), event->message.getNoteNumber());
+            return notes;
+        };
+
+        CHECK (stepsPlayed (player.sent, 2.0 * samplesPerBar, samplesPerBar, 16) == everyStep (2));
+        CHECK (thirdBar (player.sent) == thirdBar (expected));
+    }
+}
@@ -0,0 +1,106 @@
+#include "utils/BlockStats.h"
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    // The raw rows of the CSV, split into columns
+    std::vector<juce::StringArray> csvRows (const juce::String& csv)
+    {
+        auto lines = juce::StringArray::fromLines (csv);
+        auto header = lines.indexOf ("block,block_us,block_load,events,step_latency_us");
+
+        std::vector<juce::StringArray> rows;
+        for (int i = header + 1; header >= 0 && i < lines.size(); ++i)
+            if (lines[i].isNotEmpty())
+                rows.push_back (juce::StringArray::fromTokens (lines[i], ",", ""));
+        return rows;
+    }
+}
+
+TEST_CASE ("Block stats", "[stats]")
+{
+    SECTION ("the window keeps the newest records, oldest first, their fields together")
+    {
+        RollingRecords<2, 8> window;
+        for (int i = 0; i < 12; ++i)
+            window.push ({ static_cast<float> (i), 10.0f * static_cast<float> (i) });
+
+        auto records = window.snapshot();
+        REQUIRE (records.size() == 8);
+        for (size_t i = 0; i < records.size(); ++i)
+        {
+            CHECK (records[i][0] == static_cast<float> (i + 4));
+            CHECK (records[i][1] == 10.0f * records[i][0]);
+        }
+
+        window.clear();
+        CHECK (window.snapshot().empty());
+    }
+
+    SECTION ("a field's summary covers the window")
+    {
+        RollingRecords<1, 200> window;
+        for (int i = 1; i <= 100; ++i)
+            window.push ({ static_cast<float> (i) });
+
+        auto summary = window.summarise (0);
+        CHECK (summary.count == 100);
+        CHECK (summary.min == 1.0f);
+        CHECK (summary.max == 100.0f);
+        CHECK (summary.mean == 50.5f);
+        CHECK (summary.p99 == 100.0f);
+
+        CHECK (StatSummary::of ({}).count == 0);
+    }
+
+    SECTION ("an empty block leaves no record, so every CSV row is one block")
+    {
+        if (!BlockStats::enabled)
+            return;
+
+        BlockStats stats;
+        stats.prepare (48000.0);
+        for (int block = 0; block < 10; ++block)
+        {
+            stats.beginBlock();
+            stats.endBlock (block % 3 == 0 ? 0 : 512, block);
+        }
+
+        auto rows = csvRows (stats.toCsv());
+        REQUIRE (rows.size() == 6);
+        const std::vector<int> events { 1, 2, 4, 5, 7, 8 };
+        for (size_t i = 0; i < rows.size(); ++i)
+        {
+            INFO ("row " << i);
+            REQUIRE (rows[i].size() == 5);
+            CHECK (rows[i][0].getIntValue() == static_cast<int> (i));
+            CHECK (rows[i][3].getIntValue() == events[i]);
+            CHECK (rows[i][2].getFloatValue() >= 0.0f);
+        }
+
+        for (auto field : { BlockStats::blockMicros, BlockStats::blockLoad, BlockStats::eventsPerBlock, BlockStats::stepLatencyMicros })
+            CHECK (stats.summarise (field).count == 6);
+        CHECK (stats.summarise (BlockStats::eventsPerBlock).max == 8.0f);
+    }
+
+    SECTION ("a reset starts a fresh window at the next block")
+    {
+        if (!BlockStats::enabled)
+            return;
+
+        BlockStats stats;
+        stats.prepare (48000.0);
+        for (int block = 0; block < 4; ++block)
+        {
+            stats.beginBlock();
+            stats.endBlock (512, 1);
+        }
+
+        stats.reset();
+        stats.beginBlock();
+        stats.endBlock (512, 3);
+
+        CHECK (csvRows (stats.toCsv()).size() == 1);
+        CHECK (stats.summarise (BlockStats::eventsPerBlock).mean == 3.0f);
+    }
+}
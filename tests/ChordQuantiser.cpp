@@ -0,0 +1,80 @@
+#include "generator/ChordQuantiser.h"
+#include <catch2/catch_test_macros.hpp>
+#include <initializer_list>
+
+namespace
+{
+    uint16_t maskOf (std::initializer_list<int> notes)
+    {
+        uint16_t mask = 0;
+        for (auto note : notes)
+            mask |= static_cast<uint16_t> (1u << (note % 12));
+        return mask;
+    }
+}
+
+TEST_CASE ("Chord quantiser", "[follow]")
+{
+    const auto cMajor = maskOf ({ 60, 64, 67 });
+
+    SECTION ("chord tones stay put in every octave")
+    {
+        for (int octave = 0; octave < 10; ++octave)
+            for (auto pitchClass : { 0, 4, 7 })
+                CHECK (ChordQuantiser::quantise (octave * 12 + pitchClass, cMajor) == octave * 12 + pitchClass);
+    }
+
+    SECTION ("a major triad takes the nearest tone, the lower one on a tie")
+    {
+        CHECK (ChordQuantiser::quantise (61, cMajor) == 60);
+        CHECK (ChordQuantiser::quantise (62, cMajor) == 60); // C and E are both a tone away
+        CHECK (ChordQuantiser::quantise (65, cMajor) == 64);
+        CHECK (ChordQuantiser::quantise (66, cMajor) == 67);
+        CHECK (ChordQuantiser::quantise (69, cMajor) == 67);
+        CHECK (ChordQuantiser::quantise (70, cMajor) == 72); // Up to the next octave's root
+        CHECK (ChordQuantiser::quantise (71, cMajor) == 72);
+    }
+
+    SECTION ("a minor triad")
+    {
+        const auto aMinor = maskOf ({ 57, 60, 64 });
+        CHECK (ChordQuantiser::quantise (58, aMinor) == 57);
+        CHECK (ChordQuantiser::quantise (61, aMinor) == 60);
+        CHECK (ChordQuantiser::quantise (63, aMinor) == 64);
+        CHECK (ChordQuantiser::quantise (67, aMinor) == 69);
+    }
+
+    SECTION ("seventh chords")
+    {
+        const auto g7 = maskOf ({ 55, 59, 62, 65 });
+        CHECK (ChordQuantiser::quantise (60, g7) == 59);
+        CHECK (ChordQuantiser::quantise (64, g7) == 65);
+        CHECK (ChordQuantiser::quantise (65, g7) == 65);
+
+        const auto cMajor7 = maskOf ({ 60, 64, 67, 71 });
+        CHECK (ChordQuantiser::quantise (70, cMajor7) == 71);
+        CHECK (ChordQuantiser::quantise (69, cMajor7) == 67);
+    }
+
+    SECTION ("inversions and doublings share the root position's row")
+    {
+        CHECK (&ChordQuantiser::rowFor (maskOf ({ 52, 55, 60 })) == &ChordQuantiser::rowFor (cMajor));
+        CHECK (&ChordQuantiser::rowFor (maskOf ({ 43, 48, 52, 60, 67 })) == &ChordQuantiser::rowFor (cMajor));
+        CHECK (&ChordQuantiser::rowFor (static_cast<uint16_t> (cMajor | 0xf000u)) == &ChordQuantiser::rowFor (cMajor));
+    }
+
+    SECTION ("no chord leaves every note alone")
+    {
+        for (int note = 0; note < 128; ++note)
+            CHECK (ChordQuantiser::quantise (note, uint16_t { 0 }) == note);
+    }
+
+    SECTION ("the transpose to a bass note is the nearest way round")
+    {
+        CHECK (ChordQuantiser::nearestTranspose (48, 53) == 5);
+        CHECK (ChordQuantiser::nearestTranspose (48, 55) == -5);
+        CHECK (ChordQuantiser::nearestTranspose (48, 54) == -6);
+        CHECK (ChordQuantiser::nearestTranspose (48, 36) == 0);
+        CHECK (ChordQuantiser::nearestTranspose (50, 48) == -2);
+    }
+}
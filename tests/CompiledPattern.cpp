@@ -0,0 +1,91 @@
+#include "generator/CompiledPattern.h"
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+
+TEST_CASE ("Compiled pattern", "[pattern]")
+{
+    SECTION ("a ratchet humanized late still ends inside its step")
+    {
+        CompiledPattern pattern;
+        pattern.steps = 16;
+        pattern.swing = 0.75f;
+        pattern.microTiming = 0.5f;
+        pattern.humanizeTiming = 0.2f;
+        pattern.ratchetChance = 1.0f;
+        pattern.ratchetCount = CompiledPattern::maxRatchets;
+        pattern.compileAll();
+
+        for (int step = 0; step < pattern.steps; ++step)
+        {
+            const auto& burst = pattern.bursts[static_cast<size_t> (step)];
+            REQUIRE (burst.count > 1);
+            CHECK (burst.offsets[0] - pattern.humanizeTiming >= -1.0e-5f);
+            CHECK (burst.offsets[static_cast<size_t> (burst.count - 1)] + burst.length + pattern.humanizeTiming <= 1.0f + 1.0e-5f);
+        }
+    }
+
+    SECTION ("a ratchet's notes are evenly spaced through the rest of its step")
+    {
+        CompiledPattern pattern;
+        pattern.steps = 16;
+        pattern.microTiming = 0.3f;
+        pattern.ratchetChance = 0.5f;
+        pattern.compileAll();
+
+        int ratchets = 0;
+        for (int step = 0; step < pattern.steps; ++step)
+        {
+            const auto& burst = pattern.bursts[static_cast<size_t> (step)];
+            CHECK (burst.offsets[0] >= 0.0f);
+            CHECK (burst.offsets[0] <= 0.875f);
+
+            if (burst.count == 1)
+            {
+                CHECK (burst.length == 1.0f);
+                continue;
+            }
+
+            ++ratchets;
+            for (int note = 1; note < burst.count; ++note)
+                CHECK (std::abs (burst.offsets[static_cast<size_t> (note)] - burst.offsets[static_cast<size_t> (note - 1)] - burst.length) < 1.0e-5f);
+            CHECK (std::abs (burst.offsets[static_cast<size_t> (burst.count - 1)] + burst.length - 1.0f) < 1.0e-5f);
+        }
+        CHECK (ratchets > 0);
+    }
+
+    SECTION ("the roll ramp fades a ratchet in, or out")
+    {
+        CompiledPattern pattern;
+        pattern.steps = 16;
+        pattern.grooveAmount = 0.0f; // Every step at full gain
+        pattern.ratchetChance = 1.0f;
+
+        for (float ramp : { 1.0f, -1.0f, 0.0f })
+        {
+            pattern.rollRamp = ramp;
+            pattern.compileAll();
+
+            const auto& burst = pattern.bursts[0];
+            REQUIRE (burst.count > 1);
+            auto first = burst.gains[0];
+            auto last = burst.gains[static_cast<size_t> (burst.count - 1)];
+            INFO ("ramp " << ramp);
+            CHECK (first == (ramp > 0.0f ? 0.0f : 1.0f));
+            CHECK (last == (ramp < 0.0f ? 0.0f : 1.0f));
+        }
+    }
+
+    SECTION ("micro-timing is seeded per step, so ratchets come and go without moving it")
+    {
+        CompiledPattern pattern;
+        pattern.steps = 16;
+        pattern.microTiming = 0.4f;
+        pattern.compileAll();
+        auto unratcheted = pattern.bursts;
+
+        pattern.ratchetChance = 1.0f;
+        pattern.compileBursts();
+        for (size_t step = 0; step < 16; ++step)
+            CHECK (pattern.bursts[step].offsets[0] == unratcheted[step].offsets[0]);
+    }
+}
@@ -0,0 +1,90 @@
+#include "helpers/test_helpers.h"
+#include "generator/ControlLanes.h"
+#include "utils/MidiPatternExporter.h"
+#include <catch2/catch_test_macros.hpp>
+#include <set>
+
+TEST_CASE ("Control lanes", "[lanes]")
+{
+    SECTION ("a curve is thinned to the points that moved")
+    {
+        CurveLane lane;
+        lane.setResolution (10, 15);
+        CHECK (lane.start (0.0f, 100.0f, 100, false) == 0);
+
+        std::vector<int> sent;
+        while (lane.untilNext != CurveLane::idle)
+        {
+            lane.untilNext = 0;
+            if (auto value = lane.next(); value >= 0)
+                sent.push_back (value);
+        }
+
+        CHECK (sent == std::vector<int> { 20, 40, 60, 80, 100 });
+    }
+
+    SECTION ("exported slides bend in from the note before and end centred")
+    {
+        MidiPatternExporter::PatternParams params;
+        params.steps = 16;
+        params.hits = 16;
+        params.numBars = 2;
+        params.glideChance = 1.0f;
+        params.controlLanes.bendRange = 12;
+
+        auto file = MidiPatternExporter::generatePattern (params);
+        auto bends = trackMessages (file, [] (const juce::MidiMessage& m) { return m.isPitchWheel(); });
+        REQUIRE_FALSE (bends.empty());
+        CHECK (bends.back()->getPitchWheelValue() == ControlLanes::bendCentre);
+
+        // At most a point per 5 ms (80 ticks at 120 bpm) plus a start per note
+        auto notes = noteOns (file);
+        CHECK (bends.size() <= notes.size() + static_cast<size_t> (2 * 3840 / 80));
+    }
+
+    SECTION ("a slide holds the note before until it starts, exported and played")
+    {
+        MidiPatternExporter::PatternParams params;
+        params.steps = 16;
+        params.hits = 16;
+        params.numBars = 2;
+        params.glideChance = 1.0f;
+        params.controlLanes.glide = ControlLanes::Glide::portamento;
+
+        auto file = MidiPatternExporter::generatePattern (params);
+        auto [exportedLegato, exportedChanges] = countLegatoNotes (*file.getTrack (0));
+        REQUIRE (exportedChanges > 0);
+        CHECK (exportedLegato == exportedChanges);
+
+        BasslineGeneratorProcessor plugin;
+        setParameter (plugin, "steps", 16.0f);
+        setParameter (plugin, "hits", 16.0f);
+        setParameter (plugin, "glide", 1.0f);
+        setParameter (plugin, "glideMode", 1.0f);
+
+        // Two bars at 120 bpm
+        auto played = renderProcessor (plugin, 192000);
+        auto [playedLegato, playedChanges] = countLegatoNotes (played);
+        REQUIRE (playedChanges > 0);
+        CHECK (playedLegato == playedChanges);
+    }
+
+    SECTION ("every exported note restarts the envelope")
+    {
+        MidiPatternExporter::PatternParams params;
+        params.steps = 16;
+        params.hits = 4;
+        params.controlLanes.envelopeCc = 74;
+
+        auto file = MidiPatternExporter::generatePattern (params);
+        std::set<double> envelopeStarts;
+        for (auto* message : trackMessages (file, [] (const juce::MidiMessage& m) { return m.isController(); }))
+            if (message->getControllerNumber() == 74)
+                envelopeStarts.insert (message->getTimeStamp());
+
+        auto notes = noteOns (file);
+        REQUIRE (notes.size() == 4);
+        for (auto* note : notes)
+            CHECK (envelopeStarts.count (note->getTimeStamp()) == 1);
+    }
+}
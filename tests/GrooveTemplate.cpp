@@ -0,0 +1,77 @@
+#include "helpers/test_helpers.h"
+#include "generator/GrooveTemplate.h"
+#include "utils/MidiPatternExporter.h"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+namespace
+{
+    // One bar of sixteenths at 960 ticks per quarter: odd ones a quarter of a sixteenth late
+    // and softer
+    juce::MidiFile makeSwungHats()
+    {
+        juce::MidiMessageSequence hats;
+        for (int slot = 0; slot < 16; ++slot)
+        {
+            bool odd = slot % 2 == 1;
+            double tick = slot * 240.0 + (odd ? 60.0 : 0.0);
+            hats.addEvent (juce::MidiMessage::noteOn (10, 42, (juce::uint8) (odd ? 60 : 120)), tick);
+            hats.addEvent (juce::MidiMessage::noteOff (10, 42), tick + 100.0);
+        }
+
+        juce::MidiFile file;
+        file.setTicksPerQuarterNote (960);
+        file.addTrack (hats);
+        return file;
+    }
+}
+
+TEST_CASE ("Groove template", "[groove]")
+{
+    auto groove = GrooveTemplate::fromMidiFile (makeSwungHats());
+    REQUIRE (groove != nullptr);
+
+    SECTION ("timing and velocity are read per sixteenth")
+    {
+        CHECK_THAT (groove->offsets[0], Catch::Matchers::WithinAbs (0.0, 1.0e-6));
+        CHECK_THAT (groove->offsets[1], Catch::Matchers::WithinAbs (0.25, 1.0e-6));
+        CHECK_THAT (groove->velocities[0], Catch::Matchers::WithinAbs (1.0 / 3.0, 1.0e-6));
+        CHECK_THAT (groove->velocities[1], Catch::Matchers::WithinAbs (-1.0 / 3.0, 1.0e-6));
+    }
+
+    SECTION ("exported notes follow the groove")
+    {
+        MidiPatternExporter::PatternParams params;
+        params.steps = 16;
+        params.hits = 16;
+        params.velocity = 90;
+        params.groove = groove;
+
+        auto file = MidiPatternExporter::generatePattern (params);
+        auto notes = noteOns (file);
+        REQUIRE (notes.size() == 16);
+        CHECK (notes[2]->getTimeStamp() == 480.0);
+        CHECK (notes[3]->getTimeStamp() == 780.0);
+        CHECK (notes[2]->getVelocity() == 120);
+        CHECK (notes[3]->getVelocity() == 60);
+    }
+
+    SECTION ("early notes move every step's start ahead")
+    {
+        auto early = std::make_shared<GrooveTemplate> (*groove);
+        early->offsets[4] = -0.25f;
+
+        MidiPatternExporter::PatternParams params;
+        params.steps = 16;
+        params.hits = 16;
+        params.numBars = 2;
+        params.groove = early;
+
+        auto file = MidiPatternExporter::generatePattern (params);
+        auto notes = noteOns (file);
+        REQUIRE (notes.size() == 32);
+        CHECK (notes[4]->getTimeStamp() == 900.0);
+        CHECK (notes[5]->getTimeStamp() == 1260.0);
+        CHECK (notes[16]->getTimeStamp() == 3840.0);
+    }
+}
@@ -0,0 +1,159 @@
+#include "generator/HarmonyTrack.h"
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+
+namespace
+{
+    HarmonyTrack::Region region (double start, double end, uint16_t chordMask, int bassNote)
+    {
+        HarmonyTrack::Region r;
+        r.startPpq = start;
+        r.endPpq = end;
+        r.chordMask = chordMask;
+        r.bassNote = bassNote;
+        return r;
+    }
+
+    // Two chords of chordQuarters each, as a MIDI file; a numerator of 0 leaves out the time signature
+    juce::MidiFile twoChords (int numerator, int denominator, double chordQuarters)
+    {
+        juce::MidiMessageSequence track;
+        if (numerator > 0)
+            track.addEvent (juce::MidiMessage::timeSignatureMetaEvent (numerator, denominator), 0.0);
+
+        for (auto note : { 48, 52, 55 })
+        {
+            track.addEvent (juce::MidiMessage::noteOn (1, note, 0.8f), 0.0);
+            track.addEvent (juce::MidiMessage::noteOff (1, note), chordQuarters * 960.0);
+        }
+        for (auto note : { 53, 57, 60 })
+        {
+            track.addEvent (juce::MidiMessage::noteOn (1, note, 0.8f), chordQuarters * 960.0);
+            track.addEvent (juce::MidiMessage::noteOff (1, note), 2.0 * chordQuarters * 960.0);
+        }
+        track.updateMatchedPairs();
+
+        juce::MidiFile file;
+        file.setTicksPerQuarterNote (960);
+        file.addTrack (track);
+        return file;
+    }
+}
+
+TEST_CASE ("Harmony track", "[harmony]")
+{
+    // C from beat 1, F from the second bar, G for the two bars after, looping after four bars
+    constexpr uint16_t c = (1u << 0) | (1u << 4) | (1u << 7);
+    constexpr uint16_t f = (1u << 5) | (1u << 9) | (1u << 0);
+    constexpr uint16_t g = (1u << 7) | (1u << 11) | (1u << 2);
+    HarmonyTrack track ({ region (1.0, 4.0, c, 48), region (4.0, 8.0, f, 53), region (8.0, 16.0, g, 55) }, 16.0);
+    const auto& regions = track.getRegions();
+
+    SECTION ("nothing sounds before the first region")
+    {
+        HarmonyTrack::Cursor cursor;
+        CHECK (cursor.find (track, 0.0) == nullptr);
+        CHECK (cursor.find (track, 0.999) == nullptr);
+        CHECK (cursor.find (track, 1.0) == &regions[0]);
+    }
+
+    SECTION ("a region starts on its start and ends before its end")
+    {
+        HarmonyTrack::Cursor cursor;
+        CHECK (cursor.find (track, 3.999) == &regions[0]);
+        CHECK (cursor.find (track, 4.0) == &regions[1]);
+        CHECK (cursor.find (track, 7.999) == &regions[1]);
+        CHECK (cursor.find (track, 8.0) == &regions[2]);
+        CHECK (cursor.find (track, 15.999) == &regions[2]);
+    }
+
+    SECTION ("positions past the loop wrap to its start")
+    {
+        HarmonyTrack::Cursor cursor;
+        CHECK (cursor.find (track, 14.0) == &regions[2]);
+        CHECK (cursor.find (track, 16.0) == nullptr); // Before the first region again
+        CHECK (cursor.find (track, 17.0) == &regions[0]);
+        CHECK (cursor.find (track, 16.0 * 3 + 5.0) == &regions[1]);
+        CHECK (cursor.find (track, -1.0) == &regions[2]);
+    }
+
+    SECTION ("a seek backwards finds the earlier region")
+    {
+        HarmonyTrack::Cursor cursor;
+        CHECK (cursor.find (track, 10.0) == &regions[2]);
+        CHECK (cursor.find (track, 2.0) == &regions[0]);
+        CHECK (cursor.find (track, 5.0) == &regions[1]);
+    }
+
+    SECTION ("the cursor agrees with a lookup from scratch, playing on or seeking")
+    {
+        std::vector<double> positions;
+        for (double ppq = 0.0; ppq < 40.0; ppq += 0.25)
+            positions.push_back (ppq);
+        std::mt19937 random (3);
+        std::uniform_real_distribution<double> anywhere (-20.0, 60.0);
+        for (int i = 0; i < 500; ++i)
+            positions.push_back (anywhere (random));
+
+        HarmonyTrack::Cursor cursor;
+        for (auto ppq : positions)
+        {
+            INFO ("ppq " << ppq);
+            REQUIRE (cursor.find (track, ppq) == track.find (ppq));
+        }
+    }
+
+    SECTION ("a new track restarts the cursor")
+    {
+        HarmonyTrack other ({ region (0.0, 2.0, g, 55), region (2.0, 4.0, c, 48) }, 4.0);
+        HarmonyTrack::Cursor cursor;
+        CHECK (cursor.find (track, 12.0) == &regions[2]);
+        CHECK (cursor.find (other, 3.0) == &other.getRegions()[1]);
+    }
+
+    SECTION ("a region moves a note to its chord, in the root's register")
+    {
+        CHECK (regions[1].apply (48, 48) == 53);
+        CHECK (regions[2].apply (48, 48) == 43);
+    }
+}
+
+TEST_CASE ("Harmony track from a MIDI file", "[harmony]")
+{
+    SECTION ("the loop ends on the bar line after the last chord, in the file's time signature")
+    {
+        auto fourFour = HarmonyTrack::fromMidiFile (twoChords (0, 0, 2.5));
+        REQUIRE (fourFour != nullptr);
+        CHECK (fourFour->getLengthPpq() == 8.0);
+
+        auto threeFour = HarmonyTrack::fromMidiFile (twoChords (3, 4, 2.5));
+        REQUIRE (threeFour != nullptr);
+        CHECK (threeFour->getLengthPpq() == 6.0);
+
+        auto sixEight = HarmonyTrack::fromMidiFile (twoChords (6, 8, 3.0));
+        REQUIRE (sixEight != nullptr);
+        CHECK (sixEight->getLengthPpq() == 6.0);
+    }
+
+    SECTION ("each chord rings until the next, and the first starts the track")
+    {
+        auto track = HarmonyTrack::fromMidiFile (twoChords (3, 4, 3.0));
+        REQUIRE (track != nullptr);
+        const auto& regions = track->getRegions();
+        REQUIRE (regions.size() == 2);
+        CHECK (regions[0].startPpq == 0.0);
+        CHECK (regions[0].endPpq == 3.0);
+        CHECK (regions[0].bassNote == 48);
+        CHECK (regions[1].startPpq == 3.0);
+        CHECK (regions[1].endPpq == 6.0);
+        CHECK (regions[1].bassNote == 53);
+    }
+
+    SECTION ("a file without notes has no track")
+    {
+        juce::MidiFile file;
+        file.setTicksPerQuarterNote (960);
+        file.addTrack (juce::MidiMessageSequence());
+        CHECK (HarmonyTrack::fromMidiFile (file) == nullptr);
+    }
+}
@@ -0,0 +1,83 @@
+#include "generator/HeldNotes.h"
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE ("Held notes", "[follow]")
+{
+    HeldNotes held;
+
+    SECTION ("notes either side of the 64-bit word boundary are held and released apart")
+    {
+        held.noteOn (63);
+        held.noteOn (64);
+        CHECK (held.isHeld (63));
+        CHECK (held.isHeld (64));
+        CHECK (held.getNumHeld() == 2);
+        CHECK (held.lowestHeld() == 63);
+
+        held.noteOff (63);
+        CHECK_FALSE (held.isHeld (63));
+        CHECK (held.isHeld (64));
+        CHECK (held.lowestHeld() == 64);
+
+        held.noteOff (64);
+        CHECK (held.getNumHeld() == 0);
+        CHECK (held.lowestHeld() == -1);
+    }
+
+    SECTION ("the lowest and highest notes fit, and notes outside the range are ignored")
+    {
+        held.noteOn (0);
+        held.noteOn (127);
+        held.noteOn (-1);
+        held.noteOn (128);
+        CHECK (held.getNumHeld() == 2);
+        CHECK (held.lowestHeld() == 0);
+
+        held.noteOff (0);
+        CHECK (held.lowestHeld() == 127);
+    }
+
+    SECTION ("a repeated note on or a stray note off doesn't change the count")
+    {
+        held.noteOn (60);
+        held.noteOn (60);
+        held.noteOff (61);
+        CHECK (held.getNumHeld() == 1);
+        held.noteOff (60);
+        held.noteOff (60);
+        CHECK (held.getNumHeld() == 0);
+    }
+
+    SECTION ("the chord stays latched after the keys are lifted, until the next one starts")
+    {
+        CHECK (held.getChordMask() == 0);
+        CHECK (held.getBassNote() == -1);
+
+        // C major in first inversion, the C pressed last
+        for (auto note : { 64, 67, 72, 60 })
+            held.noteOn (note);
+        constexpr uint16_t cMajor = (1u << 0) | (1u << 4) | (1u << 7);
+        CHECK (held.getChordMask() == cMajor);
+        CHECK (held.getBassNote() == 60);
+
+        for (auto note : { 64, 67, 72, 60 })
+            held.noteOff (note);
+        CHECK (held.getChordMask() == cMajor);
+        CHECK (held.getBassNote() == 60);
+
+        held.noteOn (65);
+        CHECK (held.getChordMask() == (1u << 5));
+        CHECK (held.getBassNote() == 65);
+    }
+
+    SECTION ("clearing forgets the held keys and the latched chord")
+    {
+        held.noteOn (40);
+        held.noteOn (100);
+        held.clear();
+        CHECK (held.getNumHeld() == 0);
+        CHECK (held.lowestHeld() == -1);
+        CHECK (held.getChordMask() == 0);
+        CHECK (held.getBassNote() == -1);
+    }
+}
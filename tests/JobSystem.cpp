@@ -0,0 +1,116 @@
+#include "utils/JobSystem.h"
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <vector>
+
+namespace
+{
+    // Polls until the condition holds or a generous timeout runs out
+    template <typename Condition>
+    bool waitFor (Condition condition, int timeoutMs = 5000)
+    {
+        auto end = juce::Time::getMillisecondCounter() + static_cast<juce::uint32> (timeoutMs);
+        while (!condition())
+        {
+            if (juce::Time::getMillisecondCounter() > end)
+                return false;
+            juce::Thread::sleep (1);
+        }
+        return true;
+    }
+
+    std::shared_ptr<JobPool::Task> makeTask (JobPool::Priority priority, std::function<void()> run)
+    {
+        auto task = std::make_shared<JobPool::Task>();
+        task->priority = priority;
+        task->run = std::move (run);
+        task->finished = [] {};
+        return task;
+    }
+}
+
+TEST_CASE ("Job system", "[jobs]")
+{
+    SECTION ("a job submitted under the same key cancels the one before")
+    {
+        JobPool pool;
+        JobSystem jobs (pool);
+
+        std::atomic<bool> firstStarted { false }, firstCancelled { false }, otherCancelled { false };
+        auto runUntilCancelled = [] (std::atomic<bool>* started, std::atomic<bool>* cancelled)
+        {
+            return [started, cancelled] (const CancellationToken& token)
+            {
+                if (started != nullptr)
+                    started->store (true);
+                waitFor ([&] { return token.isCancelled(); }, 500);
+                cancelled->store (token.isCancelled());
+                return 0;
+            };
+        };
+
+        jobs.submit<int> (JobSystem::Priority::interactive, "export", runUntilCancelled (&firstStarted, &firstCancelled), [] (int) {});
+        auto other = jobs.submit<int> (JobSystem::Priority::interactive, "other", runUntilCancelled (nullptr, &otherCancelled), [] (int) {});
+        REQUIRE (waitFor ([&] { return firstStarted.load(); }));
+
+        auto second = jobs.submit<int> (JobSystem::Priority::interactive, "export", [] (const CancellationToken&) { return 0; }, [] (int) {});
+        CHECK (waitFor ([&] { return firstCancelled.load(); }));
+        CHECK_FALSE (second.isCancelled());
+        CHECK_FALSE (other.isCancelled());
+        other.cancel();
+    }
+
+    SECTION ("interactive jobs run ahead of bulk jobs queued before them")
+    {
+        JobPool pool;
+
+        // Hold every worker, then release just one so it takes the queue in order
+        std::atomic<int> blocked { 0 };
+        std::vector<std::unique_ptr<std::atomic<bool>>> release;
+        for (int i = 0; i < pool.getNumThreads(); ++i)
+        {
+            release.push_back (std::make_unique<std::atomic<bool>> (false));
+            pool.enqueue (makeTask (JobPool::Priority::interactive, [&blocked, flag = release.back().get()]
+            {
+                ++blocked;
+                waitFor ([flag] { return flag->load(); });
+            }));
+        }
+        REQUIRE (waitFor ([&] { return blocked.load() == pool.getNumThreads(); }));
+
+        std::mutex orderLock;
+        std::vector<int> order;
+        auto record = [&] (int job) { return [&, job] { const std::lock_guard<std::mutex> lock (orderLock); order.push_back (job); }; };
+        pool.enqueue (makeTask (JobPool::Priority::bulk, record (1)));
+        pool.enqueue (makeTask (JobPool::Priority::interactive, record (2)));
+
+        release.front()->store (true);
+        REQUIRE (waitFor ([&] { const std::lock_guard<std::mutex> lock (orderLock); return order.size() == 2; }));
+        CHECK (order == std::vector<int> { 2, 1 });
+
+        for (auto& flag : release)
+            flag->store (true);
+    }
+
+    SECTION ("destroying a job system waits for its running jobs")
+    {
+        JobPool pool;
+        auto jobs = std::make_unique<JobSystem> (pool);
+
+        std::atomic<bool> started { false }, finished { false }, sawCancel { false };
+        jobs->submit<int> (JobSystem::Priority::interactive, {}, [&] (const CancellationToken& token)
+        {
+            started = true;
+            waitFor ([&] { return token.isCancelled(); }, 500);
+            sawCancel = token.isCancelled();
+            juce::Thread::sleep (20);
+            finished = true;
+            return 0;
+        }, [] (int) {});
+
+        REQUIRE (waitFor ([&] { return started.load(); }));
+        jobs.reset();
+        CHECK (finished.load());
+        CHECK (sawCancel.load());
+    }
+}
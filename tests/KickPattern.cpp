@@ -0,0 +1,92 @@
+#include "helpers/test_helpers.h"
+#include "generator/KickPattern.h"
+#include "generator/DrumFit.h"
+#include "utils/MidiPatternExporter.h"
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    // Two bars at 960 ticks per quarter: four on the floor, then a kick on 1 and the "and" of 3,
+    // with hats on every eighth that aren't kicks
+    juce::MidiFile makeDrums()
+    {
+        juce::MidiMessageSequence drums;
+        for (double tick : { 0.0, 960.0, 1920.0, 2880.0, 3840.0, 6240.0 })
+        {
+            drums.addEvent (juce::MidiMessage::noteOn (10, 36, (juce::uint8) 110), tick);
+            drums.addEvent (juce::MidiMessage::noteOff (10, 36), tick + 100.0);
+        }
+        for (int eighth = 0; eighth < 16; ++eighth)
+        {
+            drums.addEvent (juce::MidiMessage::noteOn (10, 42, (juce::uint8) 80), eighth * 480.0);
+            drums.addEvent (juce::MidiMessage::noteOff (10, 42), eighth * 480.0 + 100.0);
+        }
+
+        juce::MidiFile file;
+        file.setTicksPerQuarterNote (960);
+        file.addTrack (drums);
+        return file;
+    }
+}
+
+TEST_CASE ("Kick pattern", "[kick]")
+{
+    auto kick = KickPattern::fromMidiFile (makeDrums());
+    REQUIRE (kick != nullptr);
+
+    SECTION ("only the kick notes are read, a mask per bar")
+    {
+        CHECK (kick->numBars == 2);
+        CHECK (kick->bars[0] == 0x1111);
+        CHECK (kick->bars[1] == 0x0401);
+    }
+
+    SECTION ("each mode scores the kick its own way")
+    {
+        uint32_t fourOnTheFloor = 0x1111;
+        CHECK (DrumFit::bestMask (fourOnTheFloor, 16, 5, 0, DrumFit::Mode::lock) == 0x1111);
+        CHECK ((DrumFit::bestMask (fourOnTheFloor, 16, 5, 0, DrumFit::Mode::avoid) & fourOnTheFloor) == 0);
+        CHECK ((DrumFit::bestMask (fourOnTheFloor, 16, 5, 0, DrumFit::Mode::interlock) & fourOnTheFloor) == 0);
+        CHECK (DrumFit::bestMask (fourOnTheFloor, 16, 5, 3, DrumFit::Mode::off) == EuclideanRhythm::mask (16, 5, 3));
+    }
+
+    SECTION ("exported bars lock to the kick bar by bar")
+    {
+        MidiPatternExporter::PatternParams params;
+        params.steps = 16;
+        params.hits = 5;
+        params.numBars = 2;
+        params.kickMode = static_cast<int> (DrumFit::Mode::lock);
+        params.kick = kick;
+
+        auto file = MidiPatternExporter::generatePattern (params);
+        std::vector<double> times;
+        for (auto* note : noteOns (file))
+            times.push_back (note->getTimeStamp());
+        // The second bar needs a hit between its two kicks to stay Euclidean
+        CHECK (times == std::vector<double> { 0.0, 960.0, 1920.0, 2880.0, 3840.0, 5040.0, 6240.0 });
+    }
+
+    SECTION ("a live kick fits the whole of the next bar, however late the kick after it comes")
+    {
+        BasslineGeneratorProcessor plugin;
+        setParameter (plugin, "steps", 16.0f);
+        setParameter (plugin, "hits", 4.0f);
+        setParameter (plugin, "kickMode", static_cast<float> (DrumFit::Mode::lock));
+        setParameter (plugin, "kickChannel", 10.0f);
+
+        // At 120 bpm and 48 kHz a sixteenth is 6000 samples: the first bar's kicks are on the
+        // last sixteenth of each beat, then one comes in just before the third bar's downbeat.
+        // The block that has it also starts the second bar's last step.
+        juce::MidiMessageSequence kicks;
+        for (int sample : { 18000, 42000, 66000, 90000, 190000 })
+            kicks.addEvent (juce::MidiMessage::noteOn (10, 36, (juce::uint8) 110), sample);
+
+        std::vector<int> steps;
+        for (auto* event : renderProcessor (plugin, 192000, 48000.0, 5000, kicks))
+            if (event->message.isNoteOn() && event->message.getTimeStamp() >= 96000.0)
+                steps.push_back (juce::roundToInt (event->message.getTimeStamp() - 96000.0) / 6000);
+
+        CHECK (steps == std::vector<int> { 3, 7, 11, 15 });
+    }
+}
@@ -0,0 +1,108 @@
+#include "utils/MidiOutputScheduler.h"
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    // Time for the scheduler, moved by the test alone
+    struct ManualClock
+    {
+        std::atomic<double> nowMs { 0.0 };
+        double operator()() const { return nowMs.load(); }
+    };
+
+    // Stands in for a loopback MIDI port: records the clock's time as each message leaves
+    struct LoopbackSink : MidiOutputScheduler::Sink
+    {
+        LoopbackSink(const ManualClock& clockToRead, std::vector<double>& times) : clock(clockToRead), arrivals(times) {}
+
+        void send(const juce::MidiMessage&) override
+        {
+            arrivals.push_back(clock());
+            received.fetch_add(1);
+        }
+
+        const ManualClock& clock;
+        std::vector<double>& arrivals;
+        std::atomic<int> received { 0 };
+    };
+
+    // Moves the clock on a step at a time, each time waiting for whatever has come due to be
+    // sent. The deadline only stops a broken scheduler hanging the test.
+    void advanceTo(ManualClock& clock, const LoopbackSink& sink, const std::vector<double>& due, double endMs, double stepMs)
+    {
+        while (clock.nowMs.load() < endMs)
+        {
+            auto now = juce::jmin(clock.nowMs.load() + stepMs, endMs);
+            clock.nowMs.store(now);
+
+            auto expected = static_cast<int>(std::count_if(due.begin(), due.end(), [now](double time) { return time <= now; }));
+            auto deadline = juce::Time::getMillisecondCounter() + 2000;
+            while (sink.received.load() < expected && juce::Time::getMillisecondCounter() < deadline)
+                juce::Thread::sleep(1);
+        }
+    }
+}
+
+TEST_CASE ("MIDI output scheduler", "[midi-out]")
+{
+    constexpr int numEvents = 50;
+
+    ManualClock clock;
+    std::vector<double> arrivals;
+    arrivals.reserve (numEvents);
+
+    MidiOutputScheduler scheduler ([&clock] { return clock(); });
+    auto sink = std::make_unique<LoopbackSink> (clock, arrivals);
+    auto* loopback = sink.get();
+    scheduler.setSink (std::move (sink));
+
+    SECTION ("messages leave at their timestamps, never before")
+    {
+        // Sixteenths at 180 BPM, a little in the future like the audio thread does
+        std::vector<double> due;
+        for (int i = 0; i < numEvents; ++i)
+        {
+            due.push_back (20.0 + i * 5.0);
+            REQUIRE (scheduler.push (juce::MidiMessage::noteOn (1, 36, (juce::uint8) 100), due.back()));
+        }
+
+        // A step at a time up to each one, so a message sent early shows up early
+        advanceTo (clock, *loopback, due, due.back(), 0.25);
+        scheduler.setSink (nullptr); // Joins the thread before we read the results
+
+        CHECK (arrivals == due);
+    }
+
+    SECTION ("events keep their spacing within a block, a block late")
+    {
+        // One 1024-sample block at 48 kHz with notes 240 samples (5 ms) apart
+        juce::MidiBuffer block;
+        std::vector<double> due;
+        for (int sample = 0; sample < 1024; sample += 240)
+        {
+            block.addEvent (juce::MidiMessage::noteOn (1, 36, (juce::uint8) 100), sample);
+            due.push_back ((1024 + sample) * 1000.0 / 48000.0);
+        }
+
+        scheduler.scheduleBlock (block, clock(), 48000.0, 1024);
+
+        advanceTo (clock, *loopback, due, due.back(), 0.25);
+        scheduler.setSink (nullptr);
+
+        REQUIRE (arrivals.size() == due.size());
+        for (size_t i = 0; i < due.size(); ++i)
+        {
+            CHECK (arrivals[i] >= due[i]);
+            CHECK (arrivals[i] < due[i] + 0.25);
+        }
+    }
+
+    SECTION ("nothing is sent once the sink is gone")
+    {
+        REQUIRE (scheduler.push (juce::MidiMessage::noteOn (1, 36, (juce::uint8) 100), 10.0));
+        scheduler.setSink (nullptr);
+
+        CHECK_FALSE (scheduler.push (juce::MidiMessage::noteOn (1, 36, (juce::uint8) 100), 10.0));
+        CHECK (arrivals.empty());
+    }
+}
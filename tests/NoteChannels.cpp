@@ -0,0 +1,91 @@
+#include "helpers/test_helpers.h"
+#include "generator/NoteChannels.h"
+#include "utils/MidiPatternExporter.h"
+#include <catch2/catch_test_macros.hpp>
+#include <map>
+
+TEST_CASE ("Note channels", "[channels]")
+{
+    auto ignore = [] (const juce::MidiMessage&) {};
+
+    SECTION ("MPE hands out the member released longest ago")
+    {
+        NoteChannels channels;
+        channels.prepare ({ NoteChannels::Mode::mpe, 1, 3 });
+
+        int first = channels.noteOn (40, NoteChannels::Role::plain, 48, ignore);
+        int second = channels.noteOn (41, NoteChannels::Role::plain, 48, ignore); // Overlaps the first
+        CHECK (first == 2);
+        CHECK (second == 3);
+
+        channels.noteOff (first, 40);
+        channels.noteOff (second, 41);
+        CHECK (channels.noteOn (42, NoteChannels::Role::plain, 48, ignore) == 4);
+        CHECK (channels.noteOn (43, NoteChannels::Role::plain, 48, ignore) == 2);
+    }
+
+    SECTION ("round robin and roles stay on their block of channels")
+    {
+        NoteChannels channels;
+        channels.prepare ({ NoteChannels::Mode::roundRobin, 15, 4 });
+        CHECK (channels.noteOn (40, NoteChannels::Role::plain, 2, ignore) == 15);
+        CHECK (channels.noteOn (40, NoteChannels::Role::plain, 2, ignore) == 16);
+        CHECK (channels.noteOn (40, NoteChannels::Role::plain, 2, ignore) == 15);
+
+        channels.prepare ({ NoteChannels::Mode::byRole, 5, 1 });
+        CHECK (channels.noteOn (40, NoteChannels::Role::slide, 2, ignore) == 7);
+    }
+
+    SECTION ("an MPE export configures the zone and keeps each note on its channel")
+    {
+        MidiPatternExporter::PatternParams params;
+        params.steps = 16;
+        params.hits = 8;
+        params.noteChannels = { NoteChannels::Mode::mpe, 1, 15 };
+
+        auto file = MidiPatternExporter::generatePattern (params);
+        const auto& track = *file.getTrack (0);
+        REQUIRE (track.getNumEvents() > 0);
+
+        // The configuration message leads: RPN 6 on the master channel
+        const auto& first = track.getEventPointer (0)->message;
+        CHECK (first.isController());
+        CHECK (first.getChannel() == NoteChannels::masterChannel);
+
+        std::map<int, int> held; // Note by channel
+        int notes = 0;
+        for (auto* event : track)
+        {
+            const auto& message = event->message;
+            if (message.isNoteOn())
+            {
+                CHECK (message.getChannel() > NoteChannels::masterChannel);
+                held[message.getChannel()] = message.getNoteNumber();
+                ++notes;
+            }
+            else if (message.isNoteOff())
+            {
+                CHECK (held[message.getChannel()] == message.getNoteNumber());
+            }
+        }
+        CHECK (notes == 8);
+    }
+
+    SECTION ("accents go by the accent cycle, not by velocity")
+    {
+        // Loud enough that the boost clamps, with humanize wider than the boost
+        MidiPatternExporter::PatternParams params;
+        params.steps = 16;
+        params.hits = 16;
+        params.velocity = 120;
+        params.humanize = 30;
+        params.accentLength = 4;
+        params.noteChannels = { NoteChannels::Mode::byRole, 5, 1 };
+
+        auto file = MidiPatternExporter::generatePattern (params);
+        auto notes = noteOns (file);
+        REQUIRE (notes.size() == 16);
+        for (size_t step = 0; step < notes.size(); ++step)
+            CHECK (notes[step]->getChannel() == (step % 4 == 0 ? 6 : 5));
+    }
+}
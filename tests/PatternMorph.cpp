@@ -0,0 +1,76 @@
+#include "generator/PatternMorph.h"
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+
+TEST_CASE ("Pattern morph", "[morph]")
+{
+    CompiledPattern a;
+    a.steps = 16;
+    a.hits = 5;
+    a.seed = 1;
+    a.compileAll();
+
+    CompiledPattern b;
+    b.steps = 16;
+    b.hits = 11;
+    b.rotation = 3;
+    b.seed = 2;
+    b.scaleIndex = 3;
+    b.octaveRange = 2;
+    b.velocity = 60;
+    b.compileAll();
+
+    PatternMorph::Slots slots { PatternMorph::Slot::capture (a), PatternMorph::Slot::capture (b) };
+
+    SECTION ("moving step by step gives what a full recompute gives")
+    {
+        // A sweep each way, then jumps
+        std::vector<float> positions;
+        for (int i = 0; i <= PatternMorph::resolution; ++i)
+            positions.push_back (static_cast<float> (i) / PatternMorph::resolution);
+        for (int i = PatternMorph::resolution; i >= 0; i -= 3)
+            positions.push_back (static_cast<float> (i) / PatternMorph::resolution);
+        std::mt19937 random (7);
+        std::uniform_real_distribution<float> anywhere (0.0f, 1.0f);
+        for (int i = 0; i < 500; ++i)
+            positions.push_back (anywhere (random));
+
+        PatternMorph incremental;
+        for (auto position : positions)
+        {
+            incremental.update (slots, position);
+
+            PatternMorph full;
+            full.update (slots, position);
+
+            INFO ("position " << position);
+            REQUIRE (incremental.triggerMask == full.triggerMask);
+            REQUIRE (incremental.pitches == full.pitches);
+            REQUIRE (incremental.velocities == full.velocities);
+        }
+    }
+
+    SECTION ("the ends play the slots exactly")
+    {
+        PatternMorph morph;
+        morph.update (slots, 0.0f);
+        CHECK (morph.triggerMask == a.triggerMask);
+        CHECK (morph.pitches == a.pitches);
+        morph.update (slots, 1.0f);
+        CHECK (morph.triggerMask == b.triggerMask);
+        CHECK (morph.pitches == b.pitches);
+    }
+
+    SECTION ("slots only fit a pattern with their step count and cycles")
+    {
+        CHECK (slots.fit (a));
+
+        CompiledPattern other = a;
+        other.steps = 8;
+        CHECK_FALSE (slots.fit (other));
+
+        other = a;
+        other.pitchLength = 5;
+        CHECK_FALSE (slots.fit (other));
+    }
+}
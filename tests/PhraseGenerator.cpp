@@ -0,0 +1,86 @@
+#include "helpers/test_helpers.h"
+#include "generator/PhraseGenerator.h"
+#include "utils/MidiPatternExporter.h"
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+
+namespace
+{
+    CompiledPattern makeHumanized (int variationCycle)
+    {
+        CompiledPattern pattern;
+        pattern.steps = 16;
+        pattern.hits = 16;
+        pattern.humanize = 20;
+        pattern.humanizeTiming = 0.1f;
+        pattern.probability = 0.5f;
+        pattern.variationCycle = variationCycle;
+        pattern.compileAll();
+        return pattern;
+    }
+
+    std::vector<std::pair<double, int>> timesAndVelocities (const juce::MidiFile& file)
+    {
+        std::vector<std::pair<double, int>> found;
+        for (auto* note : noteOns (file))
+            found.emplace_back (note->getTimeStamp(), note->getVelocity());
+        return found;
+    }
+}
+
+TEST_CASE ("Phrase variation", "[phrase]")
+{
+    SECTION ("humanize and probability change from bar to bar")
+    {
+        auto pattern = makeHumanized (0);
+        PhraseGenerator phrase (pattern);
+
+        auto first = phrase.bar (1);
+        auto second = phrase.bar (2);
+        CHECK ((first.triggerMask != second.triggerMask || first.velocities != second.velocities));
+        CHECK (first.shifts != second.shifts);
+        CHECK (phrase.bar (1).shifts == first.shifts);
+    }
+
+    SECTION ("a variation cycle repeats the draws")
+    {
+        auto pattern = makeHumanized (2);
+        PhraseGenerator phrase (pattern);
+
+        auto first = phrase.bar (1);
+        auto third = phrase.bar (3);
+        CHECK (first.triggerMask == third.triggerMask);
+        CHECK (first.velocities == third.velocities);
+        CHECK (first.shifts == third.shifts);
+        CHECK (phrase.cycleBars() == 2);
+    }
+
+    SECTION ("an exported bar range matches the same bars of a longer export")
+    {
+        MidiPatternExporter::PatternParams params;
+        params.steps = 16;
+        params.hits = 16;
+        params.humanize = 20;
+        params.humanizeTiming = 0.1f;
+        params.probability = 0.5f;
+        params.numBars = 4;
+        auto whole = timesAndVelocities (MidiPatternExporter::generatePattern (params));
+
+        params.firstBar = 2;
+        params.numBars = 1;
+        auto part = timesAndVelocities (MidiPatternExporter::generatePattern (params));
+
+        std::vector<std::pair<double, int>> expected;
+        for (const auto& [time, velocity] : whole)
+            if (time >= 2 * 3840.0 - 120.0 && time < 3 * 3840.0 - 120.0)
+                expected.emplace_back (std::max (0.0, time - 2 * 3840.0), velocity); // Early notes start the file
+
+        REQUIRE_FALSE (part.empty());
+        REQUIRE (part.size() == expected.size());
+        for (size_t i = 0; i < part.size(); ++i)
+        {
+            CHECK (std::abs (part[i].first - expected[i].first) < 1.0e-6);
+            CHECK (part[i].second == expected[i].second);
+        }
+    }
+}
@@ -0,0 +1,107 @@
+#include "generator/PitchModel.h"
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    // How often each entry comes out, over draws spread evenly across the 32-bit range, so
+    // the frequencies are the alias table's own probabilities to within a draw per column
+    template <typename Sampler>
+    std::vector<double> frequencies (int numEntries, Sampler&& sample)
+    {
+        constexpr uint32_t numDraws = 1u << 18;
+        std::vector<double> counts (static_cast<size_t> (numEntries));
+        for (uint32_t draw = 0; draw < numDraws; ++draw)
+            counts[static_cast<size_t> (sample (draw << 14))] += 1.0 / numDraws;
+        return counts;
+    }
+
+    std::vector<double> normalised (std::vector<double> weights)
+    {
+        double total = 0.0;
+        for (auto w : weights)
+            total += w;
+        for (auto& w : weights)
+            w /= total;
+        return weights;
+    }
+
+    void checkMatches (const std::vector<double>& measured, const std::vector<double>& expected)
+    {
+        REQUIRE (measured.size() == expected.size());
+        for (size_t i = 0; i < measured.size(); ++i)
+        {
+            INFO ("entry " << i << ": " << measured[i] << " against " << expected[i]);
+            CHECK (std::abs (measured[i] - expected[i]) < 1.0e-4);
+        }
+    }
+}
+
+TEST_CASE ("Pitch model", "[pitch]")
+{
+    SECTION ("a spread between levels draws as its nearest level")
+    {
+        const auto& table = ScaleEngine::lookup (0, 36, 2);
+        for (auto type : { PitchModel::Type::weighted, PitchModel::Type::markov, PitchModel::Type::walk })
+        {
+            PitchModel between, nearest;
+            between.compile (type, table, 0.51f);
+            nearest.compile (type, table, 16.0f / PitchModel::spreadLevels);
+
+            for (uint32_t draw = 0; draw < 4096; ++draw)
+            {
+                auto random = draw * 1048573u;
+                REQUIRE (between.sample (-1, random) == nearest.sample (-1, random));
+                REQUIRE (between.sample (3, random) == nearest.sample (3, random));
+            }
+        }
+    }
+
+    SECTION ("draws come out at the stated weights, for every model")
+    {
+        // Minor pentatonic over two octaves: 0, 3, 5, 7, 10 semitones, then an octave up.
+        // At spread 0 the tonal weights are the root 4, the fifth 3, the minor third 2 and
+        // the rest 1; a repeat counts half, a step to the next degree double; a leap of n
+        // semitones in the walk weighs e^-n.
+        const auto& table = ScaleEngine::lookup (0, 36, 2);
+        const std::vector<int> semitones { 0, 3, 5, 7, 10, 12, 15, 17, 19, 22 };
+        const std::vector<double> tonal { 4, 2, 1, 3, 1, 4, 2, 1, 3, 1 };
+        const int numEntries = static_cast<int> (semitones.size());
+        REQUIRE (table.scaleSize * table.octaveRange == numEntries);
+
+        PitchModel uniform;
+        uniform.compile (PitchModel::Type::uniform, table, 0.0f);
+        checkMatches (frequencies (numEntries, [&] (uint32_t r) { return uniform.sample (-1, r); }),
+                      std::vector<double> (static_cast<size_t> (numEntries), 1.0 / numEntries));
+
+        PitchModel weighted;
+        weighted.compile (PitchModel::Type::weighted, table, 0.0f);
+        checkMatches (frequencies (numEntries, [&] (uint32_t r) { return weighted.sample (-1, r); }), normalised (tonal));
+        checkMatches (frequencies (numEntries, [&] (uint32_t r) { return weighted.sample (4, r); }), normalised (tonal));
+
+        PitchModel markov;
+        markov.compile (PitchModel::Type::markov, table, 0.0f);
+        checkMatches (frequencies (numEntries, [&] (uint32_t r) { return markov.sample (-1, r); }), normalised (tonal));
+
+        PitchModel walk;
+        walk.compile (PitchModel::Type::walk, table, 0.0f);
+
+        for (int from = 0; from < numEntries; ++from)
+        {
+            INFO ("previous entry " << from);
+
+            std::vector<double> markovRow, walkRow;
+            for (int to = 0; to < numEntries; ++to)
+            {
+                int degreeDistance = std::abs (to % 5 - from % 5);
+                double motion = to == from ? 0.5 : (degreeDistance == 1 ? 2.0 : 1.0);
+                markovRow.push_back (tonal[static_cast<size_t> (to)] * motion);
+                walkRow.push_back (std::exp (-std::abs (semitones[static_cast<size_t> (to)] - semitones[static_cast<size_t> (from)])));
+            }
+
+            checkMatches (frequencies (numEntries, [&] (uint32_t r) { return markov.sample (from, r); }), normalised (markovRow));
+            checkMatches (frequencies (numEntries, [&] (uint32_t r) { return walk.sample (from, r); }), normalised (walkRow));
+        }
+    }
+}
@@ -0,0 +1,276 @@
+#include "helpers/test_helpers.h"
+#include "utils/MidiPatternExporter.h"
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    // Each message as its sample and bytes, for comparing two renders exactly
+    std::vector<std::pair<int, juce::String>> describe (const juce::MidiMessageSequence& sequence)
+    {
+        std::vector<std::pair<int, juce::String>> described;
+        for (auto* event : sequence)
+        {
+            const auto& message = event->message;
+            described.emplace_back (juce::roundToInt (message.getTimeStamp()),
+                                    juce::String::toHexString (message.getRawData(), message.getRawDataSize()));
+        }
+        return described;
+    }
+}
+
+TEST_CASE ("Playback", "[playback]")
+{
+    SECTION ("an offline render sends what the per-sample walk sends")
+    {
+        juce::Random random (1234);
+        for (int trial = 0; trial < 8; ++trial)
+        {
+            auto tempo = 60.0f + 160.0f * random.nextFloat();
+            auto swing = 0.6f * random.nextFloat();
+            auto ratchetChance = random.nextFloat();
+            auto glide = 0.5f * random.nextFloat();
+            auto seed = static_cast<float> (random.nextInt (100));
+            INFO ("tempo " << tempo << ", swing " << swing << ", ratchets " << ratchetChance);
+
+            auto render = [&] (bool offline)
+            {
+                BasslineGeneratorProcessor plugin;
+                setParameter (plugin, "steps", 16.0f);
+                setParameter (plugin, "hits", 9.0f);
+                setParameter (plugin, "clockTempo", tempo);
+                setParameter (plugin, "swing", swing);
+                setParameter (plugin, "ratchetChance", ratchetChance);
+                setParameter (plugin, "glide", glide);
+                setParameter (plugin, "seed", seed);
+                setParameter (plugin, "envelopeCc", 74.0f);
+                plugin.setNonRealtime (offline);
+
+                // Two bars, in blocks that don't divide a step
+                auto samplesPerBar = 4.0 * 60.0 / tempo * 48000.0;
+                return describe (renderProcessor (plugin, static_cast<int> (2.0 * samplesPerBar), 48000.0, 441));
+            };
+
+            auto walked = render (false);
+            auto offline = render (true);
+            REQUIRE_FALSE (walked.empty());
+            CHECK (offline == walked);
+        }
+    }
+
+    SECTION ("playback matches the export, note for note")
+    {
+        MidiPatternExporter::PatternParams params;
+        params.steps = 16;
+        params.hits = 9;
+        params.swing = 0.3f;
+        params.ratchetChance = 0.4f;
+        params.humanize = 10;
+        params.humanizeTiming = 0.05f;
+        params.glideChance = 0.3f;
+        params.numBars = 2;
+        auto file = MidiPatternExporter::generatePattern (params);
+        auto exported = noteOns (file);
+
+        BasslineGeneratorProcessor plugin;
+        setParameter (plugin, "steps", 16.0f);
+        setParameter (plugin, "hits", 9.0f);
+        setParameter (plugin, "swing", 0.3f);
+        setParameter (plugin, "ratchetChance", 0.4f);
+        setParameter (plugin, "humanize", 10.0f);
+        setParameter (plugin, "humanizeTiming", 0.05f);
+        setParameter (plugin, "glide", 0.3f);
+        plugin.setNonRealtime (true);
+
+        // Two bars at 120 bpm; a tick is 25 samples at 48 kHz. The first step is left out, as
+        // the clock starting may shift it.
+        constexpr double samplesPerTick = 48000.0 / (960.0 * 2.0);
+        constexpr double firstStep = 48000.0 * 2.0 / 16.0;
+        auto sent = renderProcessor (plugin, 192000);
+
+        std::vector<const juce::MidiMessage*> played;
+        for (auto* event : sent)
+            if (event->message.isNoteOn() && event->message.getTimeStamp() >= firstStep)
+                played.push_back (&event->message);
+        std::erase_if (exported, [&] (auto* message) { return message->getTimeStamp() * samplesPerTick < firstStep; });
+
+        REQUIRE_FALSE (played.empty());
+        REQUIRE (played.size() == exported.size());
+        for (size_t i = 0; i < played.size(); ++i)
+        {
+            INFO ("note " << i);
+            CHECK (played[i]->getNoteNumber() == exported[i]->getNoteNumber());
+            CHECK (played[i]->getVelocity() == exported[i]->getVelocity());
+            CHECK (std::abs (played[i]->getTimeStamp() - exported[i]->getTimeStamp() * samplesPerTick) <= 3.0);
+        }
+    }
+
+    SECTION ("playback matches the export of a later bar, following a harmony track")
+    {
+        // A bar each of C, F, G and A minor, so every bar of the loop follows a different chord
+        juce::MidiMessageSequence chords;
+        const std::array<std::array<int, 3>, 4> progression { { { 48, 52, 55 }, { 53, 57, 60 }, { 55, 59, 62 }, { 57, 60, 64 } } };
+        for (int bar = 0; bar < 4; ++bar)
+        {
+            for (auto note : progression[static_cast<size_t> (bar)])
+            {
+                chords.addEvent (juce::MidiMessage::noteOn (1, note, 0.8f), bar * 3840.0);
+                chords.addEvent (juce::MidiMessage::noteOff (1, note), (bar + 1) * 3840.0 - 10.0);
+            }
+        }
+        chords.updateMatchedPairs();
+        juce::MidiFile chordFile;
+        chordFile.setTicksPerQuarterNote (960);
+        chordFile.addTrack (chords);
+
+        juce::TemporaryFile harmonyFile (".mid");
+        {
+            juce::FileOutputStream stream (harmonyFile.getFile());
+            REQUIRE (chordFile.writeTo (stream));
+        }
+
+        BasslineGeneratorProcessor plugin;
+        REQUIRE (plugin.loadHarmonyFile (harmonyFile.getFile()));
+        setParameter (plugin, "followMode", 3.0f); // Harmony track
+        setParameter (plugin, "steps", 16.0f);
+        setParameter (plugin, "hits", 9.0f);
+        setParameter (plugin, "humanize", 10.0f);
+        plugin.setNonRealtime (true);
+
+        MidiPatternExporter::PatternParams params;
+        params.steps = 16;
+        params.hits = 9;
+        params.humanize = 10;
+        params.harmony = plugin.getHarmonyTrack();
+        params.firstBar = 2;
+        params.numBars = 1;
+        auto file = MidiPatternExporter::generatePattern (params);
+        auto exported = noteOns (file);
+
+        // The third bar at 120 bpm: a bar is 96000 samples, a tick 25
+        constexpr double samplesPerTick = 48000.0 / (960.0 * 2.0);
+        constexpr double barStart = 2.0 * 96000.0;
+        auto sent = renderProcessor (plugin, static_cast<int> (barStart + 96000.0));
+
+        std::vector<const juce::MidiMessage*> played;
+        for (auto* event : sent)
+            if (event->message.isNoteOn() && event->message.getTimeStamp() >= barStart)
+                played.push_back (&event->message);
+
+        REQUIRE_FALSE (played.empty());
+        REQUIRE (played.size() == exported.size());
+        for (size_t i = 0; i < played.size(); ++i)
+        {
+            INFO ("note " << i);
+            CHECK (played[i]->getNoteNumber() == exported[i]->getNoteNumber());
+            CHECK (played[i]->getVelocity() == exported[i]->getVelocity());
+            CHECK (std::abs (played[i]->getTimeStamp() - barStart - exported[i]->getTimeStamp() * samplesPerTick) <= 3.0);
+        }
+    }
+
+    SECTION ("playback matches the export with the morph halfway between two slots")
+    {
+        BasslineGeneratorProcessor plugin;
+        setParameter (plugin, "steps", 16.0f);
+        setParameter (plugin, "hits", 5.0f);
+        setParameter (plugin, "seed", 1.0f);
+        plugin.storeMorphSlot (BasslineGeneratorProcessor::MorphSlot::a);
+        setParameter (plugin, "hits", 11.0f);
+        setParameter (plugin, "seed", 7.0f);
+        setParameter (plugin, "velocity", 60.0f);
+        plugin.storeMorphSlot (BasslineGeneratorProcessor::MorphSlot::b);
+        setParameter (plugin, "morph", 0.5f);
+        plugin.setNonRealtime (true);
+
+        MidiPatternExporter::PatternParams params;
+        params.steps = 16;
+        params.hits = 11;
+        params.seed = 7;
+        params.velocity = 60;
+        params.numBars = 2;
+        auto unmorphed = noteOns (MidiPatternExporter::generatePattern (params));
+
+        params.morphSlots = plugin.getMorphSlots();
+        params.morph = 0.5f;
+        REQUIRE (params.morphSlots != nullptr);
+        auto file = MidiPatternExporter::generatePattern (params);
+        auto exported = noteOns (file);
+
+        // Two bars at 120 bpm, less the first step as above
+        constexpr double samplesPerTick = 48000.0 / (960.0 * 2.0);
+        constexpr double firstStep = 48000.0 * 2.0 / 16.0;
+        auto sent = renderProcessor (plugin, 192000);
+
+        std::vector<const juce::MidiMessage*> played;
+        for (auto* event : sent)
+            if (event->message.isNoteOn() && event->message.getTimeStamp() >= firstStep)
+                played.push_back (&event->message);
+        auto beforeFirstStep = [&] (auto* message) { return message->getTimeStamp() * samplesPerTick < firstStep; };
+        std::erase_if (exported, beforeFirstStep);
+        std::erase_if (unmorphed, beforeFirstStep);
+
+        REQUIRE_FALSE (played.empty());
+        REQUIRE (played.size() == exported.size());
+        bool morphed = exported.size() != unmorphed.size();
+        for (size_t i = 0; i < played.size(); ++i)
+        {
+            INFO ("note " << i);
+            CHECK (played[i]->getNoteNumber() == exported[i]->getNoteNumber());
+            CHECK (played[i]->getVelocity() == exported[i]->getVelocity());
+            CHECK (std::abs (played[i]->getTimeStamp() - exported[i]->getTimeStamp() * samplesPerTick) <= 3.0);
+            morphed = morphed || exported[i]->getVelocity() != unmorphed[i]->getVelocity();
+        }
+        CHECK (morphed); // The slots differ, so halfway isn't the pattern the parameters describe
+    }
+
+    SECTION ("the densest output fits the MIDI reserved for a block, a note at most per sample")
+    {
+        BasslineGeneratorProcessor plugin;
+        setParameter (plugin, "clockTempo", 240.0f);
+        setParameter (plugin, "steps", 16.0f);
+        setParameter (plugin, "hits", 16.0f);
+        setParameter (plugin, "ratchetChance", 1.0f);
+        setParameter (plugin, "ratchetCount", 8.0f);
+        setParameter (plugin, "rollRamp", 1.0f);
+        setParameter (plugin, "microTiming", 0.5f);
+        setParameter (plugin, "humanizeTiming", 0.2f);
+        setParameter (plugin, "glide", 1.0f);
+        setParameter (plugin, "envelopeCc", 74.0f);
+        setParameter (plugin, "curveRate", 1.0f);
+        setParameter (plugin, "outputMode", 3.0f); // MPE: a lane message per note too
+        setParameter (plugin, "sendMidiClock", 1.0f);
+
+        // A low rate packs the ratchets into the fewest samples; two bars at 240 bpm
+        ProcessorPlayer player (plugin, 8000.0, 64);
+
+        // The host's own buffer, before any block: from here on the processor may only swap
+        // storage in and out of it, never grow it
+        player.midi.ensureSize (64);
+        using Storage = std::pair<const juce::uint8*, int>;
+        auto storageOf = [&] { return Storage (player.midi.data.begin(), player.midi.data.getNumAllocated()); };
+        std::vector<Storage> seen { storageOf() };
+
+        while (player.position < 32000)
+        {
+            player.playTo (player.position + 64);
+            REQUIRE (player.midi.data.size() <= player.midi.data.getNumAllocated());
+            if (std::find (seen.begin(), seen.end(), storageOf()) == seen.end())
+                seen.push_back (storageOf());
+        }
+
+        // The host's storage and the one reserved in prepareToPlay, nothing else
+        CHECK (seen.size() == 2);
+
+        double previous = -1.0;
+        int notes = 0;
+        for (auto* event : player.sent)
+        {
+            if (!event->message.isNoteOn())
+                continue;
+
+            CHECK (event->message.getTimeStamp() > previous);
+            previous = event->message.getTimeStamp();
+            ++notes;
+        }
+        CHECK (notes > 2 * 16 * 2);
+    }
+}
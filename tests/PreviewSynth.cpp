@@ -0,0 +1,63 @@
+#include "utils/PreviewSynth.h"
+#include "utils/MidiPatternExporter.h"
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+
+TEST_CASE ("Preview synth", "[preview]")
+{
+    SECTION ("silent until a note, and silent again once it's released")
+    {
+        PreviewSynth synth;
+        synth.prepare (48000.0, 512);
+
+        juce::AudioBuffer<float> buffer (2, 48000);
+        buffer.clear();
+        juce::MidiBuffer midi;
+        midi.addEvent (juce::MidiMessage::noteOn (1, 36, (juce::uint8) 100), 1000);
+        midi.addEvent (juce::MidiMessage::noteOff (1, 36), 12000);
+        synth.render (buffer, midi, 0, buffer.getNumSamples());
+
+        CHECK (buffer.getMagnitude (0, 0, 1000) == 0.0f);
+        CHECK (buffer.getMagnitude (0, 1000, 11000) > 0.05f);
+        CHECK (buffer.getMagnitude (1, 1000, 11000) == buffer.getMagnitude (0, 1000, 11000));
+        CHECK (buffer.getMagnitude (0, 40000, 8000) < 1.0e-3f);
+    }
+
+    SECTION ("the filter follows its envelope however the audio is split into blocks")
+    {
+        // Rendered whole and a control block at a time, each control block has the same cutoff
+        auto renderInBlocks = [] (int blockSize)
+        {
+            PreviewSynth synth;
+            synth.prepare (48000.0, 512);
+
+            juce::AudioBuffer<float> buffer (1, 8192);
+            buffer.clear();
+            juce::MidiBuffer midi;
+            midi.addEvent (juce::MidiMessage::noteOn (1, 36, (juce::uint8) 127), 0);
+            for (int start = 0; start < buffer.getNumSamples(); start += blockSize)
+                synth.render (buffer, midi, start, blockSize);
+            return buffer;
+        };
+
+        auto whole = renderInBlocks (512);
+        auto split = renderInBlocks (PreviewSynth::controlBlock);
+        for (int i = 0; i < whole.getNumSamples(); ++i)
+            REQUIRE (std::abs (whole.getSample (0, i) - split.getSample (0, i)) < 1.0e-4f);
+    }
+
+    SECTION ("a rendered pattern is audible and doesn't clip")
+    {
+        MidiPatternExporter::PatternParams params;
+        params.steps = 16;
+        params.hits = 7;
+        params.glideChance = 0.5f;
+
+        auto audio = MidiPatternExporter::renderPreview (params, 44100.0);
+
+        // A bar at 120 bpm, plus the tail
+        CHECK (audio.getNumSamples() >= 88200);
+        CHECK (audio.getMagnitude (0, 0, audio.getNumSamples()) > 0.05f);
+        CHECK (audio.getMagnitude (0, 0, audio.getNumSamples()) < 1.0f);
+    }
+}
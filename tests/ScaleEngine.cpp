@@ -0,0 +1,151 @@
+#include "helpers/test_helpers.h"
+#include "utils/ScalaImport.h"
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    std::vector<int> intervalsOf (const ScaleEngine::ScaleDefinition& scale)
+    {
+        return { scale.intervals.begin(), scale.intervals.begin() + scale.size };
+    }
+}
+
+TEST_CASE ("Scale tables", "[scales]")
+{
+    SECTION ("the original five scales keep their indices")
+    {
+        const std::vector<std::string> original { "Minor Pentatonic", "Major", "Minor", "Dorian", "Chromatic" };
+        for (size_t i = 0; i < original.size(); ++i)
+            CHECK (ScaleEngine::builtInScales[i].name == original[i]);
+
+        CHECK (intervalsOf (ScaleEngine::builtInScales[0]) == std::vector<int> { 0, 3, 5, 7, 10 });
+        CHECK (intervalsOf (ScaleEngine::builtInScales[1]) == std::vector<int> { 0, 2, 4, 5, 7, 9, 11 });
+
+        auto names = BasslineGeneratorProcessor::getScaleNames();
+        CHECK (names.size() == ScaleEngine::numBuiltInScales + 1);
+        CHECK (names[ScaleEngine::userScaleIndex] == "User (Scala)");
+    }
+
+    SECTION ("a table holds each degree of each octave, from the root")
+    {
+        const auto& major = ScaleEngine::lookup (1, 36, 2);
+        CHECK (major.scaleSize == 7);
+        CHECK (major.octaveRange == 2);
+        CHECK (major.note (0, 0) == 36);
+        CHECK (major.note (6, 0) == 47);
+        CHECK (major.note (0, 1) == 48);
+        CHECK (major.note (4, 1) == 55);
+    }
+
+    SECTION ("out-of-range values clamp, and a missing imported scale falls back to the first")
+    {
+        CHECK (ScaleEngine::lookup (0, 200, 9).rootNote == ScaleEngine::maxRoot);
+        CHECK (ScaleEngine::lookup (0, 200, 9).octaveRange == ScaleEngine::maxOctaves);
+        CHECK (&ScaleEngine::lookup (ScaleEngine::userScaleIndex, 40, 1) == &ScaleEngine::lookup (0, 40, 1));
+        CHECK (&ScaleEngine::lookup (-1, 40, 1) == &ScaleEngine::lookup (0, 40, 1));
+    }
+
+    SECTION ("an imported scale gets its own tables")
+    {
+        auto definition = ScalaImport::parseScl ("Whole tone\n 6\n200.\n400.\n600.\n800.\n1000.\n2/1\n");
+        REQUIRE (definition.has_value());
+        ScaleEngine::UserScale user (*definition);
+
+        const auto& table = ScaleEngine::lookup (ScaleEngine::userScaleIndex, 40, 1, &user);
+        CHECK (table.scaleSize == 6);
+        CHECK (table.note (0, 0) == 40);
+        CHECK (table.note (5, 0) == 50);
+    }
+}
+
+TEST_CASE ("Scala import", "[scales]")
+{
+    SECTION ("comments are skipped, and cents and ratios round to semitones")
+    {
+        auto definition = ScalaImport::parseScl ("! test.scl\n"
+                                                 "!\n"
+                                                 "Pentatonic in cents and ratios\n"
+                                                 " 5\n"
+                                                 "!\n"
+                                                 " 200.0\n"
+                                                 " 6/5\n"
+                                                 " 701.955 a fifth\n"
+                                                 " 9/5\n"
+                                                 " 2/1\n");
+        REQUIRE (definition.has_value());
+        CHECK (intervalsOf (*definition) == std::vector<int> { 0, 2, 3, 7, 10 });
+        CHECK (definition->period == 12);
+    }
+
+    SECTION ("a ratio and the same interval in cents give the same scale")
+    {
+        auto cents = ScalaImport::parseScl ("Fifths\n 2\n 700.0\n 1200.0\n");
+        auto ratios = ScalaImport::parseScl ("Fifths\n 2\n 3/2\n 2\n");
+        REQUIRE (cents.has_value());
+        REQUIRE (ratios.has_value());
+        CHECK (intervalsOf (*cents) == intervalsOf (*ratios));
+        CHECK (cents->period == ratios->period);
+    }
+
+    SECTION ("a blank description is still the description")
+    {
+        auto definition = ScalaImport::parseScl ("\n 1\n 2/1\n");
+        REQUIRE (definition.has_value());
+        CHECK (definition->size == 1);
+        CHECK (definition->period == 12);
+    }
+
+    SECTION ("malformed files are rejected")
+    {
+        CHECK_FALSE (ScalaImport::parseScl ("Description only\n").has_value());   // No note count
+        CHECK_FALSE (ScalaImport::parseScl ("Short\n 5\n 200.0\n 2/1\n").has_value()); // Fewer notes than counted
+        CHECK_FALSE (ScalaImport::parseScl ("Empty\n 0\n").has_value());
+        CHECK_FALSE (ScalaImport::parseScl ("Garbage\n 2\n abc\n 2/1\n").has_value());
+        CHECK_FALSE (ScalaImport::parseScl ("Zero ratio\n 2\n 0/5\n 2/1\n").has_value());
+        CHECK_FALSE (ScalaImport::parseScl ("No period\n 1\n -100.0\n").has_value());
+    }
+
+    SECTION ("a keyboard mapping keeps the degrees it maps and skips unmapped keys")
+    {
+        const auto& chromatic = ScaleEngine::builtInScales[4];
+        auto mapped = ScalaImport::applyKbm (chromatic, "! white keys\n"
+                                                        "12\n0\n127\n60\n69\n440.0\n12\n"
+                                                        "! mapping\n"
+                                                        "0\nx\n2\nx\n4\n5\nx\n7\nx\n9\nx\n11\n");
+        REQUIRE (mapped.has_value());
+        CHECK (intervalsOf (*mapped) == intervalsOf (ScaleEngine::builtInScales[1]));
+        CHECK (mapped->period == 12);
+    }
+
+    SECTION ("a linear mapping keeps the scale, and a mapping without keys is rejected")
+    {
+        const auto& minor = ScaleEngine::builtInScales[2];
+        auto linear = ScalaImport::applyKbm (minor, "0\n0\n127\n60\n69\n440.0\n0\n");
+        REQUIRE (linear.has_value());
+        CHECK (intervalsOf (*linear) == intervalsOf (minor));
+
+        CHECK_FALSE (ScalaImport::applyKbm (minor, "2\n0\n127\n60\n69\n440.0\n7\nx\nx\n").has_value());
+        CHECK_FALSE (ScalaImport::applyKbm (minor, "12\n0\n127\n").has_value());
+    }
+}
+
+TEST_CASE ("A session saved with the five-scale parameter restores its scale", "[scales]")
+{
+    BasslineGeneratorProcessor saved;
+    juce::MemoryBlock state;
+    saved.getStateInformation (state);
+
+    // Rewrite the scale as the old parameter, set to Dorian
+    auto xml = juce::AudioProcessor::getXmlFromBinary (state.getData(), static_cast<int> (state.getSize()));
+    REQUIRE (xml != nullptr);
+    auto* scale = xml->getChildByAttribute ("id", "scaleType");
+    REQUIRE (scale != nullptr);
+    scale->setAttribute ("id", "scale");
+    scale->setAttribute ("value", 3.0);
+    juce::MemoryBlock oldState;
+    juce::AudioProcessor::copyXmlToBinary (*xml, oldState);
+
+    BasslineGeneratorProcessor plugin;
+    plugin.setStateInformation (oldState.getData(), static_cast<int> (oldState.getSize()));
+    CHECK (plugin.apvts.getRawParameterValue ("scaleType")->load() == 3.0f);
+}
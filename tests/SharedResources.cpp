@@ -0,0 +1,83 @@
+#include "utils/SharedResources.h"
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    struct Built
+    {
+        int value = 0;
+    };
+}
+
+TEST_CASE ("Shared object cache", "[shared]")
+{
+    SharedObjectCache<Built> cache;
+    int builds = 0;
+    auto build = [&] { ++builds; return std::make_shared<const Built> (Built { 7 }); };
+
+    SECTION ("two holders of a key share one object, built once")
+    {
+        auto first = cache.getOrCreate ("a", build);
+        auto second = cache.getOrCreate ("a", build);
+        CHECK (first == second);
+        CHECK (builds == 1);
+
+        auto other = cache.getOrCreate ("b", build);
+        CHECK (other != first);
+        CHECK (builds == 2);
+    }
+
+    SECTION ("the object goes with its last holder, and asking again rebuilds it")
+    {
+        auto first = cache.getOrCreate ("a", build);
+        auto second = cache.getOrCreate ("a", build);
+        std::weak_ptr<const Built> watched = first;
+
+        first.reset();
+        CHECK_FALSE (watched.expired());
+        second.reset();
+        CHECK (watched.expired());
+
+        auto rebuilt = cache.getOrCreate ("a", build);
+        REQUIRE (rebuilt != nullptr);
+        CHECK (rebuilt->value == 7);
+        CHECK (builds == 2);
+    }
+
+    SECTION ("a failed build isn't cached")
+    {
+        CHECK (cache.getOrCreate ("a", [] { return std::shared_ptr<const Built>(); }) == nullptr);
+        CHECK (cache.getOrCreate ("a", build) != nullptr);
+        CHECK (builds == 1);
+    }
+}
+
+TEST_CASE ("Shared resources", "[shared]")
+{
+    SECTION ("holders share one instance until the last one goes, and the next holder gets a working one")
+    {
+        {
+            juce::SharedResourcePointer<SharedResources> first;
+            juce::SharedResourcePointer<SharedResources> second;
+            CHECK (&first.get() == &second.get());
+            CHECK (first.getReferenceCount() == 2);
+
+            auto track = first->harmonyTracks.getOrCreate ("progression", [] {
+                return std::make_shared<const HarmonyTrack> (std::vector<HarmonyTrack::Region> { {} }, 4.0);
+            });
+            CHECK (second->harmonyTracks.getOrCreate ("progression", [] { return std::shared_ptr<const HarmonyTrack>(); }) == track);
+        }
+
+        juce::SharedResourcePointer<SharedResources> again;
+        CHECK (again.getReferenceCount() == 1);
+
+        // Nothing survived the release: the cache builds afresh
+        bool rebuilt = false;
+        auto track = again->harmonyTracks.getOrCreate ("progression", [&] {
+            rebuilt = true;
+            return std::make_shared<const HarmonyTrack> (std::vector<HarmonyTrack::Region> { {} }, 4.0);
+        });
+        CHECK (rebuilt);
+        CHECK (track != nullptr);
+    }
+}
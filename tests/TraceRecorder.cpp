@@ -0,0 +1,37 @@
+#include "utils/TraceRecorder.h"
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+
+TEST_CASE ("Trace recorder", "[trace]")
+{
+    SECTION ("threads that exit hand their buffers on, under their own names")
+    {
+        if (!TraceRecorder::enabled)
+            return; // Compiled out
+
+        auto& recorder = TraceRecorder::getInstance();
+        juce::TemporaryFile capture (".json");
+
+        // Twice the pool, a capture each: the second only has buffers if the first's were freed
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            REQUIRE (recorder.start (capture.getFile()));
+            for (int i = 0; i < TraceRecorder::maxThreads; ++i)
+            {
+                std::thread ([] {
+                    MB_TRACE_THREAD ("Worker");
+                    MB_TRACE_SCOPE ("test", "work");
+                }).join();
+            }
+            recorder.stop();
+
+            auto json = capture.getFile().loadFileAsString();
+            CHECK (json.indexOf ("\"cat\":\"test\"") >= 0);
+            int workers = 0;
+            for (const auto& line : juce::StringArray::fromLines (json))
+                if (line.contains ("thread_name") && line.contains ("\"name\":\"Worker "))
+                    ++workers;
+            CHECK (workers == TraceRecorder::maxThreads);
+        }
+    }
+}
@@ -0,0 +1,130 @@
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    // 16 steps a bar at the internal clock's 120 bpm, 48 kHz
+    constexpr int samplesPerStep = 6000;
+    constexpr int samplesPerBar = 16 * samplesPerStep;
+
+    // The sixteenths of a bar that notes started on
+    std::vector<int> stepsInBar (const juce::MidiMessageSequence& sent, int bar)
+    {
+        return stepsPlayed (sent, bar * samplesPerBar, samplesPerBar, 16);
+    }
+
+    std::vector<int> stepsFrom (int first, int last, int every = 1)
+    {
+        std::vector<int> steps;
+        for (int step = first; step <= last; step += every)
+            steps.push_back (step);
+        return steps;
+    }
+
+    // Lowest note started from a sample on
+    int lowestNoteFrom (const juce::MidiMessageSequence& sent, int fromSample)
+    {
+        int lowest = 128;
+        for (auto* event : sent)
+            if (event->message.isNoteOn() && event->message.getTimeStamp() >= fromSample)
+                lowest = std::min (lowest, event->message.getNoteNumber());
+        return lowest;
+    }
+
+    // Runs a callback the first time a parameter is written
+    struct OnFirstWrite : juce::AudioProcessorParameter::Listener
+    {
+        std::function<void()> callback;
+
+        void parameterValueChanged (int, float) override
+        {
+            if (auto pending = std::exchange (callback, nullptr))
+                pending();
+        }
+
+        void parameterGestureChanged (int, bool) override {}
+    };
+}
+
+TEST_CASE ("Parameter transactions", "[transactions]")
+{
+    BasslineGeneratorProcessor plugin;
+    setParameter (plugin, "steps", 16.0f);
+    setParameter (plugin, "hits", 4.0f);
+    ProcessorPlayer player (plugin, 48000.0, 500);
+
+    // Halfway through the third step of the first bar
+    player.playTo (15000);
+    BasslineGeneratorProcessor::ParameterChanges changes;
+
+    SECTION ("a step-boundary transaction takes over at the next step")
+    {
+        plugin.applyParameterChanges (changes.set ("hits", 16.0f), BasslineGeneratorProcessor::TransactionBoundary::step);
+        player.playTo (2 * samplesPerBar);
+
+        auto expected = stepsFrom (3, 15);
+        expected.insert (expected.begin(), 0);
+        CHECK (stepsInBar (player.sent, 0) == expected);
+        CHECK (stepsInBar (player.sent, 1) == stepsFrom (0, 15));
+    }
+
+    SECTION ("a bar-boundary transaction keeps the bar as it was, though the parameters have changed")
+    {
+        plugin.applyParameterChanges (changes.set ("hits", 16.0f), BasslineGeneratorProcessor::TransactionBoundary::bar);
+        CHECK (plugin.apvts.getRawParameterValue ("hits")->load() == 16.0f);
+
+        player.playTo (2 * samplesPerBar);
+        CHECK (stepsInBar (player.sent, 0) == stepsFrom (0, 12, 4));
+        CHECK (stepsInBar (player.sent, 1) == stepsFrom (0, 15));
+    }
+
+    SECTION ("a change of step count waits for the bar")
+    {
+        changes.set ("steps", 8.0f).set ("hits", 8.0f);
+        plugin.applyParameterChanges (changes, BasslineGeneratorProcessor::TransactionBoundary::step);
+        player.playTo (2 * samplesPerBar);
+
+        CHECK (stepsInBar (player.sent, 0) == stepsFrom (0, 12, 4));
+        CHECK (stepsInBar (player.sent, 1) == stepsFrom (0, 14, 2));
+    }
+
+    SECTION ("blocks played while a commit is writing the parameters hear none of it half-written")
+    {
+        // Between the writes of hits and root the audio thread runs on, through the swap
+        // and beyond: a sync of the parameters then would put the old root back
+        OnFirstWrite onHits;
+        onHits.callback = [&] { player.playTo (3 * samplesPerStep + 4 * samplesPerStep); };
+        auto* hits = plugin.apvts.getParameter ("hits");
+        hits->addListener (&onHits);
+
+        changes.set ("hits", 16.0f).set ("rootNote", 48.0f);
+        plugin.applyParameterChanges (changes, BasslineGeneratorProcessor::TransactionBoundary::step);
+        hits->removeListener (&onHits);
+        REQUIRE (player.position > 3 * samplesPerStep);
+
+        player.playTo (2 * samplesPerBar);
+        CHECK (lowestNoteFrom (player.sent, 3 * samplesPerStep) >= 48);
+        CHECK (stepsInBar (player.sent, 1) == stepsFrom (0, 15));
+    }
+
+    SECTION ("a state restored mid-bar is heard from the next step")
+    {
+        // Saved playing on the internal clock too, or restoring it would stop the transport
+        BasslineGeneratorProcessor saved;
+        setParameter (saved, "clockSource", 1.0f);
+        setParameter (saved, "clockRunning", 1.0f);
+        setParameter (saved, "steps", 16.0f);
+        setParameter (saved, "hits", 16.0f);
+        setParameter (saved, "rootNote", 48.0f);
+        juce::MemoryBlock state;
+        saved.getStateInformation (state);
+
+        plugin.setStateInformation (state.getData(), static_cast<int> (state.getSize()));
+        player.playTo (samplesPerBar);
+
+        auto expected = stepsFrom (3, 15);
+        expected.insert (expected.begin(), 0);
+        CHECK (stepsInBar (player.sent, 0) == expected);
+        CHECK (lowestNoteFrom (player.sent, 3 * samplesPerStep) >= 48);
+    }
+}
@@ -0,0 +1,72 @@
+#include "utils/UndoHistory.h"
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    UndoHistory::State makeState (float rhythm, float pitch, uint32_t edits = 0)
+    {
+        UndoHistory::State state;
+        state.chunks[0] = std::make_shared<const UndoHistory::Chunk> (UndoHistory::Chunk { 8.0f, rhythm, 0.0f });
+        state.chunks[1] = std::make_shared<const UndoHistory::Chunk> (UndoHistory::Chunk { 36.0f, pitch });
+        for (size_t i = 2; i < state.chunks.size(); ++i)
+            state.chunks[i] = std::make_shared<const UndoHistory::Chunk> (UndoHistory::Chunk { 0.5f });
+        state.edits = edits;
+        return state;
+    }
+}
+
+TEST_CASE ("Undo history", "[undo]")
+{
+    UndoHistory history;
+    history.reset (makeState (3.0f, 0.25f));
+
+    SECTION ("unchanged chunks are shared with the previous entry")
+    {
+        REQUIRE (history.record (makeState (4.0f, 0.25f)));
+        REQUIRE_FALSE (history.record (makeState (4.0f, 0.25f)));
+
+        auto* latest = history.current();
+        auto* previous = history.undo();
+        REQUIRE (previous != nullptr);
+        CHECK (latest->chunks[0] != previous->chunks[0]);
+        CHECK (latest->chunks[1] == previous->chunks[1]);
+    }
+
+    SECTION ("recording after an undo drops the redo branch")
+    {
+        history.record (makeState (4.0f, 0.25f));
+        history.record (makeState (5.0f, 0.25f));
+        history.undo();
+        history.record (makeState (5.0f, 0.25f, 0b101));
+
+        CHECK (history.size() == 3);
+        CHECK_FALSE (history.canRedo());
+        CHECK (history.current()->edits == 0b101);
+    }
+
+    SECTION ("shared chunks are saved once")
+    {
+        for (int i = 0; i < 4000; ++i)
+            history.record (makeState (static_cast<float> (i % 16), 0.25f));
+
+        // An entry and a rhythm chunk per recording, plus the first entry's other four chunks
+        REQUIRE (history.size() == 4001);
+        CHECK (history.toValueTree().getNumChildren() == 2 * 4001 + 4);
+    }
+
+    SECTION ("survives a round trip through the state")
+    {
+        history.record (makeState (4.0f, 0.1f, 0b11));
+        history.record (makeState (5.0f, 0.1f));
+        history.undo();
+
+        UndoHistory restored;
+        REQUIRE (restored.fromValueTree (history.toValueTree(), { 3, 2, 1, 1, 1 }));
+        CHECK (restored.size() == 3);
+        CHECK (*restored.current() == makeState (4.0f, 0.1f, 0b11));
+        CHECK (restored.canRedo());
+
+        UndoHistory mismatched;
+        CHECK_FALSE (mismatched.fromValueTree (history.toValueTree(), { 4, 2, 1, 1, 1 }));
+    }
+}
@@ -0,0 +1,46 @@
+#include "generator/VoiceLeadingOptimiser.h"
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE ("Voice leading", "[voiceleading]")
+{
+    SECTION ("a line follows the hits of the unrotated rhythm")
+    {
+        CompiledPattern pattern;
+        pattern.steps = 8;
+        pattern.hits = 3;
+        pattern.rotation = 2;
+        pattern.compileAll();
+
+        VoiceLeadingOptimiser optimiser;
+        auto line = optimiser.optimise (pattern, nullptr);
+        REQUIRE (line.numHits == 3);
+        CHECK_FALSE (line.wholeCycle);
+
+        line.applyTo (pattern);
+        for (int hit = 0; hit < line.numHits; ++hit)
+            CHECK (pattern.pitches[static_cast<size_t> ((line.hitSteps[static_cast<size_t> (hit)] + 2) % 8)]
+                   == line.hitPitches[static_cast<size_t> (hit)]);
+    }
+
+    SECTION ("with its own pitch length the line runs through the whole pitch cycle")
+    {
+        CompiledPattern pattern;
+        pattern.steps = 8;
+        pattern.hits = 3;
+        pattern.pitchLength = 5;
+        pattern.compileAll();
+
+        VoiceLeadingOptimiser optimiser;
+        auto line = optimiser.optimise (pattern, nullptr);
+        REQUIRE (line.numHits == 5);
+        CHECK (line.wholeCycle);
+
+        line.applyTo (pattern);
+        for (int entry = 0; entry < 5; ++entry)
+            CHECK (pattern.pitchAt (entry) == line.hitPitches[static_cast<size_t> (entry)]);
+
+        // A line for another pitch length is for other inputs
+        pattern.pitchLength = 0;
+        CHECK_FALSE (VoiceLine::Key::of (pattern, nullptr) == line.key);
+    }
+}
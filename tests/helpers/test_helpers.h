@@ -1,5 +1,6 @@
 #pragma once
 #include <PluginProcessor.h>
+#include <algorithm>
 
 /* This is a helper function to run tests within the context of a plugin editor.
  *
@@ -29,3 +30,125 @@
     plugin.editorBeingDeleted (editor);
     delete editor;
 }
+
+/* The messages of an exported file's note track (track 0) that match, in time order. They
+ * point into the file, so keep it alive while they're used.
+ */
+template <typename Predicate>
+std::vector<const juce::MidiMessage*> trackMessages (const juce::MidiFile& file, Predicate matches)
+{
+    std::vector<const juce::MidiMessage*> found;
+    for (auto* event : *file.getTrack (0))
+        if (matches (event->message))
+            found.push_back (&event->message);
+    return found;
+}
+
+[[maybe_unused]] static std::vector<const juce::MidiMessage*> noteOns (const juce::MidiFile& file)
+{
+    return trackMessages (file, [] (const juce::MidiMessage& message) { return message.isNoteOn(); });
+}
+
+/* Sets a parameter from its real value, as a host would. */
+[[maybe_unused]] static void setParameter (BasslineGeneratorProcessor& plugin, const juce::String& id, float value)
+{
+    auto* parameter = plugin.apvts.getParameter (id);
+    parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+}
+
+/* Plays the processor on its internal clock from the top, a block at a time, and keeps what
+ * it sent, timestamps in samples. Messages of input (timestamps in samples too) arrive in the
+ * block they fall in.
+ */
+struct ProcessorPlayer
+{
+    ProcessorPlayer (BasslineGeneratorProcessor& processor, double sampleRate = 48000.0, int samplesPerBlock = 512)
+        : plugin (processor), blockSize (samplesPerBlock), buffer (2, samplesPerBlock)
+    {
+        setParameter (plugin, "clockSource", 1.0f);
+        setParameter (plugin, "clockRunning", 1.0f);
+        plugin.prepareToPlay (sampleRate, blockSize);
+    }
+
+    // Plays whole blocks until at least endSample
+    void playTo (int endSample, const juce::MidiMessageSequence& input = {})
+    {
+        for (; position < endSample; position += blockSize)
+        {
+            midi.clear();
+            for (auto* event : input)
+                if (auto time = juce::roundToInt (event->message.getTimeStamp()); time >= position && time < position + blockSize)
+                    midi.addEvent (event->message, time - position);
+
+            plugin.processBlock (buffer, midi);
+            for (const auto metadata : midi)
+                sent.addEvent (metadata.getMessage(), position + metadata.samplePosition);
+        }
+    }
+
+    BasslineGeneratorProcessor& plugin;
+    int blockSize;
+    int position = 0;
+    juce::AudioBuffer<float> buffer;
+    juce::MidiBuffer midi;
+    juce::MidiMessageSequence sent;
+};
+
+/* The whole of a play from the top for numSamples. */
+[[maybe_unused]] static juce::MidiMessageSequence renderProcessor (BasslineGeneratorProcessor& plugin, int numSamples,
+                                                                   double sampleRate = 48000.0, int blockSize = 512,
+                                                                   const juce::MidiMessageSequence& input = {})
+{
+    ProcessorPlayer player (plugin, sampleRate, blockSize);
+    player.playTo (numSamples, input);
+    return player.sent;
+}
+
+/* The steps of a bar that notes start on, once each. Timestamps in any unit, as long as the
+ * bar's start and length are in it too.
+ */
+[[maybe_unused]] static std::vector<int> stepsPlayed (const juce::MidiMessageSequence& sequence, double barStart, double barLength, int steps)
+{
+    std::vector<int> played;
+    for (auto* event : sequence)
+    {
+        auto position = (event->message.getTimeStamp() - barStart) / barLength;
+        if (!event->message.isNoteOn() || position < 0.0 || position >= 1.0)
+            continue;
+
+        auto step = static_cast<int> (position * steps + 1.0e-6);
+        if (played.empty() || played.back() != step)
+            played.push_back (step);
+    }
+    return played;
+}
+
+/* Note-ons that changed pitch while the note before was still sounding, and all that changed
+ * pitch, over a sequence's notes.
+ */
+[[maybe_unused]] static std::pair<int, int> countLegatoNotes (const juce::MidiMessageSequence& sequence)
+{
+    std::vector<int> sounding;
+    int previous = -1, legato = 0, changes = 0;
+    for (auto* event : sequence)
+    {
+        const auto& message = event->message;
+        if (message.isNoteOn())
+        {
+            if (previous >= 0 && message.getNoteNumber() != previous)
+            {
+                ++changes;
+                if (std::find (sounding.begin(), sounding.end(), previous) != sounding.end())
+                    ++legato;
+            }
+            previous = message.getNoteNumber();
+            sounding.push_back (previous);
+        }
+        else if (message.isNoteOff())
+        {
+            sounding.erase (std::remove (sounding.begin(), sounding.end(), message.getNoteNumber()), sounding.end());
+        }
+    }
+
+    return { legato, changes };
+}